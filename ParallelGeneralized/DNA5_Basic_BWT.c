@@ -1,7 +1,13 @@
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
 #include"basic_bitvec.h"
 #include"DNA5_Basic_BWT.h"
+#include"phase_log.h"
+#include"mem_account.h"
 
 #define use_dbwt 
 #ifdef use_dbwt
@@ -13,6 +19,21 @@
 #endif
 
 
+// On disk index: this header, then the packed BWT at Basic_BWT_file_data_offset
+#define Basic_BWT_file_magic "DNA5BWT"
+#define Basic_BWT_file_version 1
+#define Basic_BWT_file_data_offset 4096
+
+typedef struct
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int textlen;
+	unsigned int primary_idx;
+	unsigned int char_base[5];
+	unsigned int payload_size;
+} Basic_BWT_file_header_t;
+
 Basic_BWT_t * new_Basic_BWT()
 {
 	return (Basic_BWT_t *) calloc(1,sizeof(Basic_BWT_t));
@@ -21,19 +42,136 @@ void free_Basic_BWT(Basic_BWT_t * Basic_BWT)
 {
 	if(Basic_BWT)
 	{
-		if(Basic_BWT->indexed_BWT)
+		if(Basic_BWT->mapping)
+		{
+			munmap(Basic_BWT->mapping,Basic_BWT->mapping_size);
+			Basic_BWT->indexed_BWT=NULL;
+		}
+		else if(Basic_BWT->indexed_BWT)
 		{
-			free_basic_DNA5_seq(Basic_BWT->indexed_BWT);
+			free_basic_DNA5_seq(Basic_BWT->indexed_BWT,Basic_BWT->size);
 			Basic_BWT->indexed_BWT=NULL;
 		};
+		Basic_BWT_free_SA_samples(Basic_BWT);
 		free(Basic_BWT);
 	};
 };
 
 
+// Write the index to path. The sampled suffix array, if any, is not saved.
+// The file is written under a temporary name and renamed, so that other
+// processes never load or attach a partial index.
+int Basic_BWT_save(Basic_BWT_t * Basic_BWT,const char * path)
+{
+	Basic_BWT_file_header_t header;
+	FILE * f;
+	char * tmp_path;
+	int res=0;
+	memset(&header,0,sizeof(header));
+	strcpy(header.magic,Basic_BWT_file_magic);
+	header.version=Basic_BWT_file_version;
+	header.textlen=Basic_BWT->textlen;
+	header.primary_idx=Basic_BWT->primary_idx;
+	memcpy(header.char_base,Basic_BWT->char_base,sizeof(header.char_base));
+	header.payload_size=get_DNA_index_seq_payload_size(Basic_BWT->textlen+1);
+	tmp_path=(char *)malloc(strlen(path)+32);
+	sprintf(tmp_path,"%s.%ld.tmp",path,(long)getpid());
+	if((f=fopen(tmp_path,"wb"))==NULL)
+	{
+		free(tmp_path);
+		return -1;
+	};
+	if(fwrite(&header,sizeof(header),1,f)!=1 ||
+			fseek(f,Basic_BWT_file_data_offset,SEEK_SET)!=0 ||
+			fwrite(Basic_BWT->indexed_BWT,1,header.payload_size,f)!=header.payload_size)
+		res=-1;
+	if(fclose(f)!=0)
+		res=-1;
+	if(res==0 && rename(tmp_path,path)!=0)
+		res=-1;
+	if(res!=0)
+		unlink(tmp_path);
+	free(tmp_path);
+	return res;
+};
+
+static int Basic_BWT_read_header(FILE * f,Basic_BWT_file_header_t * header)
+{
+	if(fread(header,sizeof(Basic_BWT_file_header_t),1,f)!=1 ||
+			strcmp(header->magic,Basic_BWT_file_magic)!=0 ||
+			header->version!=Basic_BWT_file_version ||
+			header->payload_size!=get_DNA_index_seq_payload_size(header->textlen+1))
+		return -1;
+	return 0;
+};
+
+// Read an index written by Basic_BWT_save. Returns NULL on error.
+Basic_BWT_t * Basic_BWT_load(const char * path)
+{
+	Basic_BWT_file_header_t header;
+	Basic_BWT_t * Basic_BWT;
+	FILE * f;
+	if((f=fopen(path,"rb"))==NULL)
+		return NULL;
+	if(Basic_BWT_read_header(f,&header)!=0 || fseek(f,Basic_BWT_file_data_offset,SEEK_SET)!=0)
+	{
+		fclose(f);
+		return NULL;
+	};
+	Basic_BWT=new_Basic_BWT();
+	Basic_BWT->indexed_BWT=new_basic_DNA5_seq(header.textlen+1,&Basic_BWT->size);
+	if(Basic_BWT->indexed_BWT==NULL ||
+			fread(Basic_BWT->indexed_BWT,1,header.payload_size,f)!=header.payload_size)
+	{
+		free_Basic_BWT(Basic_BWT);
+		fclose(f);
+		return NULL;
+	};
+	fclose(f);
+	Basic_BWT->textlen=header.textlen;
+	Basic_BWT->primary_idx=header.primary_idx;
+	memcpy(Basic_BWT->char_base,header.char_base,sizeof(header.char_base));
+	return Basic_BWT;
+};
+
+// Map an index written by Basic_BWT_save read-only, instead of reading it.
+// All the processes that attach the same file share one copy of the BWT in
+// the page cache. Returns NULL on error.
+Basic_BWT_t * Basic_BWT_attach(const char * path)
+{
+	Basic_BWT_file_header_t header;
+	Basic_BWT_t * Basic_BWT;
+	struct stat st;
+	size_t mapping_size;
+	void * mapping;
+	FILE * f;
+	if((f=fopen(path,"rb"))==NULL)
+		return NULL;
+	if(Basic_BWT_read_header(f,&header)!=0 || fstat(fileno(f),&st)!=0 ||
+			(size_t)st.st_size<Basic_BWT_file_data_offset+(size_t)header.payload_size)
+	{
+		fclose(f);
+		return NULL;
+	};
+	mapping_size=Basic_BWT_file_data_offset+(size_t)header.payload_size;
+	mapping=mmap(NULL,mapping_size,PROT_READ,MAP_SHARED,fileno(f),0);
+	fclose(f);
+	if(mapping==MAP_FAILED)
+		return NULL;
+	Basic_BWT=new_Basic_BWT();
+	Basic_BWT->mapping=mapping;
+	Basic_BWT->mapping_size=mapping_size;
+	Basic_BWT->indexed_BWT=(unsigned int *)((char *)mapping+Basic_BWT_file_data_offset);
+	Basic_BWT->size=header.payload_size;
+	Basic_BWT->textlen=header.textlen;
+	Basic_BWT->primary_idx=header.primary_idx;
+	memcpy(Basic_BWT->char_base,header.char_base,sizeof(header.char_base));
+	return Basic_BWT;
+};
+
 unsigned int LF_map(unsigned int in_pos,Basic_BWT_t * Basic_BWT)
 {
-	unsigned int counts0[4];
+	unsigned int counts0[5];
 	unsigned int c;
 	in_pos++;
 	if(in_pos==Basic_BWT->primary_idx)
@@ -42,9 +180,145 @@ unsigned int LF_map(unsigned int in_pos,Basic_BWT_t * Basic_BWT)
 	DNA5_get_char_pref_counts(counts0,Basic_BWT->indexed_BWT,in_pos-1);
 	if(c==0 && in_pos>Basic_BWT->primary_idx)
 		counts0[0]--;
+	else if(c==4)
+		counts0[4]=in_pos-(counts0[0]+counts0[1]+counts0[2]+counts0[3]);
 	return Basic_BWT->char_base[c]+counts0[c];
 };
 
+static inline unsigned int SA_sample_rank(unsigned int SA_pos,Basic_BWT_t * Basic_BWT)
+{
+	unsigned int word=Basic_BWT->SA_sample_marks[SA_pos/bits_per_word];
+	unsigned int bit=SA_pos%bits_per_word;
+	return Basic_BWT->SA_sample_ranks[SA_pos/bits_per_word]+
+			(bit?__builtin_popcount(word<<(bits_per_word-bit)):0);
+};
+
+// Bytes of the sampled suffix array: marks, ranks and samples
+static size_t Basic_BWT_SA_samples_size(Basic_BWT_t * Basic_BWT)
+{
+	size_t nwords=(Basic_BWT->textlen+bits_per_word-1)/bits_per_word;
+	size_t nsamples=(Basic_BWT->textlen+Basic_BWT->SA_sample_rate-1)/Basic_BWT->SA_sample_rate;
+	return (2*nwords+1+nsamples)*sizeof(unsigned int);
+};
+
+// Sample the suffix array every sample_rate text positions (text position 0
+// is always sampled). The samples are collected with one LF walk over the
+// whole text, like Basic_BWT_batch_extract.
+int Basic_BWT_build_SA_samples(Basic_BWT_t * Basic_BWT,unsigned int sample_rate)
+{
+	unsigned int nwords=(Basic_BWT->textlen+bits_per_word-1)/bits_per_word;
+	unsigned int nsamples=(Basic_BWT->textlen+sample_rate-1)/sample_rate;
+	unsigned int * sample_rows;
+	unsigned int SA_pos;
+	unsigned int txt_pos=Basic_BWT->textlen;
+	unsigned int i,rank;
+	if(sample_rate==0 || Basic_BWT->textlen==0)
+		return -1;
+	Basic_BWT_free_SA_samples(Basic_BWT);
+	sample_rows=(unsigned int *)malloc(nsamples*sizeof(unsigned int));
+	Basic_BWT->SA_sample_marks=new_bitvec(Basic_BWT->textlen);
+	Basic_BWT->SA_sample_ranks=(unsigned int *)malloc((nwords+1)*sizeof(unsigned int));
+	Basic_BWT->SA_samples=(unsigned int *)malloc(nsamples*sizeof(unsigned int));
+	if(sample_rows==NULL || Basic_BWT->SA_sample_marks==NULL ||
+			Basic_BWT->SA_sample_ranks==NULL || Basic_BWT->SA_samples==NULL)
+	{
+		free(sample_rows);
+		Basic_BWT_free_SA_samples(Basic_BWT);
+		return -1;
+	};
+	// The suffix of length one is the first suffix starting with the last character
+	SA_pos=Basic_BWT->char_base[DNA5_extract_char(Basic_BWT->indexed_BWT,0)];
+	do
+	{
+		txt_pos--;
+		if(txt_pos%sample_rate==0)
+		{
+			mark_bit(SA_pos,Basic_BWT->SA_sample_marks);
+			sample_rows[txt_pos/sample_rate]=SA_pos;
+		};
+		SA_pos=LF_map(SA_pos,Basic_BWT);
+	} while(txt_pos>0);
+	for(i=0,rank=0;i<nwords;i++)
+	{
+		Basic_BWT->SA_sample_ranks[i]=rank;
+		rank+=__builtin_popcount(Basic_BWT->SA_sample_marks[i]);
+	};
+	Basic_BWT->SA_sample_ranks[nwords]=rank;
+	for(i=0;i<nsamples;i++)
+		Basic_BWT->SA_samples[SA_sample_rank(sample_rows[i],Basic_BWT)]=i*sample_rate;
+	free(sample_rows);
+	Basic_BWT->SA_sample_rate=sample_rate;
+	mem_account(mem_index,Basic_BWT_SA_samples_size(Basic_BWT));
+	return 0;
+};
+
+// Document of every BWT row, for a text made of ndocs documents where
+// document d starts at text position doc_starts[d]. Row 0, the empty suffix,
+// goes to the last document. Built with one LF walk.
+unsigned int * Basic_BWT_document_array(Basic_BWT_t * Basic_BWT,
+		const unsigned int * doc_starts,unsigned int ndocs)
+{
+	unsigned int * doc;
+	unsigned int SA_pos;
+	unsigned int txt_pos=Basic_BWT->textlen;
+	unsigned int d=ndocs-1;
+	if(ndocs==0 || Basic_BWT->textlen==0)
+		return NULL;
+	if((doc=(unsigned int *)malloc((Basic_BWT->textlen+1)*sizeof(unsigned int)))==NULL)
+		return NULL;
+	doc[0]=d;
+	SA_pos=Basic_BWT->char_base[DNA5_extract_char(Basic_BWT->indexed_BWT,0)];
+	do
+	{
+		txt_pos--;
+		while(d>0 && txt_pos<doc_starts[d])
+			d--;
+		doc[SA_pos+1]=d;
+		SA_pos=LF_map(SA_pos,Basic_BWT);
+	} while(txt_pos>0);
+	return doc;
+};
+
+void Basic_BWT_free_SA_samples(Basic_BWT_t * Basic_BWT)
+{
+	if(Basic_BWT->SA_sample_rate)
+		mem_account(mem_index,-(long long)Basic_BWT_SA_samples_size(Basic_BWT));
+	free(Basic_BWT->SA_sample_marks);
+	free(Basic_BWT->SA_sample_ranks);
+	free(Basic_BWT->SA_samples);
+	Basic_BWT->SA_sample_marks=NULL;
+	Basic_BWT->SA_sample_ranks=NULL;
+	Basic_BWT->SA_samples=NULL;
+	Basic_BWT->SA_sample_rate=0;
+};
+
+// Text position of the suffix at index SA_pos, using at most SA_sample_rate-1
+// LF steps. Returns 0xffffffff if no samples were built.
+unsigned int Basic_BWT_locate(unsigned int SA_pos,Basic_BWT_t * Basic_BWT)
+{
+	unsigned int steps=0;
+	if(Basic_BWT->SA_sample_rate==0)
+		return 0xffffffff;
+	while(!ismarkedbit(SA_pos,Basic_BWT->SA_sample_marks))
+	{
+		SA_pos=LF_map(SA_pos,Basic_BWT);
+		steps++;
+	};
+	return Basic_BWT->SA_samples[SA_sample_rank(SA_pos,Basic_BWT)]+steps;
+};
+
+int Basic_BWT_batch_locate(const unsigned int * SA_pos,unsigned int nelements,
+		unsigned int * output_vector,Basic_BWT_t * Basic_BWT,unsigned int cores)
+{
+	int i;
+	if(Basic_BWT->SA_sample_rate==0)
+		return -1;
+	#pragma omp parallel for schedule(static) num_threads(cores)
+	for(i=0;i<(int)nelements;i++)
+		output_vector[i]=Basic_BWT_locate(SA_pos[i],Basic_BWT);
+	return 0;
+};
+
 int Basic_BWT_batch_extract(unsigned int * bitvector,
 		unsigned int nelements,unsigned int * output_vector,
 		Basic_BWT_t * Basic_BWT)
@@ -155,6 +429,7 @@ Basic_BWT_t * Build_BWT_index_from_text(unsigned char * text,
 	unsigned int i;
 	unsigned int char_count[4];
 	unsigned char * temp_BWT=0;
+	phase_begin("bwt");
 #ifdef use_dbwt
 	temp_BWT=dbwt_bwt(text,textlen,&Basic_BWT->primary_idx,
 		options);
@@ -167,8 +442,8 @@ Basic_BWT_t * Build_BWT_index_from_text(unsigned char * text,
 	int build_res;
 	int * SA_array;
 	unsigned int SA_val;
-	temp_BWT=(unsigned char *)malloc(textlen+1);
-	SA_array=(int *)malloc(textlen*sizeof(int));
+	temp_BWT=(unsigned char *)mem_malloc(mem_construction,textlen+1);
+	SA_array=(int *)mem_malloc(mem_construction,textlen*sizeof(int));
 	build_res=divsufsort(text,SA_array,textlen);	
 	if(build_res!=0)
 	{
@@ -189,6 +464,7 @@ Basic_BWT_t * Build_BWT_index_from_text(unsigned char * text,
 			temp_BWT[i+1]=text[SA_val-1];
 	};
 #endif
+	phase_next("pack");
 	Basic_BWT->indexed_BWT=build_basic_DNA5_seq(temp_BWT,textlen+1,
 		&Basic_BWT->size,char_count);
 	if(Basic_BWT->indexed_BWT==NULL)
@@ -206,10 +482,11 @@ Basic_BWT_t * Build_BWT_index_from_text(unsigned char * text,
 //		Basic_BWT->char_base[3],Basic_BWT->char_base[4]);
 	Basic_BWT->textlen=textlen;
 return_point:
+	phase_end();
 #ifndef use_dbwt
-	free(SA_array);
+	mem_free(mem_construction,SA_array,textlen*sizeof(int));
 #endif
-	free(temp_BWT);
+	mem_free(mem_construction,temp_BWT,textlen+1);
 	return Basic_BWT;
 };
 
@@ -13,6 +13,18 @@ typedef struct
 	unsigned int size;
 	unsigned int primary_idx;
 	unsigned int textlen;
+	// Optional sampled suffix array: SA_sample_marks has a bit set for every
+	// SA index whose text position is a multiple of SA_sample_rate, and
+	// SA_samples[rank] holds that text position. SA_sample_rate==0 means
+	// that no samples were built.
+	unsigned int SA_sample_rate;
+	unsigned int * SA_sample_marks;
+	unsigned int * SA_sample_ranks;
+	unsigned int * SA_samples;
+	// Read-only mapping of an index file (Basic_BWT_attach) holding
+	// indexed_BWT, NULL if indexed_BWT was allocated
+	void * mapping;
+	size_t mapping_size;
 } Basic_BWT_t;
 static inline unsigned char DNA5_BWT_get_prev_char(Basic_BWT_t * Basic_BWT,unsigned int suff_idx)
 {
@@ -38,5 +50,15 @@ unsigned int LF_map(unsigned int in_pos,Basic_BWT_t * Basic_BWT);
 int Basic_BWT_batch_extract(unsigned int * bitvector,
 		unsigned int nelements,unsigned int * output_vector,
 		Basic_BWT_t * Basic_BWT);
+int Basic_BWT_save(Basic_BWT_t * Basic_BWT,const char * path);
+Basic_BWT_t * Basic_BWT_load(const char * path);
+Basic_BWT_t * Basic_BWT_attach(const char * path);
+unsigned int * Basic_BWT_document_array(Basic_BWT_t * Basic_BWT,
+		const unsigned int * doc_starts,unsigned int ndocs);
+int Basic_BWT_build_SA_samples(Basic_BWT_t * Basic_BWT,unsigned int sample_rate);
+void Basic_BWT_free_SA_samples(Basic_BWT_t * Basic_BWT);
+unsigned int Basic_BWT_locate(unsigned int SA_pos,Basic_BWT_t * Basic_BWT);
+int Basic_BWT_batch_locate(const unsigned int * SA_pos,unsigned int nelements,
+		unsigned int * output_vector,Basic_BWT_t * Basic_BWT,unsigned int cores);
 
 #endif
@@ -3,6 +3,11 @@
 #include<stdlib.h>
 #include <string.h>
 #include"SLT.h"
+#include"phase_log.h"
+#include"SLT_instrument.h"
+#include"SLT_checkpoint.h"
+#include"SLT_distributed.h"
+#include"mem_account.h"
 
 
 static inline void swap2_stack_items(SLT_stack_item_t * SLT_stack_item1,
@@ -92,11 +97,15 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 	Basic_BWT_t * BBWT2=SLT_iterator->BBWT2;
 	unsigned int options=SLT_iterator->options;
 	unsigned int j1,j2;
+	SLT_counters_declare;
 	// Allocate the stack
-	SLT_stack_item_t * SLT_stack=(SLT_stack_item_t *)malloc((min_SLT_stack_size+1)*sizeof(SLT_stack_item_t));
+	SLT_stack_item_t * SLT_stack;
 
+	phase_begin("master");
+	SLT_instrument(SLT_instrument_master_begin(SLT_iterator->cores));
+	SLT_stack=(SLT_stack_item_t *)mem_malloc(mem_stacks,(min_SLT_stack_size+1)*sizeof(SLT_stack_item_t));
 	//Allocate the stacks for the parallelization
-	SLT_stack_item_t * slave_stack_item= (SLT_stack_item_t *) malloc((1<<2*max_d)*sizeof(SLT_stack_item_t));
+	SLT_stack_item_t * slave_stack_item= (SLT_stack_item_t *) mem_malloc(mem_stacks,(1<<2*max_d)*sizeof(SLT_stack_item_t));
 	void** slave_intern_state= malloc((1<<2*max_d)*sizeof(SLT_iterator->intern_state));
 
 	// Push the root node on the stack
@@ -124,6 +133,7 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 	{
 		// Pop a node from the stack
 		curr_stack_idx--;
+		SLT_count_node(curr_stack_idx+1);
 		// Set the first rank query points
 		pref_count_query_points1[0]=
 				SLT_stack[curr_stack_idx].interval_start1-1;
@@ -144,6 +154,8 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 		SLT_params.string_depth=SLT_stack[curr_stack_idx].string_depth;
 		SLT_params.interval_size1=SLT_stack[curr_stack_idx].interval_size1;
 		SLT_params.interval_size2=SLT_stack[curr_stack_idx].interval_size2;
+		SLT_params.interval_start1=SLT_stack[curr_stack_idx].interval_start1;
+		SLT_params.interval_start2=SLT_stack[curr_stack_idx].interval_start2;
 		SLT_params.right_extension_bitmap1=0;
 		SLT_params.right_extension_bitmap2=0;
 		for(i=1,j=1;i<7;i++)
@@ -180,11 +192,15 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 				npref_query_points1--;
 				DNA5_multipe_char_pref_counts(BBWT1->indexed_BWT,npref_query_points1,
 						&pref_count_query_points1[1],&char_pref_counts1[4]);
+				SLT_count_rank(npref_query_points1);
 				npref_query_points1++;
 			}
 			else
+			{
 				DNA5_multipe_char_pref_counts(BBWT1->indexed_BWT,npref_query_points1,
 						pref_count_query_points1,char_pref_counts1);
+				SLT_count_rank(npref_query_points1);
+			}
 			includes_EOT_char1=((BBWT1->primary_idx>=(pref_count_query_points1[0]+1))&&
 					(BBWT1->primary_idx<=pref_count_query_points1[npref_query_points1-1]));
 			SLT_params.nleft_extensions1=includes_EOT_char1;
@@ -207,11 +223,15 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 				npref_query_points2--;
 				DNA5_multipe_char_pref_counts(BBWT2->indexed_BWT,npref_query_points2,
 						&pref_count_query_points2[1],&char_pref_counts2[4]);
+				SLT_count_rank(npref_query_points2);
 				npref_query_points2++;
 			}
 			else
+			{
 				DNA5_multipe_char_pref_counts(BBWT2->indexed_BWT,npref_query_points2,
 						pref_count_query_points2,char_pref_counts2);
+				SLT_count_rank(npref_query_points2);
+			}
 			includes_EOT_char2=((BBWT2->primary_idx>=(pref_count_query_points2[0]+1))&&
 					(BBWT2->primary_idx<=pref_count_query_points2[npref_query_points2-1]));
 			SLT_params.nleft_extensions2=includes_EOT_char2;
@@ -331,7 +351,7 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 						SLT_params.left_right_extension_freqs2[1][5]>=2)))
 		{
 			if(string_depth==max_d) {
-				SLT_stack[curr_stack_idx].WL_char=1;
+				slave_stack_item[t].WL_char=1;
 				slave_stack_item[t].string_depth=string_depth;
 				includes_EOT_char1=(BBWT1->primary_idx<(pref_count_query_points1[0]+1));
 				includes_EOT_char2=(BBWT2->primary_idx<(pref_count_query_points2[0]+1));
@@ -350,8 +370,8 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 				if(curr_stack_size<=curr_stack_idx)
 				{
 					curr_stack_size*=2;
-					SLT_stack=(SLT_stack_item_t*)realloc(SLT_stack,
-							sizeof(SLT_stack_item_t)*(curr_stack_size+1));
+					SLT_stack=(SLT_stack_item_t*)mem_realloc(mem_stacks,SLT_stack,
+							sizeof(SLT_stack_item_t)*(curr_stack_size+1),sizeof(SLT_stack_item_t)*(curr_stack_size/2+1));
 				};
 				SLT_stack[curr_stack_idx].WL_char=1;
 				SLT_stack[curr_stack_idx].string_depth=string_depth;
@@ -369,6 +389,7 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 				max_sum_interval_size=sum_interval_size;
 				nexplicit_WL++;
 				curr_stack_idx++;
+				SLT_count_push();
 			}
 		}
 		// Then push nodes labelled with other characters
@@ -433,8 +454,8 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 					if(curr_stack_size<=curr_stack_idx)
 					{
 						curr_stack_size*=2;
-						SLT_stack=(SLT_stack_item_t*)realloc(SLT_stack,
-								sizeof(SLT_stack_item_t)*(curr_stack_size+1));
+						SLT_stack=(SLT_stack_item_t*)mem_realloc(mem_stacks,SLT_stack,
+								sizeof(SLT_stack_item_t)*(curr_stack_size+1),sizeof(SLT_stack_item_t)*(curr_stack_size/2+1));
 					};
 					SLT_stack[curr_stack_idx].WL_char=i+1;
 					SLT_stack[curr_stack_idx].string_depth=string_depth;
@@ -453,6 +474,7 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 					};
 					nexplicit_WL++;
 					curr_stack_idx++;
+					SLT_count_push();
 				};
 			}
 		};
@@ -466,17 +488,65 @@ void SLT_joint_execute_iterator(SLT_joint_iterator_t * SLT_iterator)
 				swap2_stack_items(&SLT_stack[curr_stack_idx-nexplicit_WL+j],
 						&SLT_stack[curr_stack_idx-j-1]);
 		};
-		SLT_iterator->SLT_callback(&SLT_params,SLT_iterator->intern_state, SLT_iterator->mem);
+		SLT_timed_callback(SLT_iterator->SLT_callback(&SLT_params,SLT_iterator->intern_state, SLT_iterator->mem));
 		for(; t2<t;t2++)
 			slave_intern_state[t2]=SLT_iterator->SLT_cloner(SLT_iterator->intern_state, t2);
 	}while(curr_stack_idx);
+	SLT_counters_flush();
 	SLT_iterator->SLT_free(SLT_iterator->intern_state, SLT_iterator->mem);
-	omp_set_num_threads(SLT_iterator->cores);
-	#pragma omp parallel for schedule(dynamic)
-	for(i=0; i<t; i++) {
-		SLT_slave(SLT_iterator, slave_stack_item[i], slave_intern_state[i]);
-	}
+	phase_next("slaves");
+	SLT_instrument(SLT_instrument_slaves_begin(t));
+	if(SLT_iterator->distributed_dir)
+		SLT_distributed_slaves(SLT_iterator,t,slave_stack_item,slave_intern_state);
+	else
+	{
+		// Tasks completed, by this run or by the run of the checkpoint
+		unsigned char * task_done=NULL;
+		double last_checkpoint=phase_wall_time();
+		if(SLT_iterator->checkpoint_path)
+		{
+			task_done=(unsigned char *)calloc(t,1);
+			SLT_checkpoint_read(SLT_iterator,t,task_done,slave_intern_state);
+			// SLT_slave frees the clones of the tasks it runs
+			for(i=0; i<t; i++)
+				if(task_done[i])
+					SLT_iterator->SLT_free(slave_intern_state[i], SLT_iterator->mem);
+		};
+		omp_set_num_threads(SLT_iterator->cores);
+		#pragma omp parallel for schedule(dynamic)
+		for(i=0; i<t; i++) {
+			if(task_done && task_done[i])
+				continue;
+			SLT_instrument(SLT_instrument_task_begin(i,slave_stack_item[i].interval_size1,
+					slave_stack_item[i].interval_size2));
+			SLT_slave(SLT_iterator, slave_stack_item[i], slave_intern_state[i]);
+			SLT_instrument(SLT_instrument_task_end());
+			if(task_done) {
+				#pragma omp critical(SLT_checkpoint)
+				{
+					task_done[i]=1;
+					if(phase_wall_time()-last_checkpoint>=SLT_iterator->checkpoint_interval) {
+						if(SLT_checkpoint_write(SLT_iterator,t,task_done,slave_intern_state)!=0)
+							fprintf(stderr," Warning: Cannot write checkpoint %s\n",SLT_iterator->checkpoint_path);
+						last_checkpoint=phase_wall_time();
+					}
+				}
+			}
+		}
+		if(task_done)
+		{
+			remove(SLT_iterator->checkpoint_path);
+			free(task_done);
+		};
+	};
+	SLT_instrument(SLT_instrument_slaves_end());
+	phase_next("combine");
 	SLT_iterator->SLT_combiner(slave_intern_state, SLT_iterator->intern_state,t, SLT_iterator->mem);
+	SLT_instrument(SLT_instrument_combine_end());
+	phase_end();
+	// The combiner frees slave_intern_state
+	mem_free(mem_stacks,SLT_stack,(curr_stack_size+1)*sizeof(SLT_stack_item_t));
+	mem_free(mem_stacks,slave_stack_item,(1<<2*max_d)*sizeof(SLT_stack_item_t));
 };
 
 
@@ -518,8 +588,9 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 	Basic_BWT_t * BBWT2=SLT_iterator->BBWT2;
 	unsigned int options=SLT_iterator->options;
 	unsigned int j1,j2;
+	SLT_counters_declare;
 	// Allocate the stack
-	SLT_stack_item_t * SLT_stack=(SLT_stack_item_t *)malloc((min_SLT_stack_size+1)*sizeof(SLT_stack_item_t));
+	SLT_stack_item_t * SLT_stack=(SLT_stack_item_t *)mem_malloc(mem_stacks,(min_SLT_stack_size+1)*sizeof(SLT_stack_item_t));
 	memcpy(SLT_stack,&stack_item,sizeof(SLT_stack_item_t));
 
 	curr_stack_idx++;
@@ -528,6 +599,7 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 	{
 		// Pop a node from the stack
 		curr_stack_idx--;
+		SLT_count_node(curr_stack_idx+1);
 		// Set the first rank query points
 		pref_count_query_points1[0]=
 				SLT_stack[curr_stack_idx].interval_start1-1;
@@ -548,6 +620,8 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 		SLT_params.string_depth=SLT_stack[curr_stack_idx].string_depth;
 		SLT_params.interval_size1=SLT_stack[curr_stack_idx].interval_size1;
 		SLT_params.interval_size2=SLT_stack[curr_stack_idx].interval_size2;
+		SLT_params.interval_start1=SLT_stack[curr_stack_idx].interval_start1;
+		SLT_params.interval_start2=SLT_stack[curr_stack_idx].interval_start2;
 		SLT_params.right_extension_bitmap1=0;
 		SLT_params.right_extension_bitmap2=0;
 		for(i=1,j=1;i<7;i++)
@@ -584,11 +658,15 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 				npref_query_points1--;
 				DNA5_multipe_char_pref_counts(BBWT1->indexed_BWT,npref_query_points1,
 						&pref_count_query_points1[1],&char_pref_counts1[4]);
+				SLT_count_rank(npref_query_points1);
 				npref_query_points1++;
 			}
 			else
+			{
 				DNA5_multipe_char_pref_counts(BBWT1->indexed_BWT,npref_query_points1,
 						pref_count_query_points1,char_pref_counts1);
+				SLT_count_rank(npref_query_points1);
+			}
 			includes_EOT_char1=((BBWT1->primary_idx>=(pref_count_query_points1[0]+1))&&
 					(BBWT1->primary_idx<=pref_count_query_points1[npref_query_points1-1]));
 			SLT_params.nleft_extensions1=includes_EOT_char1;
@@ -611,11 +689,15 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 				npref_query_points2--;
 				DNA5_multipe_char_pref_counts(BBWT2->indexed_BWT,npref_query_points2,
 						&pref_count_query_points2[1],&char_pref_counts2[4]);
+				SLT_count_rank(npref_query_points2);
 				npref_query_points2++;
 			}
 			else
+			{
 				DNA5_multipe_char_pref_counts(BBWT2->indexed_BWT,npref_query_points2,
 						pref_count_query_points2,char_pref_counts2);
+				SLT_count_rank(npref_query_points2);
+			}
 			includes_EOT_char2=((BBWT2->primary_idx>=(pref_count_query_points2[0]+1))&&
 					(BBWT2->primary_idx<=pref_count_query_points2[npref_query_points2-1]));
 			SLT_params.nleft_extensions2=includes_EOT_char2;
@@ -732,8 +814,8 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 			if(curr_stack_size<=curr_stack_idx)
 			{
 				curr_stack_size*=2;
-				SLT_stack=(SLT_stack_item_t*)realloc(SLT_stack,
-						sizeof(SLT_stack_item_t)*(curr_stack_size+1));
+				SLT_stack=(SLT_stack_item_t*)mem_realloc(mem_stacks,SLT_stack,
+						sizeof(SLT_stack_item_t)*(curr_stack_size+1),sizeof(SLT_stack_item_t)*(curr_stack_size/2+1));
 			};
 			SLT_stack[curr_stack_idx].WL_char=1;
 			SLT_stack[curr_stack_idx].string_depth=string_depth;
@@ -751,6 +833,7 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 			max_sum_interval_size=sum_interval_size;
 			nexplicit_WL++;
 			curr_stack_idx++;
+			SLT_count_push();
 		}
 		// Then push nodes labelled with other characters
 		for(i=1;i<4;i++)
@@ -797,8 +880,8 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 				if(curr_stack_size<=curr_stack_idx)
 				{
 					curr_stack_size*=2;
-					SLT_stack=(SLT_stack_item_t*)realloc(SLT_stack,
-							sizeof(SLT_stack_item_t)*(curr_stack_size+1));
+					SLT_stack=(SLT_stack_item_t*)mem_realloc(mem_stacks,SLT_stack,
+							sizeof(SLT_stack_item_t)*(curr_stack_size+1),sizeof(SLT_stack_item_t)*(curr_stack_size/2+1));
 				};
 				SLT_stack[curr_stack_idx].WL_char=i+1;
 				SLT_stack[curr_stack_idx].string_depth=string_depth;
@@ -817,6 +900,7 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 				};
 				nexplicit_WL++;
 				curr_stack_idx++;
+				SLT_count_push();
 			};
 		};
 
@@ -829,8 +913,9 @@ void SLT_slave(SLT_joint_iterator_t * SLT_iterator, SLT_stack_item_t stack_item,
 				swap2_stack_items(&SLT_stack[curr_stack_idx-nexplicit_WL+j],
 						&SLT_stack[curr_stack_idx-j-1]);
 		};
-		SLT_iterator->SLT_callback(&SLT_params,intern_state, SLT_iterator->mem);
+		SLT_timed_callback(SLT_iterator->SLT_callback(&SLT_params,intern_state, SLT_iterator->mem));
 	}while(curr_stack_idx);
+	SLT_counters_flush();
 	SLT_iterator->SLT_free(intern_state, SLT_iterator->mem);
-	//free(SLT_stack);
+	mem_free(mem_stacks,SLT_stack,(curr_stack_size+1)*sizeof(SLT_stack_item_t));
 };
@@ -1,5 +1,6 @@
 #ifndef SLT_h
 #define SLT_h
+#include<stdio.h>
 #include"indexed_DNA5_seq.h"
 #include"DNA5_Basic_BWT.h"
 
@@ -18,6 +19,10 @@ typedef struct
 	unsigned int left_right_extension_freqs2[6][6];
 	unsigned int interval_size1;
 	unsigned int interval_size2;
+	// First BWT row of the interval of W in each text (row 0 is the '$' row,
+	// so the SA index used by Basic_BWT_locate is interval_start-1)
+	unsigned int interval_start1;
+	unsigned int interval_start2;
 	unsigned int WL_char;
 } SLT_joint_params_t;
 
@@ -25,6 +30,8 @@ typedef void (*SLT_joint_callback_t)(const SLT_joint_params_t * SLT_params,void
 typedef void* (*SLT_cloner_t)(void* p, unsigned int t);
 typedef void (*SLT_combiner_t)(void** intern_state, void* state, unsigned int t, unsigned int mem);
 typedef void (*SLT_free_t)(void* intern_state, unsigned int mem);
+typedef int (*SLT_state_writer_t)(const void* intern_state, FILE* f);
+typedef int (*SLT_state_reader_t)(void* intern_state, FILE* f);
 
 #ifndef SLT_arbitrary_order
 #define SLT_arbitrary_order 0
@@ -55,6 +62,20 @@ typedef struct
 	Basic_BWT_t * BBWT2;
 	unsigned int mem;
 	unsigned int cores;
+	// Checkpoints of the slave tasks, set by SLT_joint_set_checkpoint; no
+	// checkpoint if checkpoint_path is NULL
+	const char * checkpoint_path;
+	double checkpoint_interval;
+	// Slave tasks shared with other processes, set by
+	// SLT_joint_set_distributed; none if distributed_dir is NULL
+	const char * distributed_dir;
+	unsigned int distributed_role;
+	double distributed_timeout;
+	// The slave states written to and read from files, and the tag of the
+	// computation they belong to
+	unsigned long long state_tag;
+	SLT_state_writer_t SLT_write_state;
+	SLT_state_reader_t SLT_read_state;
 } SLT_joint_iterator_t;
 
 typedef struct
@@ -85,6 +106,8 @@ static inline SLT_joint_iterator_t * new_SLT_joint_iterator(SLT_joint_callback_t
 	SLT_iterator->options=options;
 	SLT_iterator->mem=mem;
 	SLT_iterator->cores= cores;
+	SLT_iterator->checkpoint_path=NULL;
+	SLT_iterator->distributed_dir=NULL;
 	return SLT_iterator;
 };
 
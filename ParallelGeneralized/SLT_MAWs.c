@@ -3,17 +3,52 @@
 #include"SLT_MAWs.h"
 #include <string.h>
 #include"SLT.h"
+#include"SLT_multi.h"
 #include <math.h>
 #include "basic_bitvec.h"
+#include "mem_account.h"
+#include "SLT_checkpoint.h"
+#include "SLT_distributed.h"
 
 
 #define alloc_growth_num 4
 #define alloc_growth_denom 3
+// Number of string depths covered by the shared g tables. Deeper nodes
+// extend a thread-local overflow of the prefix sums instead.
+#define MAWs_g_table_size (1<<16)
 static unsigned int length1;
 static unsigned int length2;
 static unsigned int F1;
 static unsigned int F2;
 
+// g(y) and the prefix sums of its squared deviation (g(k)-1)^2 for one text
+typedef struct
+{
+	unsigned int length;
+	double * g;
+	double * prefix_sum;
+} MAWs_g_table_t;
+
+typedef struct MAWs_g_tables
+{
+	unsigned int size;
+	MAWs_g_table_t t1;
+	MAWs_g_table_t t2;
+	double * prefix_sumN;
+} MAWs_g_tables_t;
+
+// The g values and prefix sums the kernel callback needs at one node
+typedef struct
+{
+	double g1;
+	double g2;
+	double prefix_sum1;
+	double prefix_sum2;
+	double prev_sum1;
+	double prev_sum2;
+	double prev_sumN;
+} MAWs_g_values_t;
+
 
 typedef struct 
 {
@@ -33,12 +68,23 @@ typedef struct
 	double N;
 	double D1;
 	double D2;
+	const struct MAWs_g_tables * g_tables;
 	double * prefix_sum1;
 	double * prefix_sum2;
 	double * prefix_sumN;
 	unsigned int prefix_capacity;
 	double * KL;
 	unsigned int KL_capacity;
+	SLT_joint_callback_t callback;
+	unsigned int record_hist;
+	MAWs_histogram_t hist;
+	MAWs_topk_t topk;
+	unsigned int topk_scratch_capacity;
+	unsigned char * topk_scratch;
+	Basic_BWT_t * BBWT1;
+	Basic_BWT_t * BBWT2;
+	unsigned int witnesses;
+	unsigned int canonical_filter;
 
 	FILE *file;
 
@@ -52,6 +98,503 @@ static inline unsigned int is_powof2(unsigned int x)
 };
 static unsigned char alpha4_to_ACGT[4]={'A','C','G','T'};
 
+// Is the word aWb (a=i, b=j, W on the char stack) lexicographically not
+// larger than its reverse complement? On a text followed by its reverse
+// complement exactly one word of each pair is, or both if aWb is its own
+// reverse complement.
+static inline unsigned int MAWs_is_canonical(const MAWs_callback_state_t * state,unsigned int depth,
+		unsigned int i,unsigned int j)
+{
+	unsigned int k,c1,c2;
+	// Codes are 1..4 for A, C, G, T, so the complement of c is 5-c
+	if(i!=5-j)
+		return i<5-j;
+	for(k=0;k<depth/2;k++) {
+		c1=state->char_stack[depth-1-k];
+		c2=5-state->char_stack[k];
+		if(c1!=c2)
+			return c1<c2;
+	}
+	// The middle character of an odd length W never equals its complement
+	if(depth&1)
+		return state->char_stack[depth/2]<5-state->char_stack[depth/2];
+	return 1;
+};
+
+// Room needed in MAW_buffer by the witnesses of one MAW: four tab separated
+// 32-bit positions and the terminating zero written by sprintf
+#define MAWs_witness_room 48
+
+// SA index of the first suffix prefixed by cW, where W has its interval
+// starting at BWT row interval_start and c is an ACGT code
+static unsigned int MAWs_left_extension_SA_pos(Basic_BWT_t * BBWT,unsigned int interval_start,unsigned int c)
+{
+	unsigned int counts[4]={0,0,0,0};
+	if(interval_start>0) {
+		DNA5_get_char_pref_counts(counts,BBWT->indexed_BWT,interval_start-1);
+		if(c==0 && interval_start-1>=BBWT->primary_idx)
+			counts[0]--;
+	}
+	return BBWT->char_base[c]+counts[c];
+};
+
+// Append the text positions of aW and Wb in the genomes selected by the
+// genomes bitmask (a=i, b=j) to the MAW being written
+static void MAWs_write_witnesses(MAWs_callback_state_t * state,const SLT_joint_params_t * SLT_joint_params,
+		unsigned int i,unsigned int j,unsigned int genomes)
+{
+	const unsigned int (*freqs)[6];
+	Basic_BWT_t * BBWT;
+	unsigned int interval_start,SA_pos,g,h,k;
+	for(g=0;g<2;g++) {
+		if(!(genomes&(1<<g)))
+			continue;
+		BBWT=g?state->BBWT2:state->BBWT1;
+		freqs=g?SLT_joint_params->left_right_extension_freqs2:SLT_joint_params->left_right_extension_freqs1;
+		interval_start=g?SLT_joint_params->interval_start2:SLT_joint_params->interval_start1;
+		// aW: the first occurrence of W preceded by a
+		SA_pos=MAWs_left_extension_SA_pos(BBWT,interval_start,i-1);
+		state->MAW_buffer_idx+=sprintf((char *)state->MAW_buffer+state->MAW_buffer_idx,"\t%u",
+				Basic_BWT_locate(SA_pos,BBWT));
+		// Wb: skip the occurrences of W followed by a character smaller than b
+		SA_pos=interval_start-1;
+		for(h=0;h<j;h++)
+			for(k=0;k<6;k++)
+				SA_pos+=freqs[k][h];
+		state->MAW_buffer_idx+=sprintf((char *)state->MAW_buffer+state->MAW_buffer_idx,"\t%u",
+				Basic_BWT_locate(SA_pos,BBWT));
+	}
+};
+
+static void * grow_zeroed(void * ptr, size_t elem_size, unsigned int old_capacity, unsigned int new_capacity)
+{
+	ptr=realloc(ptr,new_capacity*elem_size);
+	memset((unsigned char *)ptr+old_capacity*elem_size,0,(new_capacity-old_capacity)*elem_size);
+	return ptr;
+};
+
+static void MAWs_histogram_reserve(MAWs_histogram_t * hist, unsigned int length)
+{
+	unsigned int old_capacity=hist->capacity;
+	if(length<=old_capacity)
+		return;
+	while(hist->capacity<length)
+		hist->capacity=(hist->capacity+2)*alloc_growth_num/alloc_growth_denom;
+	hist->nMAWs=grow_zeroed(hist->nMAWs,sizeof(unsigned int),old_capacity,hist->capacity);
+	hist->nMAWs1=grow_zeroed(hist->nMAWs1,sizeof(unsigned int),old_capacity,hist->capacity);
+	hist->nMAWs2=grow_zeroed(hist->nMAWs2,sizeof(unsigned int),old_capacity,hist->capacity);
+	hist->LW=grow_zeroed(hist->LW,sizeof(double),old_capacity,hist->capacity);
+	hist->N=grow_zeroed(hist->N,sizeof(double),old_capacity,hist->capacity);
+	hist->D1=grow_zeroed(hist->D1,sizeof(double),old_capacity,hist->capacity);
+	hist->D2=grow_zeroed(hist->D2,sizeof(double),old_capacity,hist->capacity);
+};
+
+static void MAWs_histogram_release(MAWs_histogram_t * hist)
+{
+	free(hist->nMAWs);
+	free(hist->nMAWs1);
+	free(hist->nMAWs2);
+	free(hist->LW);
+	free(hist->N);
+	free(hist->D1);
+	free(hist->D2);
+	memset(hist,0,sizeof(MAWs_histogram_t));
+};
+
+MAWs_histogram_t * new_MAWs_histogram()
+{
+	return (MAWs_histogram_t *) calloc(1,sizeof(MAWs_histogram_t));
+};
+
+void free_MAWs_histogram(MAWs_histogram_t * hist)
+{
+	if(hist)
+	{
+		MAWs_histogram_release(hist);
+		free(hist);
+	};
+};
+
+void MAWs_histogram_merge(MAWs_histogram_t * dst, const MAWs_histogram_t * src)
+{
+	unsigned int d;
+	MAWs_histogram_reserve(dst,src->length);
+	for(d=0;d<src->length;d++) {
+		dst->nMAWs[d]+=src->nMAWs[d];
+		dst->nMAWs1[d]+=src->nMAWs1[d];
+		dst->nMAWs2[d]+=src->nMAWs2[d];
+		dst->LW[d]+=src->LW[d];
+		dst->N[d]+=src->N[d];
+		dst->D1[d]+=src->D1[d];
+		dst->D2[d]+=src->D2[d];
+	}
+	if(src->length>dst->length)
+		dst->length=src->length;
+};
+
+void MAWs_histogram_write(const MAWs_histogram_t * hist, FILE * out)
+{
+	unsigned int d;
+	fprintf(out,"string_depth\tMAW_length\tnMAWs\tnMAWs1\tnMAWs2\tLW\tN\tD1\tD2\n");
+	for(d=0;d<hist->length;d++)
+		fprintf(out,"%u\t%u\t%u\t%u\t%u\t%.17g\t%.17g\t%.17g\t%.17g\n",d,d+2,
+				hist->nMAWs[d],hist->nMAWs1[d],hist->nMAWs2[d],
+				hist->LW[d],hist->N[d],hist->D1[d],hist->D2[d]);
+};
+
+double MAWs_weight_inverse_square(unsigned int len, const double * params)
+{
+	return (double)1/((double)len*len);
+};
+
+double MAWs_weight_power(unsigned int len, const double * params)
+{
+	return pow(len,-params[0]);
+};
+
+double MAWs_weight_exponential(unsigned int len, const double * params)
+{
+	return exp(-params[0]*len);
+};
+
+double MAWs_weight_window(unsigned int len, const double * params)
+{
+	return (len>=params[0] && len<=params[1])?1:0;
+};
+
+// Parse a weighting given as name[:param[:param]], e.g. "exp:0.5" or "window:8:12".
+int MAWs_parse_weighting(const char * spec, MAWs_weighting_t * weighting)
+{
+	const char * sep=strchr(spec,':');
+	size_t name_len=sep?(size_t)(sep-spec):strlen(spec);
+	unsigned int nparams=0;
+	unsigned int needed;
+	char * end;
+
+	weighting->name=spec;
+	weighting->value=0;
+	weighting->params[0]=0;
+	weighting->params[1]=0;
+	if(name_len==5 && strncmp(spec,"invsq",5)==0) {
+		weighting->weight=MAWs_weight_inverse_square;
+		needed=0;
+	}
+	else if(name_len==5 && strncmp(spec,"power",5)==0) {
+		weighting->weight=MAWs_weight_power;
+		needed=1;
+	}
+	else if(name_len==3 && strncmp(spec,"exp",3)==0) {
+		weighting->weight=MAWs_weight_exponential;
+		needed=1;
+	}
+	else if(name_len==6 && strncmp(spec,"window",6)==0) {
+		weighting->weight=MAWs_weight_window;
+		needed=2;
+	}
+	else
+		return -1;
+	while(sep && nparams<2) {
+		weighting->params[nparams++]=strtod(sep+1,&end);
+		if(end==sep+1)
+			return -1;
+		sep=(*end==':')?end:NULL;
+	}
+	return (nparams==needed && sep==NULL)?0:-1;
+};
+
+// Evaluate all the weightings over the symmetric difference of the two MAW
+// sets, one table lookup per length instead of one evaluation per MAW.
+void MAWs_weightings_evaluate(const MAWs_histogram_t * hist, MAWs_weighting_t * weightings, unsigned int nweightings)
+{
+	unsigned int w,d;
+	double * table=(double *)malloc((hist->length+1)*sizeof(double));
+	for(w=0;w<nweightings;w++) {
+		for(d=0;d<hist->length;d++)
+			table[d]=weightings[w].weight(d+2,weightings[w].params);
+		weightings[w].value=0;
+		for(d=0;d<hist->length;d++)
+			weightings[w].value+=table[d]*((double)hist->nMAWs1[d]+hist->nMAWs2[d]-2.0*hist->nMAWs[d]);
+	}
+	free(table);
+};
+
+// Is entry e1 ranked below entry e2? Ties on the score go to the
+// lexicographically smaller word, so the kept set does not depend on the
+// order in which the slaves report their words.
+static int topk_ranks_below(double score1, const unsigned char * word1, unsigned int len1,
+		const MAWs_topk_entry_t * e2)
+{
+	int cmp;
+	if(score1!=e2->score)
+		return score1<e2->score;
+	cmp=memcmp(word1,e2->word,len1<e2->len?len1:e2->len);
+	if(cmp==0)
+		return len1>e2->len;
+	return cmp>0;
+};
+
+static void topk_sift_down(MAWs_topk_t * topk, unsigned int i)
+{
+	MAWs_topk_entry_t tmp;
+	unsigned int child;
+	while((child=2*i+1)<topk->n) {
+		if(child+1<topk->n && topk_ranks_below(topk->heap[child+1].score,topk->heap[child+1].word,
+				topk->heap[child+1].len,&topk->heap[child]))
+			child++;
+		if(!topk_ranks_below(topk->heap[child].score,topk->heap[child].word,topk->heap[child].len,&topk->heap[i]))
+			break;
+		tmp=topk->heap[i];
+		topk->heap[i]=topk->heap[child];
+		topk->heap[child]=tmp;
+		i=child;
+	}
+};
+
+static void topk_sift_up(MAWs_topk_t * topk, unsigned int i)
+{
+	MAWs_topk_entry_t tmp;
+	while(i>0 && topk_ranks_below(topk->heap[i].score,topk->heap[i].word,topk->heap[i].len,
+			&topk->heap[(i-1)/2])) {
+		tmp=topk->heap[i];
+		topk->heap[i]=topk->heap[(i-1)/2];
+		topk->heap[(i-1)/2]=tmp;
+		i=(i-1)/2;
+	}
+};
+
+// Would a word with this score make it into the heap, before building it?
+static inline int topk_may_accept(const MAWs_topk_t * topk, double score)
+{
+	return topk->n<topk->k || score>=topk->heap[0].score;
+};
+
+static void topk_push(MAWs_topk_t * topk, double score, const unsigned char * word, unsigned int len)
+{
+	MAWs_topk_entry_t * entry;
+	unsigned int i;
+	if(topk->heap==NULL)
+		topk->heap=(MAWs_topk_entry_t *)calloc(topk->k,sizeof(MAWs_topk_entry_t));
+	if(topk->n<topk->k) {
+		i=topk->n++;
+	}
+	else {
+		if(!topk_ranks_below(topk->heap[0].score,topk->heap[0].word,topk->heap[0].len,&(MAWs_topk_entry_t){score,len,0,(unsigned char *)word}))
+			return;
+		i=0;
+	}
+	entry=&topk->heap[i];
+	if(entry->word_capacity<len) {
+		entry->word_capacity=len;
+		entry->word=(unsigned char *)realloc(entry->word,len);
+	}
+	memcpy(entry->word,word,len);
+	entry->len=len;
+	entry->score=score;
+	if(i==0 && topk->n==topk->k)
+		topk_sift_down(topk,0);
+	else
+		topk_sift_up(topk,i);
+};
+
+static void MAWs_topk_release(MAWs_topk_t * topk)
+{
+	unsigned int i;
+	if(topk->heap) {
+		for(i=0;i<topk->k;i++)
+			free(topk->heap[i].word);
+		free(topk->heap);
+	}
+	topk->heap=NULL;
+	topk->n=0;
+};
+
+MAWs_topk_t * new_MAWs_topk(unsigned int k, unsigned int score_by)
+{
+	MAWs_topk_t * topk=(MAWs_topk_t *) calloc(1,sizeof(MAWs_topk_t));
+	topk->k=k;
+	topk->score_by=score_by;
+	return topk;
+};
+
+void free_MAWs_topk(MAWs_topk_t * topk)
+{
+	if(topk)
+	{
+		MAWs_topk_release(topk);
+		free(topk);
+	};
+};
+
+void MAWs_topk_merge(MAWs_topk_t * dst, const MAWs_topk_t * src)
+{
+	unsigned int i;
+	for(i=0;i<src->n;i++)
+		topk_push(dst,src->heap[i].score,src->heap[i].word,src->heap[i].len);
+};
+
+static int topk_entry_compar(const void * _e1, const void * _e2)
+{
+	const MAWs_topk_entry_t * e1=(const MAWs_topk_entry_t *)_e1;
+	const MAWs_topk_entry_t * e2=(const MAWs_topk_entry_t *)_e2;
+	if(topk_ranks_below(e1->score,e1->word,e1->len,e2))
+		return 1;
+	if(topk_ranks_below(e2->score,e2->word,e2->len,e1))
+		return -1;
+	return 0;
+};
+
+// Sort the kept words best first. The heap order is lost.
+void MAWs_topk_sort(MAWs_topk_t * topk)
+{
+	if(topk->n)
+		qsort(topk->heap,topk->n,sizeof(MAWs_topk_entry_t),topk_entry_compar);
+};
+
+void MAWs_topk_write(MAWs_topk_t * topk, FILE * out)
+{
+	unsigned int i;
+	MAWs_topk_sort(topk);
+	for(i=0;i<topk->n;i++) {
+		fwrite(topk->heap[i].word,1,topk->heap[i].len,out);
+		fprintf(out,"\t%.17g\n",(topk->score_by==MAWs_topk_by_length || topk->score_by==MAWs_topk_by_freq)?
+				-topk->heap[i].score:topk->heap[i].score);
+	}
+};
+
+static inline void MAWs_ext_freqs(const unsigned int freqs[6][6], unsigned int i, unsigned int j,
+		unsigned int * fw, unsigned int * faw, unsigned int * fwb)
+{
+	unsigned int h,k;
+	*fw=0;
+	*faw=0;
+	*fwb=0;
+	for(h=0; h<6; h++) {
+		*faw+= freqs[i][h];
+		*fwb+= freqs[h][j];
+		for(k=0; k<6; k++)
+			*fw+= freqs[h][k];
+	}
+};
+
+// Push the word aWb (a=i, b=j) with score to the top-k heap
+static void MAWs_topk_push_word(MAWs_callback_state_t * state, const SLT_joint_params_t * SLT_joint_params,
+		unsigned int i, unsigned int j, double score)
+{
+	unsigned int len=SLT_joint_params->string_depth+2;
+	unsigned int k;
+
+	if(!topk_may_accept(&state->topk,score))
+		return;
+	if(len>state->topk_scratch_capacity) {
+		state->topk_scratch=(unsigned char *)mem_realloc(mem_states,state->topk_scratch,
+				len*alloc_growth_num/alloc_growth_denom+1,state->topk_scratch_capacity);
+		state->topk_scratch_capacity=len*alloc_growth_num/alloc_growth_denom+1;
+	}
+	state->topk_scratch[0]=alpha4_to_ACGT[i-1];
+	for(k=0;k<SLT_joint_params->string_depth;k++)
+		state->topk_scratch[k+1]=alpha4_to_ACGT[state->char_stack[SLT_joint_params->string_depth-k-1]-1];
+	state->topk_scratch[len-1]=alpha4_to_ACGT[j-1];
+	topk_push(&state->topk,score,state->topk_scratch,len);
+};
+
+// Offer the word aWb (a=i, b=j) to the top-k heap. genomes has bit 0 (resp. 1)
+// set if the word is reported absent or rare in the first (resp. second) text.
+// Higher scores are kept, so the length and the frequency are negated.
+static void MAWs_topk_offer(MAWs_callback_state_t * state, const SLT_joint_params_t * SLT_joint_params,
+		unsigned int i, unsigned int j, unsigned int genomes)
+{
+	unsigned int fw,faw,fwb,k;
+	double score,genome_score;
+
+	if(state->topk.score_by==MAWs_topk_by_length)
+		score=-(double)(SLT_joint_params->string_depth+2);
+	else {
+		score=0;
+		for(k=0;k<2;k++) {
+			if(!(genomes&(1<<k)))
+				continue;
+			MAWs_ext_freqs(k?SLT_joint_params->left_right_extension_freqs2:SLT_joint_params->left_right_extension_freqs1,
+					i,j,&fw,&faw,&fwb);
+			if(state->topk.score_by==MAWs_topk_by_freq)
+				genome_score=faw<fwb?faw:fwb;
+			else
+				genome_score=(double)faw*fwb/fw;
+			if(k==0 || !(genomes&1) || genome_score<score)
+				score=genome_score;
+		}
+		if(state->topk.score_by==MAWs_topk_by_freq)
+			score=-score;
+	}
+	MAWs_topk_push_word(state,SLT_joint_params,i,j,score);
+};
+
+// Runs the selected callback on zeroed accumulators and files what it added
+// under the node's string depth, so each row is exact rather than the
+// difference of two large running sums.
+void SLT_callback_histogram(const SLT_joint_params_t * SLT_joint_params,void * intern_state, unsigned int mem)
+{
+	MAWs_callback_state_t * state= (MAWs_callback_state_t*)(intern_state);
+	unsigned int nMAWs=state->nMAWs;
+	unsigned int nMAWs1=state->nMAWs1;
+	unsigned int nMAWs2=state->nMAWs2;
+	double LW=state->LW;
+	double N=state->N;
+	double D1=state->D1;
+	double D2=state->D2;
+	unsigned int d=SLT_joint_params->string_depth;
+
+	state->nMAWs=0;
+	state->nMAWs1=0;
+	state->nMAWs2=0;
+	state->LW=0;
+	state->N=0;
+	state->D1=0;
+	state->D2=0;
+	state->callback(SLT_joint_params,intern_state,mem);
+	if(state->nMAWs || state->nMAWs1 || state->nMAWs2 || state->LW!=0
+			|| state->N!=0 || state->D1!=0 || state->D2!=0) {
+		MAWs_histogram_reserve(&state->hist,d+1);
+		state->hist.nMAWs[d]+=state->nMAWs;
+		state->hist.nMAWs1[d]+=state->nMAWs1;
+		state->hist.nMAWs2[d]+=state->nMAWs2;
+		state->hist.LW[d]+=state->LW;
+		state->hist.N[d]+=state->N;
+		state->hist.D1[d]+=state->D1;
+		state->hist.D2[d]+=state->D2;
+		if(d>=state->hist.length)
+			state->hist.length=d+1;
+	}
+	state->nMAWs+=nMAWs;
+	state->nMAWs1+=nMAWs1;
+	state->nMAWs2+=nMAWs2;
+	state->LW+=LW;
+	state->N+=N;
+	state->D1+=D1;
+	state->D2+=D2;
+}
+
+static SLT_joint_callback_t MAWs_select_callback(MAWs_callback_state_t * state, SLT_joint_callback_t callback)
+{
+	state->callback=callback;
+	return state->record_hist?SLT_callback_histogram:callback;
+};
+
+static void MAWs_finish_options(MAWs_callback_state_t * state, const MAWs_options_t * options)
+{
+	if(state->topk.k) {
+		MAWs_topk_merge(options->topk,&state->topk);
+		MAWs_topk_release(&state->topk);
+		mem_free(mem_states,state->topk_scratch,state->topk_scratch_capacity);
+	}
+	if(!state->record_hist)
+		return;
+	if(options->nweightings)
+		MAWs_weightings_evaluate(&state->hist,options->weightings,options->nweightings);
+	if(options->hist)
+		MAWs_histogram_merge(options->hist,&state->hist);
+	MAWs_histogram_release(&state->hist);
+};
+
 
 void SLT_callback_MAWs(const SLT_joint_params_t * SLT_joint_params,void * intern_state, unsigned int mem)
 {
@@ -62,14 +605,15 @@ void SLT_callback_MAWs(const SLT_joint_params_t * SLT_joint_params,void * intern
 
 	if(state->nMAW_capacity==0 && mem) {
 		state->nMAW_capacity=1<<16;
-		state->MAW_buffer=(unsigned char *) malloc(state->nMAW_capacity);
+		state->MAW_buffer=(unsigned char *) mem_malloc(mem_output,state->nMAW_capacity);
 	}
 	if(SLT_joint_params->string_depth!=0)
 	{
 		if(SLT_joint_params->string_depth>state->char_stack_capacity)
 		{
+			state->char_stack=(unsigned char *)mem_realloc(mem_states,state->char_stack,
+					(state->char_stack_capacity+1)*alloc_growth_num/alloc_growth_denom,state->char_stack_capacity);
 			state->char_stack_capacity=(state->char_stack_capacity+1)*alloc_growth_num/alloc_growth_denom;
-			state->char_stack=(unsigned char *)realloc(state->char_stack,state->char_stack_capacity);
 		};
 		state->char_stack[SLT_joint_params->string_depth-1]=SLT_joint_params->WL_char;
 	}
@@ -87,6 +631,8 @@ void SLT_callback_MAWs(const SLT_joint_params_t * SLT_joint_params,void * intern
 		char_mask2=1;
 		for(j=1;j<5;j++) {
 			char_mask2<<=1;
+			if(state->canonical_filter && !MAWs_is_canonical(state,SLT_joint_params->string_depth,i,j))
+				continue;
 			if((SLT_joint_params->right_extension_bitmap1&char_mask2)
 					&& (SLT_joint_params->left_extension_bitmap1&char_mask1)
 					&& SLT_joint_params->left_right_extension_freqs1[i][j]==0) {
@@ -110,8 +656,11 @@ void SLT_callback_MAWs(const SLT_joint_params_t * SLT_joint_params,void * intern
 				// We have a MAW. Write it to the output
 				state->nMAWs++;
 				state->LW-=2*x;
-				if(mem) {
-					if(state->MAW_buffer_idx+SLT_joint_params->string_depth+3>state->nMAW_capacity) {
+				if(state->topk.k)
+					MAWs_topk_offer(state,SLT_joint_params,i,j,3);
+				else if(mem) {
+					if(state->MAW_buffer_idx+SLT_joint_params->string_depth+3+
+							(state->witnesses?MAWs_witness_room:0)>state->nMAW_capacity) {
 						#pragma omp critical
 						fwrite(state->MAW_buffer, state->MAW_buffer_idx, sizeof(char), state->file);
 						state->MAW_buffer_idx=0;
@@ -124,6 +673,8 @@ void SLT_callback_MAWs(const SLT_joint_params_t * SLT_joint_params,void * intern
 								alpha4_to_ACGT[state->char_stack[SLT_joint_params->string_depth-k-1]-1];
 					}
 					state->MAW_buffer[state->MAW_buffer_idx++]=alpha4_to_ACGT[j-1];
+					if(state->witnesses)
+						MAWs_write_witnesses(state,SLT_joint_params,i,j,3);
 					state->MAW_buffer[state->MAW_buffer_idx++]='\n';
 				}
 			}
@@ -140,14 +691,15 @@ void SLT_callback_RWs(const SLT_joint_params_t * SLT_joint_params,void * intern_
 
 	if(state->nMAW_capacity==0 && mem) {
 		state->nMAW_capacity=1<<16;
-		state->MAW_buffer=(unsigned char *) malloc(state->nMAW_capacity);
+		state->MAW_buffer=(unsigned char *) mem_malloc(mem_output,state->nMAW_capacity);
 	}
 	if(SLT_joint_params->string_depth!=0)
 	{
 		if(SLT_joint_params->string_depth>state->char_stack_capacity)
 		{
+			state->char_stack=(unsigned char *)mem_realloc(mem_states,state->char_stack,
+					(state->char_stack_capacity+1)*alloc_growth_num/alloc_growth_denom,state->char_stack_capacity);
 			state->char_stack_capacity=(state->char_stack_capacity+1)*alloc_growth_num/alloc_growth_denom;
-			state->char_stack=(unsigned char *)realloc(state->char_stack,state->char_stack_capacity);
 		};
 		state->char_stack[SLT_joint_params->string_depth-1]=SLT_joint_params->WL_char;
 	}
@@ -164,6 +716,8 @@ void SLT_callback_RWs(const SLT_joint_params_t * SLT_joint_params,void * intern_
 		char_mask2=1;
 		for(j=1;j<5;j++) {
 			char_mask2<<=1;
+			if(state->canonical_filter && !MAWs_is_canonical(state,SLT_joint_params->string_depth,i,j))
+				continue;
 			unsigned int freqLeft1= 0;
 			unsigned int freqRight1= 0;
 			unsigned int freqLeft2= 0;
@@ -191,8 +745,11 @@ void SLT_callback_RWs(const SLT_joint_params_t * SLT_joint_params,void * intern_
 							&& SLT_joint_params->left_right_extension_freqs2[i][j]<=F1) {
 				// We have a MAW. Write it to the output
 				state->nMAWs++;
-				if(mem) {
-					if(state->MAW_buffer_idx+SLT_joint_params->string_depth+3>state->nMAW_capacity) {
+				if(state->topk.k)
+					MAWs_topk_offer(state,SLT_joint_params,i,j,3);
+				else if(mem) {
+					if(state->MAW_buffer_idx+SLT_joint_params->string_depth+3+
+							(state->witnesses?MAWs_witness_room:0)>state->nMAW_capacity) {
 						#pragma omp critical
 						fwrite(state->MAW_buffer, state->MAW_buffer_idx, sizeof(char), state->file);
 						state->MAW_buffer_idx=0;
@@ -202,6 +759,8 @@ void SLT_callback_RWs(const SLT_joint_params_t * SLT_joint_params,void * intern_
 						state->MAW_buffer[state->MAW_buffer_idx++]=
 								alpha4_to_ACGT[state->char_stack[SLT_joint_params->string_depth-k-1]-1];
 					state->MAW_buffer[state->MAW_buffer_idx++]=alpha4_to_ACGT[j-1];
+					if(state->witnesses)
+						MAWs_write_witnesses(state,SLT_joint_params,i,j,3);
 					state->MAW_buffer[state->MAW_buffer_idx++]='\n';
 				}
 			}
@@ -219,14 +778,15 @@ void SLT_callback_MAWs_present(const SLT_joint_params_t * SLT_joint_params,void
 
 	if(state->nMAW_capacity==0 && mem) {
 		state->nMAW_capacity=1<<16;
-		state->MAW_buffer=(unsigned char *) malloc(state->nMAW_capacity);
+		state->MAW_buffer=(unsigned char *) mem_malloc(mem_output,state->nMAW_capacity);
 	}
 	if(SLT_joint_params->string_depth!=0)
 	{
 		if(SLT_joint_params->string_depth>state->char_stack_capacity)
 		{
+			state->char_stack=(unsigned char *)mem_realloc(mem_states,state->char_stack,
+					(state->char_stack_capacity+1)*alloc_growth_num/alloc_growth_denom,state->char_stack_capacity);
 			state->char_stack_capacity=(state->char_stack_capacity+1)*alloc_growth_num/alloc_growth_denom;
-			state->char_stack=(unsigned char *)realloc(state->char_stack,state->char_stack_capacity);
 		};
 		state->char_stack[SLT_joint_params->string_depth-1]=SLT_joint_params->WL_char;
 	}
@@ -239,16 +799,23 @@ void SLT_callback_MAWs_present(const SLT_joint_params_t * SLT_joint_params,void
 
 	char_mask1=1;
 	for(i=1;i<5;i++) {
+		char_mask1<<=1;
 		char_mask2=1;
 		for(j=1;j<5;j++) {
+			char_mask2<<=1;
+			if(state->canonical_filter && !MAWs_is_canonical(state,SLT_joint_params->string_depth,i,j))
+				continue;
 			if(((SLT_joint_params->right_extension_bitmap1&char_mask2)
 					&& (SLT_joint_params->left_extension_bitmap1&char_mask1)
 					&& SLT_joint_params->left_right_extension_freqs1[i][j]==0
 					&& SLT_joint_params->left_right_extension_freqs2[i][j]!=0)) {
 				// We have a MAW. Write it to the output
 				state->nMAWs++;
-				if(mem) {
-					if(state->MAW_buffer_idx+SLT_joint_params->string_depth+3>state->nMAW_capacity) {
+				if(state->topk.k)
+					MAWs_topk_offer(state,SLT_joint_params,i,j,1);
+				else if(mem) {
+					if(state->MAW_buffer_idx+SLT_joint_params->string_depth+3+
+							(state->witnesses?MAWs_witness_room:0)>state->nMAW_capacity) {
 #pragma omp critical
 						fwrite(state->MAW_buffer, state->MAW_buffer_idx, sizeof(char), state->file);
 						state->MAW_buffer_idx=0;
@@ -258,16 +825,68 @@ void SLT_callback_MAWs_present(const SLT_joint_params_t * SLT_joint_params,void
 						state->MAW_buffer[state->MAW_buffer_idx++]=
 								alpha4_to_ACGT[state->char_stack[SLT_joint_params->string_depth-k-1]-1];
 					state->MAW_buffer[state->MAW_buffer_idx++]=alpha4_to_ACGT[j-1];
+					if(state->witnesses)
+						MAWs_write_witnesses(state,SLT_joint_params,i,j,1);
 					state->MAW_buffer[state->MAW_buffer_idx++]='\n';
 				}
 			}
-		char_mask2<<=1;
 		}
-	char_mask1<<=1;
 	}
 
 }
 
+static inline double MAWs_g(unsigned int length, unsigned int y)
+{
+	return (double) (length-y+2)/(length-y+1)*(length-y+2)/(length-y+3);
+};
+
+static void MAWs_get_g_values(MAWs_callback_state_t * state, unsigned int y, MAWs_g_values_t * gv)
+{
+	const MAWs_g_tables_t * tables=state->g_tables;
+	unsigned int i;
+	if(y<tables->size) {
+		gv->g1=tables->t1.g[y];
+		gv->g2=tables->t2.g[y];
+		gv->prefix_sum1=tables->t1.prefix_sum[y];
+		gv->prefix_sum2=tables->t2.prefix_sum[y];
+		gv->prev_sum1=tables->t1.prefix_sum[y-1];
+		gv->prev_sum2=tables->t2.prefix_sum[y-1];
+		gv->prev_sumN=tables->prefix_sumN[y-1];
+		return;
+	}
+	// Past the shared tables. The parent of this node filled entry y-1 of the
+	// overflow, so we extend it by one entry as the old per-state arrays did.
+	i=y-tables->size;
+	if(i>=state->prefix_capacity)
+	{
+		size_t old_size=state->prefix_capacity*sizeof(double);
+		state->prefix_capacity=(state->prefix_capacity+2)*alloc_growth_num/alloc_growth_denom;
+		state->prefix_sum1=(double *)mem_realloc(mem_states,state->prefix_sum1,
+				state->prefix_capacity*sizeof(double),old_size);
+		state->prefix_sum2=(double *)mem_realloc(mem_states,state->prefix_sum2,
+				state->prefix_capacity*sizeof(double),old_size);
+		state->prefix_sumN=(double *)mem_realloc(mem_states,state->prefix_sumN,
+				state->prefix_capacity*sizeof(double),old_size);
+	};
+	gv->g1=MAWs_g(tables->t1.length,y);
+	gv->g2=MAWs_g(tables->t2.length,y);
+	if(i==0) {
+		gv->prev_sum1=tables->t1.prefix_sum[y-1];
+		gv->prev_sum2=tables->t2.prefix_sum[y-1];
+		gv->prev_sumN=tables->prefix_sumN[y-1];
+	}
+	else {
+		gv->prev_sum1=state->prefix_sum1[i-1];
+		gv->prev_sum2=state->prefix_sum2[i-1];
+		gv->prev_sumN=state->prefix_sumN[i-1];
+	}
+	state->prefix_sum1[i]=gv->prev_sum1+(gv->g1-1)*(gv->g1-1);
+	state->prefix_sum2[i]=gv->prev_sum2+(gv->g2-1)*(gv->g2-1);
+	state->prefix_sumN[i]=gv->prev_sumN+(gv->g1-1)*(gv->g2-1);
+	gv->prefix_sum1=state->prefix_sum1[i];
+	gv->prefix_sum2=state->prefix_sum2[i];
+};
+
 void SLT_callback_kernel(const SLT_joint_params_t * SLT_joint_params,void * intern_state, unsigned int mem)
 {
 	MAWs_callback_state_t * state= (MAWs_callback_state_t*)(intern_state);
@@ -277,32 +896,24 @@ void SLT_callback_kernel(const SLT_joint_params_t * SLT_joint_params,void * inte
 	int N=0;
 	int d1=0;
 	int d2=0;
+	MAWs_g_values_t gv;
 
 	if(state->nMAW_capacity==0 && mem) {
 		state->nMAW_capacity=1<<16;
-		state->MAW_buffer=(unsigned char *) malloc(state->nMAW_capacity);
+		state->MAW_buffer=(unsigned char *) mem_malloc(mem_output,state->nMAW_capacity);
 	}
 	if(SLT_joint_params->string_depth!=0)
 	{
 		if(SLT_joint_params->string_depth>state->char_stack_capacity)
 		{
+			state->char_stack=(unsigned char *)mem_realloc(mem_states,state->char_stack,
+					(state->char_stack_capacity+1)*alloc_growth_num/alloc_growth_denom,state->char_stack_capacity);
 			state->char_stack_capacity=(state->char_stack_capacity+1)*alloc_growth_num/alloc_growth_denom;
-			state->char_stack=(unsigned char *)realloc(state->char_stack,state->char_stack_capacity);
 		};
 		state->char_stack[SLT_joint_params->string_depth-1]=SLT_joint_params->WL_char;
 	}
 
-	if((SLT_joint_params->string_depth+2)>=state->prefix_capacity)
-	{
-		state->prefix_capacity=(state->prefix_capacity+2)*alloc_growth_num/alloc_growth_denom;
-		state->prefix_sum1=(double *)realloc(state->prefix_sum1,state->prefix_capacity*sizeof(double));
-		state->prefix_sum2=(double *)realloc(state->prefix_sum2,state->prefix_capacity*sizeof(double));
-		state->prefix_sumN=(double *)realloc(state->prefix_sumN,state->prefix_capacity*sizeof(double));
-	};
-
-	state->prefix_sum1[SLT_joint_params->string_depth+2]= state->prefix_sum1[SLT_joint_params->string_depth+1]+(g1(SLT_joint_params->string_depth+2)-1)*(g1(SLT_joint_params->string_depth+2)-1);
-	state->prefix_sum2[SLT_joint_params->string_depth+2]= state->prefix_sum2[SLT_joint_params->string_depth+1]+(g2(SLT_joint_params->string_depth+2)-1)*(g2(SLT_joint_params->string_depth+2)-1);
-	state->prefix_sumN[SLT_joint_params->string_depth+2]= state->prefix_sumN[SLT_joint_params->string_depth+1]+(g1(SLT_joint_params->string_depth+2)-1)*(g2(SLT_joint_params->string_depth+2)-1);
+	MAWs_get_g_values(state,SLT_joint_params->string_depth+2,&gv);
 
 	for(i=0; i<5; i++) {
 		N+= ((SLT_joint_params->left_extension_bitmap1&SLT_joint_params->left_extension_bitmap2&(1<<i))>>i);
@@ -310,8 +921,10 @@ void SLT_callback_kernel(const SLT_joint_params_t * SLT_joint_params,void * inte
 		d2+= (SLT_joint_params->left_extension_bitmap2&(1<<i))>>i;
 	}
 
-	double correction1= state->prefix_sum1[SLT_joint_params->string_depth+2];
-	double correction2= state->prefix_sum2[SLT_joint_params->string_depth+2];
+	double correction1;
+	double correction2;
+	// Correction of aWb to N, the score of the top-k words
+	double term;
 	//frequency
 	unsigned int fw=0;
 	unsigned int faw=0;
@@ -320,6 +933,10 @@ void SLT_callback_kernel(const SLT_joint_params_t * SLT_joint_params,void * inte
 	for(i=0;i<5;i++) {
 		char_mask2=1;
 		for(j=0;j<5;j++) {
+			// Terms of aWb in t1 and t2 if W has one right extension
+			correction1=gv.g1-1;
+			correction2=gv.g2-1;
+			term=0;
 			if((SLT_joint_params->right_extension_bitmap1&char_mask2)
 					&& (SLT_joint_params->left_extension_bitmap1&char_mask1)) {
 				if (SLT_joint_params->left_right_extension_freqs1[i][j]==0) {
@@ -346,8 +963,8 @@ void SLT_callback_kernel(const SLT_joint_params_t * SLT_joint_params,void * inte
 					}
 					//state->KL[SLT_joint_params->string_depth+2]+= SLT_joint_params->left_right_extension_freqs1[i][j]*
 					//	(log(SLT_joint_params->left_right_extension_freqs1[i][j])-log((double)faw*fwb/fw));
-					correction1= (g1(SLT_joint_params->string_depth+2)*fw/faw*SLT_joint_params->left_right_extension_freqs1[i][j]/fwb-1);
-					state->D1+= correction1*correction1 - (g1(SLT_joint_params->string_depth+2)-1)*(g1(SLT_joint_params->string_depth+2)-1);
+					correction1= (gv.g1*fw/faw*SLT_joint_params->left_right_extension_freqs1[i][j]/fwb-1);
+					state->D1+= correction1*correction1 - (gv.g1-1)*(gv.g1-1);
 				}
 			}
 			if((SLT_joint_params->right_extension_bitmap2&char_mask2)
@@ -375,8 +992,8 @@ void SLT_callback_kernel(const SLT_joint_params_t * SLT_joint_params,void * inte
 						for(k=0; k<5; k++)
 							fw+= SLT_joint_params->left_right_extension_freqs2[h][k];
 					}
-					correction2=(g2(SLT_joint_params->string_depth+2)*fw/faw*SLT_joint_params->left_right_extension_freqs2[i][j]/fwb-1);
-					state->D2+= correction2*correction2 - (g2(SLT_joint_params->string_depth+2)-1)*(g2(SLT_joint_params->string_depth+2)-1);
+					correction2=(gv.g2*fw/faw*SLT_joint_params->left_right_extension_freqs2[i][j]/fwb-1);
+					state->D2+= correction2*correction2 - (gv.g2-1)*(gv.g2-1);
 				}
 			}
 			if(((SLT_joint_params->right_extension_bitmap1&char_mask2)
@@ -389,11 +1006,22 @@ void SLT_callback_kernel(const SLT_joint_params_t * SLT_joint_params,void * inte
 						// We have a MAW. Write it to the output
 						//correction for maw-maw
 						state->N++;
+						term=1;
 					}
 				}
-				else
+				else if(SLT_joint_params->left_right_extension_freqs1[i][j]!=0
+						&& SLT_joint_params->left_right_extension_freqs2[i][j]!=0) {
 					//correction for N
-					state->N+= correction1*correction2-(g1(SLT_joint_params->string_depth+2)-1)*(g2(SLT_joint_params->string_depth+2)-1);
+					term=correction1*correction2-(gv.g1-1)*(gv.g2-1);
+					state->N+= term;
+				}
+				else if(i!=0 && j!=0) {
+					//maw in one text only: N has no default term for aWb
+					term=correction1*correction2;
+					state->N+= term;
+				}
+				if(state->topk.k && i!=0 && j!=0)
+					MAWs_topk_push_word(state,SLT_joint_params,i,j,fabs(term));
 
 				if ((SLT_joint_params->left_right_extension_freqs1[i][j]!=0
 						&& SLT_joint_params->left_right_extension_freqs2[i][j]!=0)) {
@@ -404,20 +1032,20 @@ void SLT_callback_kernel(const SLT_joint_params_t * SLT_joint_params,void * inte
 		}
 		char_mask1<<=1;
 	}
-	state->D1+= d1*state->prefix_sum1[SLT_joint_params->string_depth+1];
-	state->D2+= d2*state->prefix_sum2[SLT_joint_params->string_depth+1];
-	state->N+= N*state->prefix_sumN[SLT_joint_params->string_depth+1];
+	state->D1+= d1*gv.prev_sum1;
+	state->D2+= d2*gv.prev_sum2;
+	state->N+= N*gv.prev_sumN;
 }
 
 void* SLT_cloner(void* p, unsigned int t){
-	MAWs_callback_state_t* temp= malloc(sizeof(MAWs_callback_state_t));
+	MAWs_callback_state_t* temp= mem_malloc(mem_states,sizeof(MAWs_callback_state_t));
 	MAWs_callback_state_t* new_p= (MAWs_callback_state_t*) p;
 	temp->minlen=new_p->minlen;
 	temp->MAW_buffer=0;
 	temp->nMAW_capacity=0;
 	temp->MAW_buffer_idx=0;
 	temp->char_stack_capacity=new_p->char_stack_capacity;
-	temp->char_stack=(unsigned char *) malloc(new_p->char_stack_capacity);
+	temp->char_stack=(unsigned char *) mem_malloc(mem_states,new_p->char_stack_capacity);
 	memcpy(temp->char_stack,new_p->char_stack,new_p->char_stack_capacity);
 	temp->nMAWs=0;
 	temp->nMAWs1=0;
@@ -425,16 +1053,27 @@ void* SLT_cloner(void* p, unsigned int t){
 	temp->LW=0;
 	temp->pos=t;
 	temp->file=new_p->file;
-	temp->prefix_capacity= new_p->prefix_capacity;
+	temp->g_tables=new_p->g_tables;
+	temp->prefix_capacity=0;
+	temp->prefix_sum1=NULL;
+	temp->prefix_sum2=NULL;
+	temp->prefix_sumN=NULL;
 	temp->D1=0;
 	temp->D2=0;
 	temp->N=0;
-	temp->prefix_sum1= (double *)malloc(temp->prefix_capacity*sizeof(double));
-	memcpy(temp->prefix_sum1, new_p->prefix_sum1,temp->prefix_capacity*sizeof(double));
-	temp->prefix_sum2= (double *)malloc(temp->prefix_capacity*sizeof(double));
-	memcpy(temp->prefix_sum2, new_p->prefix_sum2,temp->prefix_capacity*sizeof(double));
-	temp->prefix_sumN= (double *)malloc(temp->prefix_capacity*sizeof(double));
-	memcpy(temp->prefix_sumN, new_p->prefix_sumN,temp->prefix_capacity*sizeof(double));
+	temp->callback=new_p->callback;
+	temp->record_hist=new_p->record_hist;
+	memset(&temp->hist,0,sizeof(MAWs_histogram_t));
+	temp->topk.k=new_p->topk.k;
+	temp->topk.score_by=new_p->topk.score_by;
+	temp->topk.n=0;
+	temp->topk.heap=NULL;
+	temp->topk_scratch_capacity=0;
+	temp->topk_scratch=NULL;
+	temp->BBWT1=new_p->BBWT1;
+	temp->BBWT2=new_p->BBWT2;
+	temp->witnesses=new_p->witnesses;
+	temp->canonical_filter=new_p->canonical_filter;
 	//if AAAA -> allocate! only 9
 	// temp->bitvec1= (unsigned int *)malloc(36*8*sizeof(int));
 	// temp->KL_capacity= new_p->KL_capacity;
@@ -453,10 +1092,20 @@ void SLT_combiner(void** intern_state, void* state, unsigned int t,unsigned int
 		s->D1+=p[i]->D1;
 		s->D2+=p[i]->D2;
 		s->N+=p[i]->N;
+		if(s->record_hist) {
+			MAWs_histogram_merge(&s->hist,&p[i]->hist);
+			MAWs_histogram_release(&p[i]->hist);
+		}
+		if(s->topk.k) {
+			MAWs_topk_merge(&s->topk,&p[i]->topk);
+			MAWs_topk_release(&p[i]->topk);
+			mem_free(mem_states,p[i]->topk_scratch,p[i]->topk_scratch_capacity);
+		}
 		// for(j= 2; j< s->KL_capacity; j++)
 		// 	s->KL[j]+= p[i]->KL[j];
 		// for(j= 0; j< 64; j++) {}
 		// s->bitvec1[j]= s->bitvec1[j] | p[i]->bitvec1[j];
+		mem_free(mem_states,p[i],sizeof(MAWs_callback_state_t));
 	}
 	if (mem) {
 		fclose(s->file);
@@ -467,11 +1116,123 @@ void SLT_free(void* intern_state, unsigned int mem) {
 	MAWs_callback_state_t* state= (MAWs_callback_state_t*) intern_state;
 	if (mem) {
 		fwrite(state->MAW_buffer, state->MAW_buffer_idx, sizeof(char), state->file);
-		free(state->MAW_buffer);
+		mem_free(mem_output,state->MAW_buffer,state->nMAW_capacity);
 	}
-	free(state->char_stack);
+	mem_free(mem_states,state->char_stack,state->char_stack_capacity);
+	mem_free(mem_states,state->prefix_sum1,state->prefix_capacity*sizeof(double));
+	mem_free(mem_states,state->prefix_sum2,state->prefix_capacity*sizeof(double));
+	mem_free(mem_states,state->prefix_sumN,state->prefix_capacity*sizeof(double));
+	state->prefix_sum1=NULL;
+	state->prefix_sum2=NULL;
+	state->prefix_sumN=NULL;
+	state->prefix_capacity=0;
 	//free(state->KL);
 }
+// The values of a slave state in a checkpoint: counts, sums, histogram and
+// top-k words. The reader changes the state only once the whole record is
+// read.
+static int MAWs_state_write(const void * intern_state, FILE * f)
+{
+	const MAWs_callback_state_t * state=(const MAWs_callback_state_t *)intern_state;
+	const MAWs_histogram_t * hist=&state->hist;
+	unsigned int counts[5]={state->nMAWs,state->nMAWs1,state->nMAWs2,hist->length,state->topk.n};
+	double sums[4]={state->LW,state->N,state->D1,state->D2};
+	const MAWs_topk_entry_t * entry;
+	unsigned int i,len=hist->length;
+	if(fwrite(counts,sizeof(unsigned int),5,f)!=5 || fwrite(sums,sizeof(double),4,f)!=4)
+		return -1;
+	if(len && (fwrite(hist->nMAWs,sizeof(unsigned int),len,f)!=len
+			|| fwrite(hist->nMAWs1,sizeof(unsigned int),len,f)!=len
+			|| fwrite(hist->nMAWs2,sizeof(unsigned int),len,f)!=len
+			|| fwrite(hist->LW,sizeof(double),len,f)!=len || fwrite(hist->N,sizeof(double),len,f)!=len
+			|| fwrite(hist->D1,sizeof(double),len,f)!=len || fwrite(hist->D2,sizeof(double),len,f)!=len))
+		return -1;
+	for(i=0;i<state->topk.n;i++) {
+		entry=&state->topk.heap[i];
+		if(fwrite(&entry->score,sizeof(double),1,f)!=1 || fwrite(&entry->len,sizeof(unsigned int),1,f)!=1
+				|| fwrite(entry->word,1,entry->len,f)!=entry->len)
+			return -1;
+	}
+	return 0;
+};
+
+static int MAWs_state_read(void * intern_state, FILE * f)
+{
+	MAWs_callback_state_t * state=(MAWs_callback_state_t *)intern_state;
+	MAWs_histogram_t hist;
+	MAWs_topk_t topk;
+	MAWs_topk_entry_t * entry;
+	unsigned int counts[5];
+	double sums[4];
+	unsigned int i,len;
+	int res=0;
+	memset(&hist,0,sizeof(hist));
+	memset(&topk,0,sizeof(topk));
+	if(fread(counts,sizeof(unsigned int),5,f)!=5 || fread(sums,sizeof(double),4,f)!=4
+			|| counts[4]>state->topk.k)
+		return -1;
+	len=counts[3];
+	if(len) {
+		MAWs_histogram_reserve(&hist,len);
+		hist.length=len;
+		if(fread(hist.nMAWs,sizeof(unsigned int),len,f)!=len || fread(hist.nMAWs1,sizeof(unsigned int),len,f)!=len
+				|| fread(hist.nMAWs2,sizeof(unsigned int),len,f)!=len
+				|| fread(hist.LW,sizeof(double),len,f)!=len || fread(hist.N,sizeof(double),len,f)!=len
+				|| fread(hist.D1,sizeof(double),len,f)!=len || fread(hist.D2,sizeof(double),len,f)!=len)
+			res=-1;
+	}
+	topk.k=counts[4];
+	topk.heap=(MAWs_topk_entry_t *)calloc(topk.k+1,sizeof(MAWs_topk_entry_t));
+	for(i=0;i<topk.k && res==0;i++) {
+		entry=&topk.heap[i];
+		if(fread(&entry->score,sizeof(double),1,f)!=1 || fread(&entry->len,sizeof(unsigned int),1,f)!=1
+				|| (entry->word=(unsigned char *)malloc(entry->len+1))==NULL
+				|| fread(entry->word,1,entry->len,f)!=entry->len)
+			res=-1;
+		topk.n++;
+	}
+	if(res==0) {
+		state->nMAWs+=counts[0];
+		state->nMAWs1+=counts[1];
+		state->nMAWs2+=counts[2];
+		state->LW+=sums[0];
+		state->N+=sums[1];
+		state->D1+=sums[2];
+		state->D2+=sums[3];
+		if(len)
+			MAWs_histogram_merge(&state->hist,&hist);
+		MAWs_topk_merge(&state->topk,&topk);
+	}
+	MAWs_histogram_release(&hist);
+	MAWs_topk_release(&topk);
+	return res;
+};
+
+// Tells apart the computations of SLT_find_MAWs and SLT_find_RWs in the
+// files of slave states (FNV-1a of what the slave states depend on)
+static unsigned long long MAWs_state_tag(const MAWs_callback_state_t * state, unsigned int result)
+{
+	unsigned int values[9]={result,state->minlen,F1,F2,state->record_hist,state->topk.k,
+			state->topk.score_by,state->canonical_filter,state->witnesses};
+	unsigned long long tag=14695981039346656037ULL;
+	unsigned int i;
+	for(i=0;i<9;i++)
+		tag=(tag^values[i])*1099511628211ULL;
+	return tag;
+};
+
+static void MAWs_execute(SLT_joint_iterator_t * SLT_iterator, MAWs_callback_state_t * state,
+		unsigned int result, unsigned int mem, const MAWs_options_t * options)
+{
+	if(options && options->distributed_dir && !mem)
+		SLT_joint_set_distributed(SLT_iterator,options->distributed_dir,options->distributed_role,
+				options->distributed_timeout,MAWs_state_tag(state,result),MAWs_state_write,MAWs_state_read);
+	else if(options && options->checkpoint && !mem)
+		SLT_joint_set_checkpoint(SLT_iterator,options->checkpoint,options->checkpoint_interval,
+				MAWs_state_tag(state,result),MAWs_state_write,MAWs_state_read);
+	SLT_joint_execute_iterator(SLT_iterator);
+};
+
 double g1(int y) {
 	return (double) (length1-y+2)/(length1-y+1)*(length1-y+2)/(length1-y+3);
 }
@@ -479,104 +1240,181 @@ double g2(int y) {
 	return (double) (length2-y+2)/(length2-y+1)*(length2-y+2)/(length2-y+3);
 }
 
-unsigned int SLT_find_MAWs(Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,
-		unsigned int minlen, unsigned int * _nMAWs1,
-		unsigned int * _nMAWs2, double * _output_result, unsigned int mem, unsigned int cores, unsigned int result)
+// Trigamma function, by recurrence up to x>=16 and then its asymptotic series
+static double trigamma(double x)
 {
-	SLT_joint_iterator_t * SLT_iterator;
-	MAWs_callback_state_t state;
+	double r=0;
+	double x2;
+	while(x<16) {
+		r+=1/(x*x);
+		x+=1;
+	}
+	x2=1/(x*x);
+	return r+1/x+x2/2+x2/x*(1.0/6-x2*(1.0/30-x2*(1.0/42-x2/30)));
+};
 
-	unsigned int i;
-	state.nMAWs=0;
-	state.nMAWs1=0;
-	state.nMAWs2=0;
-	state.MAW_buffer=0;
-	state.MAW_buffer_idx=0;
-	state.nMAW_capacity=0;
-	state.minlen=minlen;
-	state.LW=0;
-	state.char_stack_capacity=4;
-	state.char_stack=(unsigned char *) malloc(state.char_stack_capacity);
-	FILE *f;
-	if(mem) {
-		f=fopen("output.txt", "a");
-		state.file=f;
+// Closed form of the initial value of D, sum_{i=1}^{m} (m-i+1)*(g(i)-1)^2
+// for m=length. With u=m-i+2 we have g(i)-1=1/(u^2-1) and m-i+1=u-1, so
+// each term is 1/((u-1)(u+1)^2)=(1/(u-1)-1/(u+1))/4-1/(2(u+1)^2). The first
+// part telescopes and the second is a tail of zeta(2).
+static double MAWs_D_init(unsigned int length)
+{
+	double M=(double)length+1;
+	return (1.5-1/M-1/(M+1))/4-(M_PI*M_PI/6-1.25-trigamma(M+2))/2;
+};
+
+// Initial value of N, the counterpart of MAWs_D_init for the words common
+// to both texts. These are the words both texts end with, so N starts at
+// sum_{i=1}^{m} (m-i+1)*(g1(i)-1)*(g2(i)-1) with m-1 the length of the
+// longest common suffix of bases, or m=length+2 when the texts are equal.
+static double MAWs_N_init(Basic_BWT_t * BBWT1, Basic_BWT_t * BBWT2)
+{
+	unsigned int pos1,pos2,i,m=0;
+	unsigned char c1,c2;
+	double N=0;
+	if(BBWT1->textlen==0 || BBWT2->textlen==0)
+		return 0;
+	c1=DNA5_extract_char(BBWT1->indexed_BWT,0);
+	c2=DNA5_extract_char(BBWT2->indexed_BWT,0);
+	pos1=BBWT1->char_base[c1];
+	pos2=BBWT2->char_base[c2];
+	// Walk both texts backwards from their ends with the LF mapping
+	while(c1==c2 && c1<4) {
+		m++;
+		c1=DNA5_BWT_get_prev_char(BBWT1,pos1);
+		c2=DNA5_BWT_get_prev_char(BBWT2,pos2);
+		if(c1==255 || c2==255)
+			break;
+		pos1=LF_map(pos1,BBWT1);
+		pos2=LF_map(pos2,BBWT2);
 	}
+	m+=(c1==255 && c2==255)?2:1;
+	for(i=1;i<=m;i++)
+		N+=(double)(m-i+1)*(MAWs_g(BBWT1->textlen+2,i)-1)*(MAWs_g(BBWT2->textlen+2,i)-1);
+	return N;
+};
+
+static void MAWs_g_table_build(MAWs_g_table_t * table, unsigned int length, unsigned int size)
+{
+	unsigned int y;
+	table->length=length;
+	table->g=(double *)mem_malloc(mem_states,size*sizeof(double));
+	table->prefix_sum=(double *)mem_malloc(mem_states,size*sizeof(double));
+	#pragma omp parallel for
+	for(y=1;y<size;y++)
+		table->g[y]=MAWs_g(length,y);
+	table->g[0]=1;
+	table->prefix_sum[0]=0;
+	for(y=1;y<size;y++)
+		table->prefix_sum[y]=table->prefix_sum[y-1]+(table->g[y]-1)*(table->g[y]-1);
+};
+
+// Build the g tables of both texts once, to be shared read-only by all
+// the slave states.
+static MAWs_g_tables_t * new_MAWs_g_tables(unsigned int length1, unsigned int length2)
+{
+	MAWs_g_tables_t * tables=(MAWs_g_tables_t *)mem_malloc(mem_states,sizeof(MAWs_g_tables_t));
+	unsigned int y;
+	// Entries past the text lengths are meaningless but never read, as the
+	// string depth stays below the text length. Not cutting the tables to the
+	// text lengths also guarantees that the slaves, which start at depth 4,
+	// begin inside the tables with an empty overflow.
+	tables->size=MAWs_g_table_size;
+	MAWs_g_table_build(&tables->t1,length1,tables->size);
+	MAWs_g_table_build(&tables->t2,length2,tables->size);
+	tables->prefix_sumN=(double *)mem_malloc(mem_states,tables->size*sizeof(double));
+	tables->prefix_sumN[0]=0;
+	for(y=1;y<tables->size;y++)
+		tables->prefix_sumN[y]=tables->prefix_sumN[y-1]+(tables->t1.g[y]-1)*(tables->t2.g[y]-1);
+	return tables;
+};
+
+static void free_MAWs_g_tables(MAWs_g_tables_t * tables)
+{
+	size_t size=tables->size*sizeof(double);
+	mem_free(mem_states,tables->t1.g,size);
+	mem_free(mem_states,tables->t1.prefix_sum,size);
+	mem_free(mem_states,tables->t2.g,size);
+	mem_free(mem_states,tables->t2.prefix_sum,size);
+	mem_free(mem_states,tables->prefix_sumN,size);
+	mem_free(mem_states,tables,sizeof(MAWs_g_tables_t));
+};
+
+static void MAWs_state_init(MAWs_callback_state_t * state,Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,
+		unsigned int minlen, unsigned int mem, const MAWs_options_t * options)
+{
+	memset(state,0,sizeof(MAWs_callback_state_t));
+	state->minlen=minlen;
+	state->char_stack_capacity=4;
+	state->char_stack=(unsigned char *) mem_malloc(mem_states,state->char_stack_capacity);
+	if(mem)
+		state->file=fopen("output.txt", "a");
 	length1= BBWT1->textlen+2;
 	length2= BBWT2->textlen+2;
-	state.N=0;
-	state.D1=0;
-	state.D2=0;
-
-	//Initializing D1 and D2
-	double prefix_sum= 0;
-	for(i=1; i<=BBWT1->textlen+2;i++) {
-		prefix_sum+= (g1(i)-1)*(g1(i)-1);
-		state.D1+=prefix_sum;
-	}
-	prefix_sum= 0;
-	for(i=1; i<=BBWT2->textlen+2;i++){
-		prefix_sum+= (g2(i)-1)*(g2(i)-1);
-		state.D2+=prefix_sum;
-	}
-
-	//Prefix sum allocation and initialization
-	state.prefix_capacity=4;
-	state.prefix_sum1=(double *)malloc(state.prefix_capacity*sizeof(double));
-	state.prefix_sum2=(double *)malloc(state.prefix_capacity*sizeof(double));
-	state.prefix_sumN=(double *)malloc(state.prefix_capacity*sizeof(double));
-	state.prefix_sum1[1]=(g1(1)-1)*(g1(1)-1);
-	state.prefix_sum2[1]=(g2(1)-1)*(g2(1)-1);
-	state.prefix_sumN[1]=(g1(1)-1)*(g2(1)-1);
-	//resize!
-	/*if(d> state.bitvec_sizes[i]){
-		state.bitvec_sizes[i]*=2;
-		state.bitvec[i]=realloc(state.bitvec[i],state.bitvec_sizes[i]/8);
-		memset(state.bitvec[i]+state.bitvec_sizes[i]/16,0,state.bitvec_sizes[i]/16);
-	state.bitvec_capacity=(unsigned int *) malloc(36*sizeof(unsigned int));
-	}
-	for(i=0;i<36;i++) state.bitvec_capacity[i]=32;
-		state.bitvec1= (unsigned int **)malloc(36*sizeof(int));
-	for(i=0;i<36;i++) {
-		for(i=0;i<36;i++) state.bitvec1[i]=(unsigned int *) calloc(1,sizeof(unsigned int));
-	}
-	state.KL_capacity= BBWT1->textlen+1;
-	state.KL= (double *) malloc(state.KL_capacity*sizeof(double));
-	*/
-	
+	state->record_hist=(options && (options->hist || options->nweightings));
+	state->BBWT1=BBWT1;
+	state->BBWT2=BBWT2;
+	state->witnesses=(options && options->witnesses && BBWT1->SA_sample_rate && BBWT2->SA_sample_rate);
+	state->canonical_filter=(options && options->canonical_filter);
+	if(options && options->topk) {
+		state->topk.k=options->topk->k;
+		state->topk.score_by=options->topk->score_by;
+	}
+};
 
+unsigned int SLT_find_MAWs(Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,
+		unsigned int minlen, unsigned int * _nMAWs1,
+		unsigned int * _nMAWs2, double * _output_result, unsigned int mem, unsigned int cores, unsigned int result,
+		const MAWs_options_t * options)
+{
+	SLT_joint_iterator_t * SLT_iterator;
+	MAWs_callback_state_t state;
+	MAWs_g_tables_t * g_tables=NULL;
 
+	MAWs_state_init(&state,BBWT1,BBWT2,minlen,mem,options);
+	if(result==6) {
+		g_tables=new_MAWs_g_tables(BBWT1->textlen+2,BBWT2->textlen+2);
+		state.g_tables=g_tables;
+		state.D1=MAWs_D_init(BBWT1->textlen+2);
+		state.D2=MAWs_D_init(BBWT2->textlen+2);
+		state.N=MAWs_N_init(BBWT1,BBWT2);
+	}
 
 	switch(result) {
 	case 1:
-		SLT_iterator=new_SLT_joint_iterator(SLT_callback_MAWs,SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
-		SLT_joint_execute_iterator(SLT_iterator);
+		SLT_iterator=new_SLT_joint_iterator(MAWs_select_callback(&state,SLT_callback_MAWs),SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
+		MAWs_execute(SLT_iterator,&state,result,mem,options);
 		break;
 	case 3:
-		SLT_iterator=new_SLT_joint_iterator(SLT_callback_MAWs_present,SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
-		SLT_joint_execute_iterator(SLT_iterator);
+		SLT_iterator=new_SLT_joint_iterator(MAWs_select_callback(&state,SLT_callback_MAWs_present),SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
+		MAWs_execute(SLT_iterator,&state,result,mem,options);
 		break;
 	case 4:
-		SLT_iterator=new_SLT_joint_iterator(SLT_callback_MAWs,SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
-		SLT_joint_execute_iterator(SLT_iterator);
+		SLT_iterator=new_SLT_joint_iterator(MAWs_select_callback(&state,SLT_callback_MAWs),SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
+		MAWs_execute(SLT_iterator,&state,result,mem,options);
 		break;
 	case 5:
-		SLT_iterator=new_SLT_joint_iterator(SLT_callback_MAWs,SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
-		SLT_joint_execute_iterator(SLT_iterator);
+		SLT_iterator=new_SLT_joint_iterator(MAWs_select_callback(&state,SLT_callback_MAWs),SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
+		MAWs_execute(SLT_iterator,&state,result,mem,options);
 		*_output_result= state.LW;
 		break;
 	case 6:
 
-		SLT_iterator=new_SLT_joint_iterator(SLT_callback_kernel,SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
-		SLT_joint_execute_iterator(SLT_iterator);
+		SLT_iterator=new_SLT_joint_iterator(MAWs_select_callback(&state,SLT_callback_kernel),SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
+		MAWs_execute(SLT_iterator,&state,result,mem,options);
 		*_output_result= state.N/sqrt(state.D1*state.D2);
-		printf("Markovian kernel: %f D1: %f, %f, %f \n", state.N/sqrt(state.D1*state.D2), state.D1, state.D2, state.N);
+		// A worker holds only the terms of its own tasks
+		if(options==NULL || options->distributed_role!=SLT_worker)
+			fprintf(stderr,"Markovian kernel: %f D1: %f, %f, %f \n", state.N/sqrt(state.D1*state.D2), state.D1, state.D2, state.N);
 		break;
 
 
 	}
 
 	//printf("KL2: %f  KL3: %f\n", state.KL[2], state.KL[3]);
+	MAWs_finish_options(&state,options);
+	if(g_tables)
+		free_MAWs_g_tables(g_tables);
 
 	*_nMAWs1=state.nMAWs1;
 	*_nMAWs2=state.nMAWs2;
@@ -586,79 +1424,153 @@ unsigned int SLT_find_MAWs(Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,
 
 unsigned int SLT_find_RWs(Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,
 		unsigned int minlen, unsigned int * _nMAWs1,
-		unsigned int * _nMAWs2, double * _output_result, unsigned int mem, unsigned int cores, unsigned int result, unsigned int f1, unsigned int f2)
+		unsigned int * _nMAWs2, double * _output_result, unsigned int mem, unsigned int cores, unsigned int result, unsigned int f1, unsigned int f2,
+		const MAWs_options_t * options)
 {
 	SLT_joint_iterator_t * SLT_iterator;
 	MAWs_callback_state_t state;
 
-	unsigned int i;
-	state.nMAWs=0;
-	state.nMAWs1=0;
-	state.nMAWs2=0;
-	state.MAW_buffer=0;
-	state.MAW_buffer_idx=0;
-	state.nMAW_capacity=0;
-	state.minlen=minlen;
-	state.LW=0;
-	state.char_stack_capacity=4;
-	state.char_stack=(unsigned char *) malloc(state.char_stack_capacity);
-	FILE *f;
-	if(mem) {
-		f=fopen("output.txt", "a");
-		state.file=f;
-	}
-	length1= BBWT1->textlen+2;
-	length2= BBWT2->textlen+2;
+	MAWs_state_init(&state,BBWT1,BBWT2,minlen,mem,options);
 	F1= f1;
 	F2= f2;
-	state.N=0;
-	state.D1=0;
-	state.D2=0;
-
-	//Initializing D1 and D2
-	double prefix_sum= 0;
-	for(i=1; i<=BBWT1->textlen+2;i++) {
-		prefix_sum+= (g1(i)-1)*(g1(i)-1);
-		state.D1+=prefix_sum;
-	}
-	prefix_sum= 0;
-	for(i=1; i<=BBWT2->textlen+2;i++){
-		prefix_sum+= (g2(i)-1)*(g2(i)-1);
-		state.D2+=prefix_sum;
-	}
-
-	//Prefix sum allocation and initialization
-	state.prefix_capacity=4;
-	state.prefix_sum1=(double *)malloc(state.prefix_capacity*sizeof(double));
-	state.prefix_sum2=(double *)malloc(state.prefix_capacity*sizeof(double));
-	state.prefix_sumN=(double *)malloc(state.prefix_capacity*sizeof(double));
-	state.prefix_sum1[1]=(g1(1)-1)*(g1(1)-1);
-	state.prefix_sum2[1]=(g2(1)-1)*(g2(1)-1);
-	state.prefix_sumN[1]=(g1(1)-1)*(g2(1)-1);
-	//resize!
-	/*if(d> state.bitvec_sizes[i]){
-		state.bitvec_sizes[i]*=2;
-		state.bitvec[i]=realloc(state.bitvec[i],state.bitvec_sizes[i]/8);
-		memset(state.bitvec[i]+state.bitvec_sizes[i]/16,0,state.bitvec_sizes[i]/16);
-	state.bitvec_capacity=(unsigned int *) malloc(36*sizeof(unsigned int));
-	}
-	for(i=0;i<36;i++) state.bitvec_capacity[i]=32;
-		state.bitvec1= (unsigned int **)malloc(36*sizeof(int));
-	for(i=0;i<36;i++) {
-		for(i=0;i<36;i++) state.bitvec1[i]=(unsigned int *) calloc(1,sizeof(unsigned int));
-	}
-	state.KL_capacity= BBWT1->textlen+1;
-	state.KL= (double *) malloc(state.KL_capacity*sizeof(double));
-	*/
-	
-	SLT_iterator=new_SLT_joint_iterator(SLT_callback_RWs,SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
-	SLT_joint_execute_iterator(SLT_iterator);
+
+	SLT_iterator=new_SLT_joint_iterator(MAWs_select_callback(&state,SLT_callback_RWs),SLT_cloner, SLT_combiner,SLT_free,&state,BBWT1,BBWT2,SLT_stack_trick, mem, cores);
+	MAWs_execute(SLT_iterator,&state,result,mem,options);
+	MAWs_finish_options(&state,options);
 
 	*_nMAWs1=state.nMAWs1;
 	*_nMAWs2=state.nMAWs2;
 	return state.nMAWs;
 };
 
+// One state per reference for the one-vs-many traversal
+typedef struct
+{
+	unsigned int nrefs;
+	MAWs_callback_state_t ** states;
+} MAWs_multi_state_t;
+
+static void SLT_callback_MAWs_multi(const SLT_joint_params_t * SLT_joint_params,unsigned int ref,
+		void * intern_state,unsigned int mem)
+{
+	MAWs_callback_state_t * state=((MAWs_multi_state_t *)intern_state)->states[ref];
+	state->callback(SLT_joint_params,state,mem);
+};
+
+static void* SLT_cloner_multi(void* p, unsigned int t){
+	MAWs_multi_state_t* new_p=(MAWs_multi_state_t*) p;
+	MAWs_multi_state_t* temp=mem_malloc(mem_states,sizeof(MAWs_multi_state_t));
+	unsigned int r;
+	temp->nrefs=new_p->nrefs;
+	temp->states=mem_malloc(mem_states,new_p->nrefs*sizeof(MAWs_callback_state_t*));
+	for(r=0;r<new_p->nrefs;r++)
+		temp->states[r]=SLT_cloner(new_p->states[r],t);
+	return temp;
+};
+
+static void SLT_combiner_multi(void** intern_state, void* state, unsigned int t, unsigned int mem) {
+	MAWs_multi_state_t** p=(MAWs_multi_state_t**)intern_state;
+	MAWs_multi_state_t* s=(MAWs_multi_state_t*)state;
+	void** slaves;
+	unsigned int i,r;
+	for(r=0;r<s->nrefs;r++) {
+		// SLT_combiner frees the array and the states
+		slaves=malloc((t+1)*sizeof(void*));
+		for(i=0;i<t;i++)
+			slaves[i]=p[i]->states[r];
+		SLT_combiner(slaves,s->states[r],t,mem);
+	}
+	for(i=0;i<t;i++) {
+		mem_free(mem_states,p[i]->states,p[i]->nrefs*sizeof(MAWs_callback_state_t*));
+		mem_free(mem_states,p[i],sizeof(MAWs_multi_state_t));
+	}
+	free(intern_state);
+};
+
+static void SLT_free_multi(void* intern_state, unsigned int mem) {
+	MAWs_multi_state_t* state=(MAWs_multi_state_t*) intern_state;
+	unsigned int r;
+	for(r=0;r<state->nrefs;r++)
+		SLT_free(state->states[r],mem);
+};
+
+// The results of SLT_find_MAWs (result 1 and 3 to 6) or SLT_find_RWs
+// (result 2, thresholds f1 and f2) of query against every reference, from
+// one traversal of the query. For reference r the counts go to nMAWs[r],
+// nMAWs1[r] and nMAWs2[r], and output_result[r] is the LW distance or the
+// kernel. The kernel builds the g tables once per reference length. Returns
+// -1 for an unsupported result.
+int SLT_find_MAWs_multi(Basic_BWT_t * query,Basic_BWT_t ** refs,unsigned int nrefs,
+		unsigned int minlen,unsigned int cores,unsigned int result,unsigned int f1,unsigned int f2,
+		unsigned int * nMAWs,unsigned int * nMAWs1,unsigned int * nMAWs2,double * output_result)
+{
+	SLT_multi_iterator_t * SLT_iterator;
+	SLT_joint_callback_t callback;
+	MAWs_multi_state_t multi;
+	MAWs_callback_state_t * state;
+	unsigned int r,s;
+
+	switch(result) {
+	case 1:
+	case 4:
+	case 5:
+		callback=SLT_callback_MAWs;
+		break;
+	case 2:
+		callback=SLT_callback_RWs;
+		F1=f1;
+		F2=f2;
+		break;
+	case 3:
+		callback=SLT_callback_MAWs_present;
+		break;
+	case 6:
+		callback=SLT_callback_kernel;
+		break;
+	default:
+		return -1;
+	}
+	multi.nrefs=nrefs;
+	multi.states=mem_malloc(mem_states,nrefs*sizeof(MAWs_callback_state_t*));
+	for(r=0;r<nrefs;r++) {
+		state=multi.states[r]=mem_malloc(mem_states,sizeof(MAWs_callback_state_t));
+		MAWs_state_init(state,query,refs[r],minlen,0,NULL);
+		state->callback=callback;
+		if(result==6) {
+			// References of the same length share their tables
+			for(s=0;s<r && refs[s]->textlen!=refs[r]->textlen;s++);
+			state->g_tables=s<r?multi.states[s]->g_tables:new_MAWs_g_tables(query->textlen+2,refs[r]->textlen+2);
+			state->D1=MAWs_D_init(query->textlen+2);
+			state->D2=MAWs_D_init(refs[r]->textlen+2);
+			state->N=MAWs_N_init(query,refs[r]);
+		}
+	}
+
+	// SLT_find_MAWs passes SLT_stack_trick, which shares its bit with
+	// SLT_joint_or_enum: every pair is traversed on the union of its trees
+	SLT_iterator=new_SLT_multi_iterator(SLT_callback_MAWs_multi,SLT_cloner_multi,SLT_combiner_multi,
+			SLT_free_multi,&multi,query,refs,nrefs,SLT_joint_or_enum,0,cores);
+	SLT_multi_execute_iterator(SLT_iterator);
+	free_SLT_multi_iterator(SLT_iterator);
+
+	for(r=0;r<nrefs;r++) {
+		state=multi.states[r];
+		nMAWs[r]=state->nMAWs;
+		nMAWs1[r]=state->nMAWs1;
+		nMAWs2[r]=state->nMAWs2;
+		output_result[r]=result==6?state->N/sqrt(state->D1*state->D2):state->LW;
+	}
+	for(r=nrefs;r>0;r--) {
+		state=multi.states[r-1];
+		for(s=0;s<r-1 && multi.states[s]->g_tables!=state->g_tables;s++);
+		if(state->g_tables && s==r-1)
+			free_MAWs_g_tables((MAWs_g_tables_t *)state->g_tables);
+		mem_free(mem_states,state,sizeof(MAWs_callback_state_t));
+	}
+	mem_free(mem_states,multi.states,nrefs*sizeof(MAWs_callback_state_t*));
+	return 0;
+};
+
 void convert_MAWs_to_ACGT(unsigned char ** MAW_ptr,unsigned int nMAWs)
 {
 	unsigned int i;
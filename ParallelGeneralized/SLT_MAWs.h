@@ -1,17 +1,129 @@
 #ifndef SLT_MAWs_h
 #define SLT_MAWs_h
 #include"SLT.h"
+#include<stdio.h>
+
+// Per string_depth breakdown of the values accumulated by the callbacks.
+// Row d holds what the nodes of string depth d contributed, so MAWs
+// counted in row d have length d+2.
+typedef struct
+{
+	unsigned int capacity;
+	unsigned int length;
+	unsigned int * nMAWs;
+	unsigned int * nMAWs1;
+	unsigned int * nMAWs2;
+	double * LW;
+	double * N;
+	double * D1;
+	double * D2;
+} MAWs_histogram_t;
+
+// A length weighting gives the weight of a MAW of length len in an LW-style
+// score. LW itself is the weighting 1/len^2.
+typedef double (*MAWs_weight_fn_t)(unsigned int len, const double * params);
+
+typedef struct
+{
+	const char * name;
+	MAWs_weight_fn_t weight;
+	double params[2];
+	double value;
+} MAWs_weighting_t;
+
+#define MAWs_topk_by_length 0
+#define MAWs_topk_by_freq 1
+#define MAWs_topk_by_expected 2
+#define MAWs_topk_by_kernel 3
+
+typedef struct
+{
+	double score;
+	unsigned int len;
+	unsigned int word_capacity;
+	unsigned char * word;
+} MAWs_topk_entry_t;
+
+// Bounded min-heap keeping the k best scoring words reported by a callback.
+// Words are scored by shortness, by rarity (the smallest min(f(aW),f(Wb))),
+// or by the Markov expected count f(aW)f(Wb)/f(W) of the absent word aWb,
+// taking the minimum over the genomes in which the word is reported absent
+// or rare. The kernel callback scores the words aWb instead by the absolute
+// value of their correction to N, the numerator of the kernel.
+typedef struct
+{
+	unsigned int k;
+	unsigned int score_by;
+	unsigned int n;
+	MAWs_topk_entry_t * heap;
+} MAWs_topk_t;
+
+typedef struct
+{
+	MAWs_histogram_t * hist;
+	// Evaluated over the symmetric difference of the words of the two texts,
+	// which results 3 and 6 do not count: meaningless there
+	MAWs_weighting_t * weightings;
+	unsigned int nweightings;
+	MAWs_topk_t * topk;
+	// Append to each MAW written to output.txt the text positions of one
+	// occurrence of aW and one of Wb. Needs Basic_BWT_build_SA_samples on both
+	// texts.
+	unsigned int witnesses;
+	// The texts are followed by their reverse complement: count, weigh and
+	// report only one word of each (aWb, reverse complement of aWb) pair.
+	// A filter of the words of the MAW and rare word callbacks, not a
+	// traversal of one word of each pair: the traversal and its cost are the
+	// same as without it, and the kernel callback ignores it.
+	unsigned int canonical_filter;
+	// Checkpoint file of the slave tasks, written every checkpoint_interval
+	// seconds and resumed from if it exists (see SLT_checkpoint.h). Ignored
+	// when the MAWs are written to output.txt.
+	const char * checkpoint;
+	double checkpoint_interval;
+	// Directory of the tasks shared with other processes and the role of
+	// this one, SLT_coordinator or SLT_worker, and the timeout of the
+	// processes in seconds (see SLT_distributed.h); it takes the place of
+	// the checkpoint. A worker returns partial values. Ignored when the
+	// MAWs are written to output.txt.
+	const char * distributed_dir;
+	unsigned int distributed_role;
+	double distributed_timeout;
+} MAWs_options_t;
 
 void SLT_callback_MAWs_single_string(const SLT_joint_params_t * SLT_params,void * intern_state, unsigned int memory);
 void SLT_callback_MAWs(const SLT_joint_params_t * SLT_params,void * intern_state, unsigned int memory);
 void SLT_callback_MAWs_present(const SLT_joint_params_t * SLT_params,void * intern_state, unsigned int memory);
 void SLT_callback_MAWs_kernel(const SLT_joint_params_t * SLT_params,void * intern_state, unsigned int memory);
 void SLT_callback_RWs(const SLT_joint_params_t * SLT_params,void * intern_state, unsigned int memory);
+void SLT_callback_histogram(const SLT_joint_params_t * SLT_params,void * intern_state, unsigned int memory);
 void* SLT_cloner(void* p, unsigned int t);
 void SLT_combiner(void** intern_state, void* state, unsigned int t, unsigned int mem);
 void SLT_free(void* intern_state, unsigned int mem);
 unsigned int SLT_find_MAWs(Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,
-		unsigned int minlen, unsigned int * nMAWs1,unsigned int * nMAWs2, double * LW,unsigned int mem, unsigned int cores, unsigned int result);
+		unsigned int minlen, unsigned int * nMAWs1,unsigned int * nMAWs2, double * LW,unsigned int mem, unsigned int cores, unsigned int result,
+		const MAWs_options_t * options);
+unsigned int SLT_find_RWs(Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,
+		unsigned int minlen, unsigned int * nMAWs1,unsigned int * nMAWs2, double * LW,unsigned int mem, unsigned int cores, unsigned int result,
+		unsigned int f1, unsigned int f2, const MAWs_options_t * options);
+int SLT_find_MAWs_multi(Basic_BWT_t * query,Basic_BWT_t ** refs,unsigned int nrefs,
+		unsigned int minlen,unsigned int cores,unsigned int result,unsigned int f1,unsigned int f2,
+		unsigned int * nMAWs,unsigned int * nMAWs1,unsigned int * nMAWs2,double * output_result);
+MAWs_histogram_t * new_MAWs_histogram();
+void free_MAWs_histogram(MAWs_histogram_t * hist);
+void MAWs_histogram_merge(MAWs_histogram_t * dst, const MAWs_histogram_t * src);
+void MAWs_histogram_write(const MAWs_histogram_t * hist, FILE * out);
+double MAWs_weight_inverse_square(unsigned int len, const double * params);
+double MAWs_weight_power(unsigned int len, const double * params);
+double MAWs_weight_exponential(unsigned int len, const double * params);
+double MAWs_weight_window(unsigned int len, const double * params);
+int MAWs_parse_weighting(const char * spec, MAWs_weighting_t * weighting);
+MAWs_topk_t * new_MAWs_topk(unsigned int k, unsigned int score_by);
+void free_MAWs_topk(MAWs_topk_t * topk);
+void MAWs_topk_merge(MAWs_topk_t * dst, const MAWs_topk_t * src);
+void MAWs_topk_sort(MAWs_topk_t * topk);
+void MAWs_topk_write(MAWs_topk_t * topk, FILE * out);
+void MAWs_weightings_evaluate(const MAWs_histogram_t * hist, MAWs_weighting_t * weightings, unsigned int nweightings);
 void convert_MAWs_to_ACGT(unsigned char ** MAW_ptr,unsigned int nMAWs);
 double g1(int y);
 double g2(int y);
@@ -0,0 +1,388 @@
+#include"stdlib.h"
+#include"stdio.h"
+#include <string.h>
+#include"SLT_MAWs_records.h"
+
+// Rows per block of the range minimum structure of MAWs_record_list_t
+#define MAWs_record_block 64
+
+// Document listing (Muthukrishnan): prev[row] is one plus the previous row
+// of the same record, 0 for the first row of a record. The records of the
+// rows [l,r] are those of the rows whose prev is at most l, each found once
+// by range minimum queries on prev: block_min[k][b] is the row of the
+// minimum over the blocks b to b+2^k-1.
+typedef struct
+{
+	const unsigned int * doc;
+	unsigned int * prev;
+	unsigned int nblocks;
+	unsigned int nlevels;
+	unsigned int ** block_min;
+} MAWs_record_list_t;
+
+typedef struct
+{
+	unsigned int minlen;
+	Basic_BWT_t * BBWT;
+	const MAWs_record_list_t * list;
+	// Shared by all the slave states, updated atomically
+	MAWs_record_matrix_t * matrix;
+	// Shared by all the slave states, set when a slave cannot allocate its
+	// scratch
+	int * failed;
+	// Scratch of the callback, allocated at the first node: the membership
+	// bits of every record, its lists of records and the stack of row ranges
+	unsigned char * mark;
+	unsigned int * records;
+	unsigned int * stack;
+} MAWs_record_state_t;
+
+
+MAWs_record_matrix_t * new_MAWs_record_matrix(unsigned int nrecords)
+{
+	MAWs_record_matrix_t * matrix;
+	size_t npairs=(size_t)nrecords*(nrecords-1)/2+1;
+	if(nrecords==0)
+		return NULL;
+	matrix=(MAWs_record_matrix_t *) calloc(1,sizeof(MAWs_record_matrix_t));
+	if(matrix==NULL)
+		return NULL;
+	matrix->nrecords=nrecords;
+	matrix->nMAWs=(unsigned int *)calloc(nrecords,sizeof(unsigned int));
+	matrix->LW=(double *)calloc(nrecords,sizeof(double));
+	matrix->common=(unsigned int *)calloc(npairs,sizeof(unsigned int));
+	matrix->common_LW=(double *)calloc(npairs,sizeof(double));
+	if(matrix->nMAWs==NULL || matrix->LW==NULL || matrix->common==NULL || matrix->common_LW==NULL) {
+		free_MAWs_record_matrix(matrix);
+		return NULL;
+	}
+	return matrix;
+};
+
+void free_MAWs_record_matrix(MAWs_record_matrix_t * matrix)
+{
+	if(matrix==NULL)
+		return;
+	free(matrix->nMAWs);
+	free(matrix->LW);
+	free(matrix->common);
+	free(matrix->common_LW);
+	free(matrix);
+};
+
+// Jaccard similarity and LW distance between the MAW sets of every pair of
+// records, as two tab separated matrices
+void MAWs_record_matrix_write(const MAWs_record_matrix_t * matrix,char ** names,FILE * out)
+{
+	unsigned int n=matrix->nrecords;
+	unsigned int r,s,common;
+	double common_LW;
+	fprintf(out,"Jaccard");
+	for(s=0;s<n;s++)
+		fprintf(out,"\t%s",names[s]);
+	fprintf(out,"\n");
+	for(r=0;r<n;r++) {
+		fprintf(out,"%s",names[r]);
+		for(s=0;s<n;s++) {
+			common=r==s?matrix->nMAWs[r]:matrix->common[r<s?MAWs_record_pair(n,r,s):MAWs_record_pair(n,s,r)];
+			fprintf(out,"\t%f",matrix->nMAWs[r]+matrix->nMAWs[s]==common?1.0:
+					(double)common/(matrix->nMAWs[r]+matrix->nMAWs[s]-common));
+		}
+		fprintf(out,"\n");
+	}
+	fprintf(out,"LW");
+	for(s=0;s<n;s++)
+		fprintf(out,"\t%s",names[s]);
+	fprintf(out,"\n");
+	for(r=0;r<n;r++) {
+		fprintf(out,"%s",names[r]);
+		for(s=0;s<n;s++) {
+			common_LW=r==s?matrix->LW[r]:matrix->common_LW[r<s?MAWs_record_pair(n,r,s):MAWs_record_pair(n,s,r)];
+			fprintf(out,"\t%f",matrix->LW[r]+matrix->LW[s]-2*common_LW);
+		}
+		fprintf(out,"\n");
+	}
+};
+
+static void free_MAWs_record_list(MAWs_record_list_t * list)
+{
+	unsigned int k;
+	if(list->block_min)
+		for(k=0;k<list->nlevels;k++)
+			free(list->block_min[k]);
+	free(list->block_min);
+	free(list->prev);
+};
+
+// prev and the range minima over the blocks of the nrows rows of doc
+static int MAWs_record_list_build(MAWs_record_list_t * list,const unsigned int * doc,
+		unsigned int nrows,unsigned int nrecords)
+{
+	unsigned int * last;
+	unsigned int row,b,k,m;
+	const unsigned int * left;
+	memset(list,0,sizeof(MAWs_record_list_t));
+	list->doc=doc;
+	list->prev=(unsigned int *)malloc(nrows*sizeof(unsigned int));
+	last=(unsigned int *)calloc(nrecords,sizeof(unsigned int));
+	list->nblocks=(nrows+MAWs_record_block-1)/MAWs_record_block;
+	for(list->nlevels=1;(2u<<(list->nlevels-1))<=list->nblocks;list->nlevels++);
+	list->block_min=(unsigned int **)calloc(list->nlevels,sizeof(unsigned int *));
+	if(list->prev==NULL || last==NULL || list->block_min==NULL) {
+		free(last);
+		free_MAWs_record_list(list);
+		return -1;
+	}
+	for(row=0;row<nrows;row++) {
+		list->prev[row]=last[doc[row]];
+		last[doc[row]]=row+1;
+	}
+	free(last);
+	for(k=0;k<list->nlevels;k++)
+		if((list->block_min[k]=(unsigned int *)malloc(list->nblocks*sizeof(unsigned int)))==NULL) {
+			free_MAWs_record_list(list);
+			return -1;
+		}
+	for(b=0;b<list->nblocks;b++) {
+		m=b*MAWs_record_block;
+		for(row=m+1;row<nrows && row<(b+1)*MAWs_record_block;row++)
+			if(list->prev[row]<list->prev[m])
+				m=row;
+		list->block_min[0][b]=m;
+	}
+	for(k=1;k<list->nlevels;k++) {
+		left=list->block_min[k-1];
+		for(b=0;b+(1u<<k)<=list->nblocks;b++) {
+			m=left[b+(1u<<(k-1))];
+			list->block_min[k][b]=list->prev[left[b]]<=list->prev[m]?left[b]:m;
+		}
+	}
+	return 0;
+};
+
+// Row of the minimum of prev over the rows [l,r]
+static unsigned int MAWs_record_argmin(const MAWs_record_list_t * list,unsigned int l,unsigned int r)
+{
+	const unsigned int * prev=list->prev;
+	unsigned int bl=l/MAWs_record_block;
+	unsigned int br=r/MAWs_record_block;
+	unsigned int m=l,row,k;
+	if(br<=bl+1) {
+		for(row=l+1;row<=r;row++)
+			if(prev[row]<prev[m])
+				m=row;
+		return m;
+	}
+	for(row=l+1;row<(bl+1)*MAWs_record_block;row++)
+		if(prev[row]<prev[m])
+			m=row;
+	for(row=br*MAWs_record_block;row<=r;row++)
+		if(prev[row]<prev[m])
+			m=row;
+	k=31-__builtin_clz(br-bl-1);
+	row=list->block_min[k][bl+1];
+	if(prev[row]<prev[m])
+		m=row;
+	row=list->block_min[k][br-(1u<<k)];
+	if(prev[row]<prev[m])
+		m=row;
+	return m;
+};
+
+// Append the records of the count rows from start to state->records[*n], and
+// set bit in their mark. Takes time proportional to the number of records.
+static void MAWs_record_list(MAWs_record_state_t * state,unsigned int start,unsigned int count,
+		unsigned int * n,unsigned char bit)
+{
+	const MAWs_record_list_t * list=state->list;
+	unsigned int * stack=state->stack;
+	unsigned int top=0,l,r,m;
+	if(count==0)
+		return;
+	stack[top++]=start;
+	stack[top++]=start+count-1;
+	while(top) {
+		r=stack[--top];
+		l=stack[--top];
+		m=MAWs_record_argmin(list,l,r);
+		// Not the first row of its record from start on
+		if(list->prev[m]>start)
+			continue;
+		state->records[(*n)++]=list->doc[m];
+		state->mark[list->doc[m]]|=bit;
+		if(m>l) {
+			stack[top++]=l;
+			stack[top++]=m-1;
+		}
+		if(m<r) {
+			stack[top++]=m+1;
+			stack[top++]=r;
+		}
+	}
+};
+
+// aWb is a MAW of each of the n records of records
+static void MAWs_record_add(MAWs_record_matrix_t * matrix,const unsigned int * records,unsigned int n,double x)
+{
+	unsigned int k,l,r,s;
+	size_t pair;
+	for(k=0;k<n;k++) {
+		r=records[k];
+#pragma omp atomic
+		matrix->nMAWs[r]++;
+#pragma omp atomic
+		matrix->LW[r]+=x;
+		for(l=k+1;l<n;l++) {
+			s=records[l];
+			pair=r<s?MAWs_record_pair(matrix->nrecords,r,s):MAWs_record_pair(matrix->nrecords,s,r);
+#pragma omp atomic
+			matrix->common[pair]++;
+#pragma omp atomic
+			matrix->common_LW[pair]+=x;
+		}
+	}
+};
+
+// The records containing aW and Wb but not aWb, for every maximal repeat W.
+// The rows of aW, of Wb and of aWb are intervals of the BWT, so the records
+// of each come from the document listing in time proportional to their
+// number, whatever the number of occurrences. Bits 0-3 of mark flag the
+// records of Wb and bits 4-7 those of aWb.
+void SLT_callback_record_MAWs(const SLT_joint_params_t * SLT_joint_params,void * intern_state, unsigned int mem)
+{
+	MAWs_record_state_t * state= (MAWs_record_state_t*)(intern_state);
+	unsigned int nrecords=state->matrix->nrecords;
+	unsigned int Wb_start[6],Wb_count[6];
+	unsigned int in_interval[2],aW_interval[2];
+	unsigned int row,count,n,nWb,naWb,naW,nMAW;
+	unsigned int i,j,k;
+	unsigned char bits;
+	double x;
+
+	if(*state->failed || SLT_joint_params->string_depth + 2 < state->minlen ||
+			SLT_joint_params->nleft_extensions1 < 2 || SLT_joint_params->nright_extensions1 < 2)
+		return;
+	if(state->mark==NULL) {
+		state->mark=(unsigned char *)calloc(nrecords,sizeof(unsigned char));
+		// The lists of Wb, aWb, aW and of one MAW aWb
+		state->records=(unsigned int *)malloc(10*(size_t)nrecords*sizeof(unsigned int));
+		state->stack=(unsigned int *)malloc(2*((size_t)nrecords+1)*sizeof(unsigned int));
+		if(state->mark==NULL || state->records==NULL || state->stack==NULL) {
+			fprintf(stderr," Error: Cannot allocate the record lists of %u records\n",nrecords);
+#pragma omp atomic write
+			*state->failed=1;
+			return;
+		}
+	}
+
+	// The children Wb are sorted by b, and so are the rows of aWb within aW
+	row=SLT_joint_params->interval_start1;
+	for(j=0;j<6;j++) {
+		count=0;
+		for(i=0;i<6;i++)
+			count+=SLT_joint_params->left_right_extension_freqs1[i][j];
+		Wb_start[j]=row;
+		Wb_count[j]=count;
+		row+=count;
+	}
+	n=0;
+	for(j=1;j<5;j++)
+		MAWs_record_list(state,Wb_start[j],Wb_count[j],&n,1<<(j-1));
+	nWb=n;
+	x=1.0/((double)(SLT_joint_params->string_depth+2)*(SLT_joint_params->string_depth+2));
+	// Backward_step takes SA indexes, the BWT rows minus one. The root
+	// holds the '$' row, which has none.
+	in_interval[0]=SLT_joint_params->interval_start1-1;
+	in_interval[1]=row-2;
+	for(i=1;i<5;i++) {
+		if(!(SLT_joint_params->left_extension_bitmap1&(1<<i)))
+			continue;
+		if(SLT_joint_params->interval_start1==0) {
+			aW_interval[0]=state->BBWT->char_base[i-1];
+			aW_interval[1]=state->BBWT->char_base[i]-1;
+		}
+		else if(Backward_step(in_interval,aW_interval,i-1,state->BBWT)!=0)
+			continue;
+		row=aW_interval[0]+1;
+		n=nWb;
+		for(j=0;j<6;j++) {
+			if(j>=1 && j<5)
+				MAWs_record_list(state,row,SLT_joint_params->left_right_extension_freqs1[i][j],&n,16<<(j-1));
+			row+=SLT_joint_params->left_right_extension_freqs1[i][j];
+		}
+		naWb=n;
+		MAWs_record_list(state,aW_interval[0]+1,aW_interval[1]-aW_interval[0]+1,&n,0);
+		naW=n;
+		for(j=1;j<5;j++) {
+			nMAW=naW;
+			for(k=naWb;k<naW;k++) {
+				bits=state->mark[state->records[k]];
+				if((bits&(1<<(j-1))) && !(bits&(16<<(j-1))))
+					state->records[nMAW++]=state->records[k];
+			}
+			MAWs_record_add(state->matrix,state->records+naW,nMAW-naW,x);
+		}
+		for(k=nWb;k<naWb;k++)
+			state->mark[state->records[k]]&=15;
+	}
+	for(k=0;k<nWb;k++)
+		state->mark[state->records[k]]=0;
+}
+
+static void* SLT_record_cloner(void* p, unsigned int t){
+	MAWs_record_state_t* temp= malloc(sizeof(MAWs_record_state_t));
+	MAWs_record_state_t* new_p= (MAWs_record_state_t*) p;
+	memcpy(temp,new_p,sizeof(MAWs_record_state_t));
+	temp->mark=NULL;
+	temp->records=NULL;
+	temp->stack=NULL;
+	return temp;
+};
+
+static void SLT_record_combiner(void** intern_state, void* state, unsigned int t,unsigned int mem) {
+	unsigned int i;
+	MAWs_record_state_t** p=(MAWs_record_state_t**)intern_state;
+	// The slaves added to the shared matrix as they went
+	for(i=0; i<t; i++)
+		free(p[i]);
+	free(intern_state);
+};
+
+static void SLT_record_free(void* intern_state, unsigned int mem) {
+	MAWs_record_state_t * state= (MAWs_record_state_t*)(intern_state);
+	free(state->mark);
+	free(state->records);
+	free(state->stack);
+	state->mark=NULL;
+	state->records=NULL;
+	state->stack=NULL;
+};
+
+// Per record MAWs of one text whose records end with a separator, from one
+// traversal. doc is the document array of BBWT (Basic_BWT_document_array).
+// The joint iterator runs with BBWT on both sides and the callback only looks
+// at the first one.
+int SLT_find_record_MAWs(Basic_BWT_t * BBWT,const unsigned int * doc,
+		unsigned int minlen,unsigned int cores,MAWs_record_matrix_t * matrix)
+{
+	SLT_joint_iterator_t * SLT_iterator;
+	MAWs_record_state_t state;
+	MAWs_record_list_t list;
+	int failed=0;
+	if(doc==NULL || matrix==NULL ||
+			MAWs_record_list_build(&list,doc,BBWT->textlen+1,matrix->nrecords)!=0)
+		return -1;
+	memset(&state,0,sizeof(MAWs_record_state_t));
+	state.minlen=minlen;
+	state.BBWT=BBWT;
+	state.list=&list;
+	state.matrix=matrix;
+	state.failed=&failed;
+	SLT_iterator=new_SLT_joint_iterator(SLT_callback_record_MAWs,SLT_record_cloner,SLT_record_combiner,
+			SLT_record_free,&state,BBWT,BBWT,SLT_stack_trick,0,cores);
+	SLT_joint_execute_iterator(SLT_iterator);
+	free_SLT_joint_iterator(SLT_iterator);
+	SLT_record_free(&state,0);
+	free_MAWs_record_list(&list);
+	return failed ? -1 : 0;
+};
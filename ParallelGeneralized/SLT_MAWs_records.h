@@ -0,0 +1,33 @@
+#ifndef SLT_MAWs_records_h
+#define SLT_MAWs_records_h
+#include<stdio.h>
+#include"SLT.h"
+
+// Per record MAW statistics of a text made of nrecords records, each ending
+// with a separator: the MAWs of every record, their LW mass (sum of 1/len^2)
+// and, for every pair of records r<s, the MAWs they have in common, stored
+// at MAWs_record_pair(nrecords,r,s).
+typedef struct
+{
+	unsigned int nrecords;
+	unsigned int * nMAWs;
+	double * LW;
+	unsigned int * common;
+	double * common_LW;
+} MAWs_record_matrix_t;
+
+// Index of the pair r<s in the upper triangle of an n x n matrix
+static inline size_t MAWs_record_pair(unsigned int n,unsigned int r,unsigned int s)
+{
+	return (size_t)r*(2*(size_t)n-r-1)/2+(s-r-1);
+};
+
+MAWs_record_matrix_t * new_MAWs_record_matrix(unsigned int nrecords);
+void free_MAWs_record_matrix(MAWs_record_matrix_t * matrix);
+void MAWs_record_matrix_write(const MAWs_record_matrix_t * matrix,char ** names,FILE * out);
+
+void SLT_callback_record_MAWs(const SLT_joint_params_t * SLT_joint_params,void * intern_state, unsigned int mem);
+int SLT_find_record_MAWs(Basic_BWT_t * BBWT,const unsigned int * doc,
+		unsigned int minlen,unsigned int cores,MAWs_record_matrix_t * matrix);
+
+#endif
@@ -111,5 +111,13 @@ unsigned int SLT_find_MAWs_single_string(Basic_BWT_t * BBWT1, unsigned int minle
 	}
 	SLT_iterator=new_SLT_iterator(SLT_MAWs_callback,&state,BBWT1,SLT_stack_trick, mem);
 	SLT_execute_iterator(SLT_iterator);
-
+	free_SLT_iterator(SLT_iterator);
+	if(mem) {
+		fwrite(state.MAW_buffer, state.MAW_buffer_idx, sizeof(char), state.file);
+		fclose(state.file);
+		free(state.MAW_buffer);
+	}
+	free(state.char_stack);
+	*_nMAWs1=state.nMAWs;
+	return state.nMAWs;
 };
@@ -1,5 +1,5 @@
-#ifndef SLT_MAWs_h
-#define SLT_MAWs_h
+#ifndef SLT_MAWs_single_string_h
+#define SLT_MAWs_single_string_h
 #include"SLT_single_string.h"
 
 void SLT_MAWs_callback(const SLT_params_t * SLT_params,void * intern_state, unsigned int mem);
@@ -0,0 +1,88 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include"SLT_checkpoint.h"
+
+#define SLT_checkpoint_magic "SLTckpt1"
+
+// magic has 8 characters
+void SLT_checkpoint_header(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		const char * magic,SLT_checkpoint_header_t * header)
+{
+	memset(header,0,sizeof(SLT_checkpoint_header_t));
+	memcpy(header->magic,magic,sizeof(header->magic));
+	header->tag=SLT_iterator->state_tag;
+	header->textlen1=SLT_iterator->BBWT1->textlen;
+	header->textlen2=SLT_iterator->BBWT2->textlen;
+	memcpy(header->char_base1,SLT_iterator->BBWT1->char_base,sizeof(header->char_base1));
+	memcpy(header->char_base2,SLT_iterator->BBWT2->char_base,sizeof(header->char_base2));
+	header->ntasks=ntasks;
+};
+
+// Written to path.tmp and renamed, so that the file is always complete
+int SLT_checkpoint_write(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		const unsigned char * done,void ** intern_states)
+{
+	SLT_checkpoint_header_t header;
+	char * tmp_path=(char *)malloc(strlen(SLT_iterator->checkpoint_path)+5);
+	FILE * f;
+	unsigned int i;
+	int res=0;
+	if(tmp_path==NULL)
+		return -1;
+	sprintf(tmp_path,"%s.tmp",SLT_iterator->checkpoint_path);
+	if((f=fopen(tmp_path,"wb"))==NULL) {
+		free(tmp_path);
+		return -1;
+	}
+	SLT_checkpoint_header(SLT_iterator,ntasks,SLT_checkpoint_magic,&header);
+	for(i=0;i<ntasks;i++)
+		header.ndone+=done[i];
+	if(fwrite(&header,sizeof(header),1,f)!=1)
+		res=-1;
+	for(i=0;i<ntasks && res==0;i++)
+		if(done[i] && (fwrite(&i,sizeof(i),1,f)!=1 || SLT_iterator->SLT_write_state(intern_states[i],f)!=0))
+			res=-1;
+	if(fclose(f)!=0)
+		res=-1;
+	if(res==0 && rename(tmp_path,SLT_iterator->checkpoint_path)!=0)
+		res=-1;
+	if(res!=0)
+		remove(tmp_path);
+	free(tmp_path);
+	return res;
+};
+
+unsigned int SLT_checkpoint_read(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		unsigned char * done,void ** intern_states)
+{
+	SLT_checkpoint_header_t header;
+	SLT_checkpoint_header_t expected;
+	FILE * f=fopen(SLT_iterator->checkpoint_path,"rb");
+	unsigned int i,task,nrestored=0;
+	if(f==NULL)
+		return 0;
+	SLT_checkpoint_header(SLT_iterator,ntasks,SLT_checkpoint_magic,&expected);
+	if(fread(&header,sizeof(header),1,f)!=1)
+		memset(&header,0,sizeof(header));
+	expected.ndone=header.ndone;
+	if(memcmp(&header,&expected,sizeof(header))!=0) {
+		fprintf(stderr," Warning: %s is not a checkpoint of this computation, it will be overwritten\n",
+				SLT_iterator->checkpoint_path);
+		fclose(f);
+		return 0;
+	}
+	// A damaged record ends the restore: its task and the next ones are run
+	for(i=0;i<header.ndone;i++) {
+		if(fread(&task,sizeof(task),1,f)!=1 || task>=ntasks || done[task]
+				|| SLT_iterator->SLT_read_state(intern_states[task],f)!=0) {
+			fprintf(stderr," Warning: damaged checkpoint %s, %u of %u tasks restored\n",
+					SLT_iterator->checkpoint_path,nrestored,header.ndone);
+			break;
+		}
+		done[task]=1;
+		nrestored++;
+	}
+	fclose(f);
+	return nrestored;
+};
@@ -0,0 +1,55 @@
+#ifndef SLT_checkpoint_h
+#define SLT_checkpoint_h
+#include<stdio.h>
+#include"SLT.h"
+
+// Checkpoints of the slave tasks of a joint traversal. Every interval
+// seconds, when a task ends, the states of the completed tasks are written
+// with SLT_write_state to the checkpoint file, together with their task
+// numbers. A traversal of the same texts with the same tag that finds the
+// file reads those states back with SLT_read_state into the clones of the
+// same tasks, runs only the other tasks, and removes the file when it
+// completes. The master traversal, down to the depth of the tasks, is run
+// again: it is deterministic and takes a negligible share of the time.
+//
+// SLT_write_state returns -1 on error. SLT_read_state adds the values of one
+// state to intern_state, or leaves it unchanged and returns -1 on error.
+// The tag tells computations apart (callback, parameters, options).
+static inline void SLT_joint_set_checkpoint(SLT_joint_iterator_t * SLT_iterator,const char * path,
+		double interval,unsigned long long tag,SLT_state_writer_t SLT_write_state,
+		SLT_state_reader_t SLT_read_state)
+{
+	SLT_iterator->checkpoint_path=path;
+	SLT_iterator->checkpoint_interval=interval;
+	SLT_iterator->state_tag=tag;
+	SLT_iterator->SLT_write_state=SLT_write_state;
+	SLT_iterator->SLT_read_state=SLT_read_state;
+};
+
+// Header of the files of slave states: the tag and the texts, as far as
+// the header can tell them apart
+typedef struct
+{
+	char magic[8];
+	unsigned long long tag;
+	unsigned int textlen1;
+	unsigned int textlen2;
+	unsigned int char_base1[5];
+	unsigned int char_base2[5];
+	unsigned int ntasks;
+	unsigned int ndone;
+} SLT_checkpoint_header_t;
+
+void SLT_checkpoint_header(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		const char * magic,SLT_checkpoint_header_t * header);
+
+// Write the states of the tasks with done[i] set. Returns -1 on error.
+int SLT_checkpoint_write(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		const unsigned char * done,void ** intern_states);
+// Restore the tasks of the checkpoint file, if any, and set done[i] for
+// them. Returns the number of tasks restored, 0 if there is no checkpoint
+// of this traversal.
+unsigned int SLT_checkpoint_read(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		unsigned char * done,void ** intern_states);
+
+#endif
@@ -0,0 +1,383 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<signal.h>
+#include<time.h>
+#include<unistd.h>
+#include<dirent.h>
+#include<sys/stat.h>
+#include<omp.h>
+#include"SLT_distributed.h"
+#include"SLT_checkpoint.h"
+#include"SLT_instrument.h"
+#include"phase_log.h"
+
+#define SLT_frontier_magic "SLTfront"
+#define SLT_result_magic "SLTtask1"
+#define SLT_done_magic "SLTended"
+#define SLT_distributed_host_len 256
+
+// What dir/frontier holds, compared with the frontier of this traversal
+#define SLT_frontier_absent 0
+#define SLT_frontier_same 1
+#define SLT_frontier_other_tag 2
+#define SLT_frontier_other_texts 3
+#define SLT_frontier_other_tasks 4
+
+static const char * const SLT_frontier_mismatches[]={NULL,NULL,
+		"the options differ","the texts differ","the tasks differ"};
+// Period at which a process looks again at the files of the others
+#define SLT_distributed_poll_us 100000
+#define SLT_distributed_path_len 4096
+
+// dir/name, or dir/name.task if task is not negative
+static void SLT_distributed_path(const SLT_joint_iterator_t * SLT_iterator,const char * name,int task,char * path)
+{
+	if(task<0)
+		snprintf(path,SLT_distributed_path_len,"%s/%s",SLT_iterator->distributed_dir,name);
+	else
+		snprintf(path,SLT_distributed_path_len,"%s/%s.%d",SLT_iterator->distributed_dir,name,task);
+};
+
+// The fields of a task set by the master
+static void SLT_frontier_fields(const SLT_stack_item_t * item,unsigned int * fields)
+{
+	fields[0]=item->string_depth;
+	fields[1]=item->interval_start1;
+	fields[2]=item->interval_start2;
+	fields[3]=item->interval_size1;
+	fields[4]=item->interval_size2;
+	fields[5]=item->WL_char;
+};
+
+// Written to a temporary file and renamed, as the results
+static int SLT_frontier_write(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		const SLT_stack_item_t * slave_stack_item)
+{
+	SLT_checkpoint_header_t header;
+	char path[SLT_distributed_path_len];
+	char tmp_path[SLT_distributed_path_len];
+	unsigned int fields[6];
+	unsigned int i;
+	FILE * f;
+	int res=0;
+	SLT_distributed_path(SLT_iterator,"frontier",-1,path);
+	SLT_distributed_path(SLT_iterator,"frontier.tmp",-1,tmp_path);
+	if((f=fopen(tmp_path,"wb"))==NULL)
+		return -1;
+	SLT_checkpoint_header(SLT_iterator,ntasks,SLT_frontier_magic,&header);
+	if(fwrite(&header,sizeof(header),1,f)!=1)
+		res=-1;
+	for(i=0;i<ntasks && res==0;i++) {
+		SLT_frontier_fields(&slave_stack_item[i],fields);
+		if(fwrite(fields,sizeof(unsigned int),6,f)!=6)
+			res=-1;
+	}
+	if(fclose(f)!=0)
+		res=-1;
+	if(res==0 && rename(tmp_path,path)!=0)
+		res=-1;
+	return res;
+};
+
+// Compare dir/frontier with the frontier of this traversal, telling apart
+// the traversals of other options (tags) and of other texts
+static int SLT_frontier_check(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		const SLT_stack_item_t * slave_stack_item)
+{
+	SLT_checkpoint_header_t header;
+	SLT_checkpoint_header_t expected;
+	char path[SLT_distributed_path_len];
+	unsigned int fields[6];
+	unsigned int read_fields[6];
+	unsigned int i;
+	int status;
+	FILE * f;
+	SLT_distributed_path(SLT_iterator,"frontier",-1,path);
+	if((f=fopen(path,"rb"))==NULL)
+		return SLT_frontier_absent;
+	SLT_checkpoint_header(SLT_iterator,ntasks,SLT_frontier_magic,&expected);
+	if(fread(&header,sizeof(header),1,f)!=1 || memcmp(header.magic,expected.magic,sizeof(header.magic))!=0)
+		status=SLT_frontier_other_tasks;
+	else if(header.tag!=expected.tag)
+		status=SLT_frontier_other_tag;
+	else if(memcmp(&header,&expected,sizeof(header))!=0)
+		status=header.ntasks!=expected.ntasks?SLT_frontier_other_tasks:SLT_frontier_other_texts;
+	else
+		status=SLT_frontier_same;
+	for(i=0;i<ntasks && status==SLT_frontier_same;i++) {
+		SLT_frontier_fields(&slave_stack_item[i],fields);
+		if(fread(read_fields,sizeof(unsigned int),6,f)!=6 || memcmp(fields,read_fields,sizeof(fields))!=0)
+			status=SLT_frontier_other_tasks;
+	}
+	fclose(f);
+	return status;
+};
+
+// Left by the coordinator once it has combined all the tasks, for the
+// workers started too late
+static void SLT_done_write(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks)
+{
+	SLT_checkpoint_header_t header;
+	char path[SLT_distributed_path_len];
+	FILE * f;
+	SLT_distributed_path(SLT_iterator,"done",-1,path);
+	SLT_checkpoint_header(SLT_iterator,ntasks,SLT_done_magic,&header);
+	if((f=fopen(path,"wb"))==NULL)
+		return;
+	if(fwrite(&header,sizeof(header),1,f)!=1 || fclose(f)!=0)
+		remove(path);
+};
+
+static int SLT_done_exists(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks)
+{
+	SLT_checkpoint_header_t header;
+	SLT_checkpoint_header_t expected;
+	char path[SLT_distributed_path_len];
+	int done;
+	FILE * f;
+	SLT_distributed_path(SLT_iterator,"done",-1,path);
+	if((f=fopen(path,"rb"))==NULL)
+		return 0;
+	SLT_checkpoint_header(SLT_iterator,ntasks,SLT_done_magic,&expected);
+	done=(fread(&header,sizeof(header),1,f)==1 && memcmp(&header,&expected,sizeof(header))==0);
+	fclose(f);
+	return done;
+};
+
+// Remove the files of a previous traversal
+static void SLT_distributed_clear(const SLT_joint_iterator_t * SLT_iterator)
+{
+	char path[SLT_distributed_path_len];
+	struct dirent * entry;
+	DIR * dir=opendir(SLT_iterator->distributed_dir);
+	if(dir==NULL)
+		return;
+	while((entry=readdir(dir))!=NULL)
+		if(strncmp(entry->d_name,"claim.",6)==0 || strncmp(entry->d_name,"result.",7)==0
+				|| strncmp(entry->d_name,"frontier",8)==0 || strcmp(entry->d_name,"done")==0) {
+			SLT_distributed_path(SLT_iterator,entry->d_name,-1,path);
+			remove(path);
+		}
+	closedir(dir);
+};
+
+static void SLT_distributed_host(char * host)
+{
+	if(gethostname(host,SLT_distributed_host_len)!=0)
+		strcpy(host,"localhost");
+	host[SLT_distributed_host_len-1]=0;
+};
+
+// Whether this process now owns task, by creating its claim file, which
+// holds the host and the pid of the process
+static int SLT_distributed_claim(const SLT_joint_iterator_t * SLT_iterator,unsigned int task)
+{
+	char path[SLT_distributed_path_len];
+	char host[SLT_distributed_host_len];
+	int fd;
+	SLT_distributed_path(SLT_iterator,"claim",task,path);
+	if((fd=open(path,O_CREAT|O_EXCL|O_WRONLY,0644))<0)
+		return 0;
+	SLT_distributed_host(host);
+	dprintf(fd,"%s %ld\n",host,(long)getpid());
+	close(fd);
+	return 1;
+};
+
+// Whether the claim of task was left by a process that is gone: on this
+// host when its pid is no longer running, on another host when the claim
+// is older than the timeout
+static int SLT_claim_stale(const SLT_joint_iterator_t * SLT_iterator,unsigned int task)
+{
+	char path[SLT_distributed_path_len];
+	char host[SLT_distributed_host_len];
+	char claim_host[SLT_distributed_host_len];
+	struct stat st;
+	long pid;
+	int stale;
+	FILE * f;
+	SLT_distributed_path(SLT_iterator,"claim",task,path);
+	if(stat(path,&st)!=0 || (f=fopen(path,"r"))==NULL)
+		return 0;
+	SLT_distributed_host(host);
+	if(fscanf(f,"%255s %ld",claim_host,&pid)==2 && strcmp(claim_host,host)==0)
+		stale=(kill((pid_t)pid,0)!=0 && errno==ESRCH);
+	else
+		stale=(difftime(time(NULL),st.st_mtime)>=SLT_iterator->distributed_timeout);
+	fclose(f);
+	return stale;
+};
+
+static int SLT_result_exists(const SLT_joint_iterator_t * SLT_iterator,unsigned int task)
+{
+	char path[SLT_distributed_path_len];
+	SLT_distributed_path(SLT_iterator,"result",task,path);
+	return access(path,F_OK)==0;
+};
+
+static int SLT_result_write(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		unsigned int task,void * intern_state)
+{
+	SLT_checkpoint_header_t header;
+	char path[SLT_distributed_path_len];
+	char tmp_path[SLT_distributed_path_len];
+	FILE * f;
+	int res=0;
+	SLT_distributed_path(SLT_iterator,"result",task,path);
+	SLT_distributed_path(SLT_iterator,"result.tmp",task,tmp_path);
+	if((f=fopen(tmp_path,"wb"))==NULL)
+		return -1;
+	SLT_checkpoint_header(SLT_iterator,ntasks,SLT_result_magic,&header);
+	header.ndone=task;
+	if(fwrite(&header,sizeof(header),1,f)!=1 || SLT_iterator->SLT_write_state(intern_state,f)!=0)
+		res=-1;
+	if(fclose(f)!=0)
+		res=-1;
+	if(res==0 && rename(tmp_path,path)!=0)
+		res=-1;
+	if(res!=0)
+		remove(tmp_path);
+	return res;
+};
+
+static int SLT_result_read(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		unsigned int task,void * intern_state)
+{
+	SLT_checkpoint_header_t header;
+	SLT_checkpoint_header_t expected;
+	char path[SLT_distributed_path_len];
+	FILE * f;
+	int res;
+	SLT_distributed_path(SLT_iterator,"result",task,path);
+	if((f=fopen(path,"rb"))==NULL)
+		return -1;
+	SLT_checkpoint_header(SLT_iterator,ntasks,SLT_result_magic,&expected);
+	expected.ndone=task;
+	res=(fread(&header,sizeof(header),1,f)==1 && memcmp(&header,&expected,sizeof(header))==0
+			&& SLT_iterator->SLT_read_state(intern_state,f)==0)?0:-1;
+	fclose(f);
+	return res;
+};
+
+// The next task for a thread of this process, -1 if none is left
+static int SLT_distributed_next(const SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		unsigned int * next,unsigned int shared)
+{
+	int task=-1;
+	unsigned int i;
+	#pragma omp critical(SLT_distributed)
+	while(task<0 && *next<ntasks) {
+		i=(*next)++;
+		// The coordinator removes the claims once it is done
+		if(SLT_iterator->distributed_role==SLT_worker && SLT_done_exists(SLT_iterator,ntasks))
+			*next=ntasks;
+		else if(!shared || (!SLT_result_exists(SLT_iterator,i) && SLT_distributed_claim(SLT_iterator,i)))
+			task=i;
+	}
+	return task;
+};
+
+static void SLT_distributed_run(SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,unsigned int task,
+		const SLT_stack_item_t * slave_stack_item,void * intern_state,unsigned int shared)
+{
+	char path[SLT_distributed_path_len];
+	SLT_instrument(SLT_instrument_task_begin(task,slave_stack_item[task].interval_size1,
+			slave_stack_item[task].interval_size2));
+	SLT_slave(SLT_iterator,slave_stack_item[task],intern_state);
+	SLT_instrument(SLT_instrument_task_end());
+	// The coordinator writes its results too, for a restarted coordinator
+	if(shared && SLT_result_write(SLT_iterator,ntasks,task,intern_state)!=0
+			&& SLT_iterator->distributed_role==SLT_worker) {
+		// Give the task up, the coordinator runs it
+		fprintf(stderr," Warning: Cannot write the result of task %u, left to the coordinator\n",task);
+		SLT_distributed_path(SLT_iterator,"claim",task,path);
+		remove(path);
+	}
+};
+
+void SLT_distributed_slaves(SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		const SLT_stack_item_t * slave_stack_item,void ** intern_states)
+{
+	char path[SLT_distributed_path_len];
+	// Tasks of which intern_states holds the result
+	unsigned char * local=(unsigned char *)calloc(ntasks,1);
+	unsigned int next=0,shared=1,i;
+	double start=phase_wall_time();
+	int status;
+	if(SLT_iterator->distributed_role==SLT_coordinator) {
+		if(SLT_frontier_check(SLT_iterator,ntasks,slave_stack_item)!=SLT_frontier_same) {
+			SLT_distributed_clear(SLT_iterator);
+			if(SLT_frontier_write(SLT_iterator,ntasks,slave_stack_item)!=0) {
+				fprintf(stderr," Warning: Cannot write to %s, all the tasks run in this process\n",
+						SLT_iterator->distributed_dir);
+				shared=0;
+			}
+		}
+	}
+	else
+		while((status=SLT_frontier_check(SLT_iterator,ntasks,slave_stack_item))!=SLT_frontier_same) {
+			if(status!=SLT_frontier_absent) {
+				fprintf(stderr," Error: %s/frontier is not of this traversal (%s): run the workers with "
+						"the options and texts of the coordinator, or remove the files of a previous run\n",
+						SLT_iterator->distributed_dir,SLT_frontier_mismatches[status]);
+				exit(1);
+			}
+			if(SLT_done_exists(SLT_iterator,ntasks)) {
+				fprintf(stderr," Warning: the coordinator has already completed this traversal in %s\n",
+						SLT_iterator->distributed_dir);
+				next=ntasks;
+				break;
+			}
+			if(phase_wall_time()-start>=SLT_iterator->distributed_timeout) {
+				fprintf(stderr," Error: no coordinator in %s after %.0f seconds\n",SLT_iterator->distributed_dir,
+						SLT_iterator->distributed_timeout);
+				exit(1);
+			}
+			usleep(SLT_distributed_poll_us);
+		}
+	omp_set_num_threads(SLT_iterator->cores);
+	#pragma omp parallel
+	{
+		int task;
+		while((task=SLT_distributed_next(SLT_iterator,ntasks,&next,shared))>=0) {
+			SLT_distributed_run(SLT_iterator,ntasks,task,slave_stack_item,intern_states[task],shared);
+			local[task]=1;
+		}
+	}
+	if(SLT_iterator->distributed_role==SLT_coordinator && shared) {
+		// The tasks of the other processes, or of the ones that gave them up
+		for(i=0;i<ntasks;i++)
+			while(!local[i]) {
+				if(SLT_result_exists(SLT_iterator,i)) {
+					if(SLT_result_read(SLT_iterator,ntasks,i,intern_states[i])==0)
+						break;
+					fprintf(stderr," Warning: damaged result of task %u, run again\n",i);
+					SLT_distributed_path(SLT_iterator,"result",i,path);
+					remove(path);
+					SLT_distributed_path(SLT_iterator,"claim",i,path);
+					remove(path);
+				}
+				if(SLT_distributed_claim(SLT_iterator,i)) {
+					SLT_distributed_run(SLT_iterator,ntasks,i,slave_stack_item,intern_states[i],shared);
+					local[i]=1;
+				}
+				else if(SLT_claim_stale(SLT_iterator,i)) {
+					fprintf(stderr," Warning: the process of task %u is gone, run again\n",i);
+					SLT_distributed_path(SLT_iterator,"claim",i,path);
+					remove(path);
+				}
+				else
+					usleep(SLT_distributed_poll_us);
+			}
+		SLT_distributed_clear(SLT_iterator);
+		SLT_done_write(SLT_iterator,ntasks);
+	}
+	// SLT_slave frees the clones of the tasks it runs
+	for(i=0;i<ntasks;i++)
+		if(!local[i])
+			SLT_iterator->SLT_free(intern_states[i],SLT_iterator->mem);
+	free(local);
+};
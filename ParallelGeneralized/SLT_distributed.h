@@ -0,0 +1,52 @@
+#ifndef SLT_distributed_h
+#define SLT_distributed_h
+#include"SLT.h"
+
+// The slave tasks of one joint traversal spread over several processes, on
+// one machine or on machines sharing a file system, through a queue of
+// files in a directory. Every process runs the master traversal, which is
+// deterministic and takes a negligible share of the time, and so has the
+// same tasks and the same clones of the state. The coordinator publishes
+// the tasks (the frontier of the master) in dir/frontier and the workers
+// check theirs against it. Every process then claims tasks one at a time by
+// creating dir/claim.<task>, runs them on its OpenMP team, and writes the
+// state of each to dir/result.<task> with SLT_write_state. The coordinator
+// reads the results of the other processes into the clones of their tasks
+// with SLT_read_state and combines all of them as one process would: the
+// result does not depend on how the tasks were spread.
+//
+// A coordinator restarted on the same directory keeps the results already
+// written. A claim file holds the host and the pid of its process: the
+// coordinator runs again the task of a process of its host that is no
+// longer running, and the task of a process of another host once its claim
+// is older than timeout seconds (the task may then run twice).
+//
+// A worker waits for the frontier of its traversal, at most timeout
+// seconds, so it can be started before or after the coordinator. It exits
+// with status 1 if the frontier is of another traversal (other options or
+// texts) or if none appears in time. Once done, the coordinator removes
+// the files of the traversal and leaves dir/done, on which the workers of
+// this traversal stop claiming tasks, and a worker started later returns
+// at once.
+#define SLT_coordinator 1
+#define SLT_worker 2
+
+static inline void SLT_joint_set_distributed(SLT_joint_iterator_t * SLT_iterator,const char * dir,
+		unsigned int role,double timeout,unsigned long long tag,SLT_state_writer_t SLT_write_state,
+		SLT_state_reader_t SLT_read_state)
+{
+	SLT_iterator->distributed_dir=dir;
+	SLT_iterator->distributed_role=role;
+	SLT_iterator->distributed_timeout=timeout;
+	SLT_iterator->state_tag=tag;
+	SLT_iterator->SLT_write_state=SLT_write_state;
+	SLT_iterator->SLT_read_state=SLT_read_state;
+};
+
+// Run the slave tasks this process claims and, in the coordinator, collect
+// the others into intern_states. Without a usable directory the
+// coordinator runs every task.
+void SLT_distributed_slaves(SLT_joint_iterator_t * SLT_iterator,unsigned int ntasks,
+		const SLT_stack_item_t * slave_stack_item,void ** intern_states);
+
+#endif
@@ -0,0 +1,226 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include<omp.h>
+#include"SLT_instrument.h"
+
+SLT_instrument_t * SLT_instrument_log=NULL;
+
+// Task of the calling thread, to which SLT_instrument_flush adds the counters
+static __thread SLT_task_stats_t * SLT_current_task=NULL;
+// Hardware counters of the calling thread, opened by its first task and
+// kept for the life of the thread (OpenMP reuses its threads)
+static __thread perf_counters_t SLT_thread_counters;
+static __thread unsigned int SLT_thread_counters_open=0;
+
+// Start reading the hardware counters of the calling thread into stats
+static void task_counters_begin(SLT_task_stats_t * stats)
+{
+	if(perf_counters==NULL)
+		return;
+	if(!SLT_thread_counters_open) {
+		perf_counters_open(&SLT_thread_counters,0);
+		SLT_thread_counters_open=1;
+	}
+	perf_counters_read(&SLT_thread_counters,stats->hw);
+	SLT_instrument_log->hw=1;
+};
+
+static void task_counters_end(SLT_task_stats_t * stats)
+{
+	long long hw[perf_nevents];
+	if(perf_counters==NULL || !SLT_thread_counters_open)
+		return;
+	perf_counters_read(&SLT_thread_counters,hw);
+	perf_counters_diff(stats->hw,hw,stats->hw);
+};
+
+SLT_instrument_t * new_SLT_instrument(void)
+{
+	SLT_instrument_t * instrument=(SLT_instrument_t *)malloc(sizeof(SLT_instrument_t));
+	memset(instrument,0,sizeof(SLT_instrument_t));
+	return instrument;
+};
+
+void free_SLT_instrument(SLT_instrument_t * instrument)
+{
+	free(instrument->tasks);
+	free(instrument);
+};
+
+double SLT_instrument_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec*0.000000001;
+};
+
+void SLT_instrument_master_begin(unsigned int cores)
+{
+	if(SLT_instrument_log==NULL)
+		return;
+	SLT_instrument_log->cores=cores;
+	SLT_instrument_log->ntasks=0;
+	SLT_instrument_log->hw=0;
+	memset(&SLT_instrument_log->master,0,sizeof(SLT_task_stats_t));
+	SLT_instrument_log->master.thread=omp_get_thread_num();
+	SLT_instrument_log->master.start=SLT_instrument_time();
+	task_counters_begin(&SLT_instrument_log->master);
+	SLT_current_task=&SLT_instrument_log->master;
+};
+
+// Ends the master
+void SLT_instrument_slaves_begin(unsigned int ntasks)
+{
+	if(SLT_instrument_log==NULL)
+		return;
+	task_counters_end(&SLT_instrument_log->master);
+	SLT_current_task=NULL;
+	if(ntasks>SLT_instrument_log->tasks_size) {
+		free(SLT_instrument_log->tasks);
+		SLT_instrument_log->tasks=(SLT_task_stats_t *)malloc(ntasks*sizeof(SLT_task_stats_t));
+		SLT_instrument_log->tasks_size=ntasks;
+	}
+	SLT_instrument_log->ntasks=ntasks;
+	memset(SLT_instrument_log->tasks,0,ntasks*sizeof(SLT_task_stats_t));
+	SLT_instrument_log->slaves_start=SLT_instrument_log->master.end=SLT_instrument_time();
+};
+
+void SLT_instrument_task_begin(unsigned int task,unsigned int interval_size1,unsigned int interval_size2)
+{
+	SLT_task_stats_t * stats;
+	if(SLT_instrument_log==NULL)
+		return;
+	stats=&SLT_instrument_log->tasks[task];
+	stats->thread=omp_get_thread_num();
+	stats->interval_size1=interval_size1;
+	stats->interval_size2=interval_size2;
+	stats->start=SLT_instrument_time();
+	task_counters_begin(stats);
+	SLT_current_task=stats;
+};
+
+void SLT_instrument_flush(const SLT_counters_t * counters)
+{
+	SLT_counters_t * total;
+	if(SLT_instrument_log==NULL || SLT_current_task==NULL)
+		return;
+	total=&SLT_current_task->counters;
+	total->nodes_visited+=counters->nodes_visited;
+	total->nodes_pushed+=counters->nodes_pushed;
+	total->rank_calls+=counters->rank_calls;
+	total->rank_points+=counters->rank_points;
+	if(counters->max_stack_depth>total->max_stack_depth)
+		total->max_stack_depth=counters->max_stack_depth;
+	total->callback_time+=counters->callback_time;
+};
+
+void SLT_instrument_task_end(void)
+{
+	if(SLT_instrument_log==NULL || SLT_current_task==NULL)
+		return;
+	SLT_current_task->end=SLT_instrument_time();
+	task_counters_end(SLT_current_task);
+	SLT_current_task=NULL;
+};
+
+void SLT_instrument_slaves_end(void)
+{
+	if(SLT_instrument_log==NULL)
+		return;
+	SLT_instrument_log->slaves_end=SLT_instrument_time();
+};
+
+void SLT_instrument_combine_end(void)
+{
+	if(SLT_instrument_log==NULL)
+		return;
+	SLT_instrument_log->combine_end=SLT_instrument_time();
+};
+
+static void write_task(const SLT_instrument_t * instrument,const char * name,const SLT_task_stats_t * stats,
+		FILE * out)
+{
+	const SLT_counters_t * counters=&stats->counters;
+	unsigned int j;
+	fprintf(out,"%s\t%d\t%u\t%u\t%llu\t%llu\t%u\t%llu\t%llu\t%f\t%f",name,stats->thread,
+			stats->interval_size1,stats->interval_size2,counters->nodes_visited,counters->nodes_pushed,
+			counters->max_stack_depth,counters->rank_calls,counters->rank_points,counters->callback_time,
+			stats->end-stats->start);
+	for(j=0;instrument->hw && j<perf_nevents;j++)
+		fprintf(out,"\t%lld",stats->hw[j]);
+	fprintf(out,"\n");
+};
+
+void SLT_instrument_write(const SLT_instrument_t * instrument,FILE * out)
+{
+	double total=instrument->combine_end-instrument->master.start;
+	double slaves=instrument->slaves_end-instrument->slaves_start;
+	double wall,sum_wall=0,max_wall=0,min_wall=0;
+	unsigned long long sum_nodes=0,max_nodes=0;
+	unsigned int nthreads=instrument->cores?instrument->cores:1;
+	unsigned int * thread_tasks;
+	double * thread_busy;
+	double * thread_last_end;
+	char name[16];
+	unsigned int i,j;
+	int thread;
+	fprintf(out,"task\tthread\tinterval_size1\tinterval_size2\tnodes_visited\tnodes_pushed\t"
+			"max_stack_depth\trank_calls\trank_points\tcallback_time\twall");
+	for(j=0;instrument->hw && j<perf_nevents;j++)
+		fprintf(out,"\t%s",perf_event_names[j]);
+	fprintf(out,"\n");
+	write_task(instrument,"master",&instrument->master,out);
+	for(i=0;i<instrument->ntasks;i++) {
+		const SLT_task_stats_t * stats=&instrument->tasks[i];
+		snprintf(name,sizeof(name),"%u",i);
+		write_task(instrument,name,stats,out);
+		wall=stats->end-stats->start;
+		sum_wall+=wall;
+		if(wall>max_wall)
+			max_wall=wall;
+		if(i==0 || wall<min_wall)
+			min_wall=wall;
+		sum_nodes+=stats->counters.nodes_visited;
+		if(stats->counters.nodes_visited>max_nodes)
+			max_nodes=stats->counters.nodes_visited;
+		if(stats->thread>=0 && (unsigned int)stats->thread>=nthreads)
+			nthreads=stats->thread+1;
+	}
+
+	fprintf(out,"# wall %f: master %f (%.1f%%), slaves %f (%.1f%%), combine %f (%.1f%%)\n",total,
+			instrument->master.end-instrument->master.start,
+			total>0?100*(instrument->master.end-instrument->master.start)/total:0,slaves,
+			total>0?100*slaves/total:0,instrument->combine_end-instrument->slaves_end,
+			total>0?100*(instrument->combine_end-instrument->slaves_end)/total:0);
+	if(instrument->ntasks==0)
+		return;
+	fprintf(out,"# tasks %u: wall min %f mean %f max %f (max/mean %.2f, largest task %.1f%% of the slave time)\n",
+			instrument->ntasks,min_wall,sum_wall/instrument->ntasks,max_wall,
+			sum_wall>0?max_wall*instrument->ntasks/sum_wall:0,sum_wall>0?100*max_wall/sum_wall:0);
+	fprintf(out,"# tasks nodes mean %.1f max %llu (max/mean %.2f)\n",(double)sum_nodes/instrument->ntasks,
+			max_nodes,sum_nodes?(double)max_nodes*instrument->ntasks/sum_nodes:0);
+
+	// A thread is idle at the end of the parallel loop from the end of its
+	// last task to the end of the loop
+	thread_tasks=(unsigned int *)calloc(nthreads,sizeof(unsigned int));
+	thread_busy=(double *)calloc(nthreads,sizeof(double));
+	thread_last_end=(double *)malloc(nthreads*sizeof(double));
+	for(i=0;i<nthreads;i++)
+		thread_last_end[i]=instrument->slaves_start;
+	for(i=0;i<instrument->ntasks;i++) {
+		thread=instrument->tasks[i].thread;
+		thread_tasks[thread]++;
+		thread_busy[thread]+=instrument->tasks[i].end-instrument->tasks[i].start;
+		if(instrument->tasks[i].end>thread_last_end[thread])
+			thread_last_end[thread]=instrument->tasks[i].end;
+	}
+	for(i=0;i<nthreads;i++)
+		fprintf(out,"# thread %u: tasks %u busy %f idle at the end %f (%.1f%% of the slave time)\n",i,
+				thread_tasks[i],thread_busy[i],instrument->slaves_end-thread_last_end[i],
+				slaves>0?100*(instrument->slaves_end-thread_last_end[i])/slaves:0);
+	free(thread_tasks);
+	free(thread_busy);
+	free(thread_last_end);
+};
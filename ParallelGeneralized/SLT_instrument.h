@@ -0,0 +1,93 @@
+#ifndef SLT_instrument_h
+#define SLT_instrument_h
+#include<stdio.h>
+#include"perf_counters.h"
+
+// Counters of the joint traversal, per slave task, to tell why a run does
+// not scale. They are compiled in only with -Duse_SLT_instrument; otherwise
+// the macros below are empty and the traversal is unchanged.
+
+typedef struct
+{
+	unsigned long long nodes_visited;
+	unsigned long long nodes_pushed;
+	// DNA5_multipe_char_pref_counts calls and the positions they rank
+	unsigned long long rank_calls;
+	unsigned long long rank_points;
+	unsigned int max_stack_depth;
+	double callback_time;
+} SLT_counters_t;
+
+typedef struct
+{
+	SLT_counters_t counters;
+	// Thread that ran the task and its start and end (SLT_instrument_time)
+	int thread;
+	double start;
+	double end;
+	// Interval sizes of the node the task starts from
+	unsigned int interval_size1;
+	unsigned int interval_size2;
+	// Hardware counters of the thread during the task if perf_counters is
+	// open, -1 for the events not counted
+	long long hw[perf_nevents];
+} SLT_task_stats_t;
+
+typedef struct
+{
+	unsigned int cores;
+	// The master traversal, down to the depth of the slave tasks
+	SLT_task_stats_t master;
+	unsigned int ntasks;
+	unsigned int tasks_size;
+	SLT_task_stats_t * tasks;
+	double slaves_start;
+	double slaves_end;
+	double combine_end;
+	// Whether the tasks have hardware counters
+	unsigned int hw;
+} SLT_instrument_t;
+
+// The record of the last traversal run by SLT_joint_execute_iterator. NULL,
+// the default, records nothing.
+extern SLT_instrument_t * SLT_instrument_log;
+
+SLT_instrument_t * new_SLT_instrument(void);
+void free_SLT_instrument(SLT_instrument_t * instrument);
+double SLT_instrument_time(void);
+
+void SLT_instrument_master_begin(unsigned int cores);
+void SLT_instrument_slaves_begin(unsigned int ntasks);
+void SLT_instrument_task_begin(unsigned int task,unsigned int interval_size1,unsigned int interval_size2);
+// Add the counters of a master or slave traversal to the current task
+void SLT_instrument_flush(const SLT_counters_t * counters);
+void SLT_instrument_task_end(void);
+void SLT_instrument_slaves_end(void);
+void SLT_instrument_combine_end(void);
+
+// One line per task, then the summary: serial share of the master and the
+// combiner, skew of the task times, idle time of every thread at the end of
+// the parallel loop
+void SLT_instrument_write(const SLT_instrument_t * instrument,FILE * out);
+
+#ifdef use_SLT_instrument
+#define SLT_counters_declare SLT_counters_t SLT_counters={0,0,0,0,0,0}
+#define SLT_count_node(stack_depth) do { SLT_counters.nodes_visited++; \
+		if((stack_depth)>SLT_counters.max_stack_depth) SLT_counters.max_stack_depth=(stack_depth); } while(0)
+#define SLT_count_push() (SLT_counters.nodes_pushed++)
+#define SLT_count_rank(npoints) do { SLT_counters.rank_calls++; SLT_counters.rank_points+=(npoints); } while(0)
+#define SLT_timed_callback(call) do { double SLT_callback_start=SLT_instrument_time(); call; \
+		SLT_counters.callback_time+=SLT_instrument_time()-SLT_callback_start; } while(0)
+#define SLT_counters_flush() SLT_instrument_flush(&SLT_counters)
+#define SLT_instrument(call) call
+#else
+#define SLT_counters_declare
+#define SLT_count_node(stack_depth)
+#define SLT_count_push()
+#define SLT_count_rank(npoints)
+#define SLT_timed_callback(call) call
+#define SLT_counters_flush()
+#define SLT_instrument(call)
+#endif
+
+#endif
@@ -0,0 +1,345 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include <string.h>
+#include"SLT_multi.h"
+#include"phase_log.h"
+#include"mem_account.h"
+
+// Depth at which the master hands the subtrees over to the slaves, as in
+// SLT_joint_execute_iterator
+#define SLT_multi_split_depth 4
+#define SLT_multi_no_split 0xffffffff
+
+// Interval of a node in one reference
+typedef struct
+{
+	unsigned int ref;
+	unsigned int interval_start;
+	unsigned int interval_size;
+	unsigned int child_freqs[6];
+} SLT_multi_ref_item_t;
+
+// Node of the query tree; its active references are the nrefs items of the
+// reference stack starting at refs_offset
+typedef struct
+{
+	unsigned int string_depth;
+	unsigned int interval_start;
+	unsigned int interval_size;
+	unsigned int child_freqs[6];
+	unsigned char WL_char;
+	unsigned int refs_offset;
+	unsigned int nrefs;
+} SLT_multi_stack_item_t;
+
+// Left and right extensions of a node in one text
+typedef struct
+{
+	unsigned int freqs[6][6];
+	unsigned char nright_extensions;
+	unsigned char nleft_extensions;
+	unsigned char right_extension_bitmap;
+	unsigned char left_extension_bitmap;
+	// First row of the interval of aW, for a=A,C,G,T
+	unsigned int child_starts[4];
+} SLT_multi_side_t;
+
+// Subtrees at the split depth, each with its own copy of its reference items
+// and its own state. The combiner frees the states array.
+typedef struct
+{
+	unsigned int n;
+	SLT_multi_stack_item_t items[1<<(2*SLT_multi_split_depth)];
+	SLT_multi_ref_item_t * refs[1<<(2*SLT_multi_split_depth)];
+	void ** states;
+} SLT_multi_split_t;
+
+// The rank queries of SLT_joint_execute_iterator for one text
+static void SLT_multi_expand(Basic_BWT_t * BBWT,unsigned int interval_start,
+		const unsigned int * child_freqs,SLT_multi_side_t * side)
+{
+	unsigned int char_pref_counts[28];
+	unsigned int pref_count_query_points[7];
+	unsigned int last_char_pref_counts[7];
+	unsigned int npref_query_points;
+	unsigned int includes_EOT_char;
+	unsigned int last_char_freq=0;
+	unsigned int i,j,k;
+
+	memset(side,0,sizeof(SLT_multi_side_t));
+	for(i=0;i<6 && child_freqs[i]==0;i++);
+	// W does not occur in this text
+	if(i==6)
+		return;
+	pref_count_query_points[0]=interval_start-1;
+	if(interval_start==0)
+		for(i=0;i<4;i++)
+			char_pref_counts[i]=0;
+	for(i=0,j=1;i<6;i++)
+	{
+		if(child_freqs[i])
+		{
+			side->right_extension_bitmap|=(1<<i);
+			pref_count_query_points[j]=pref_count_query_points[j-1]+child_freqs[i];
+			j++;
+		};
+	};
+	npref_query_points=j;
+	side->nright_extensions=npref_query_points-1;
+	if(interval_start==0)
+		DNA5_multipe_char_pref_counts(BBWT->indexed_BWT,npref_query_points-1,
+				&pref_count_query_points[1],&char_pref_counts[4]);
+	else
+		DNA5_multipe_char_pref_counts(BBWT->indexed_BWT,npref_query_points,
+				pref_count_query_points,char_pref_counts);
+	includes_EOT_char=((BBWT->primary_idx>=(pref_count_query_points[0]+1))&&
+			(BBWT->primary_idx<=pref_count_query_points[npref_query_points-1]));
+	side->left_extension_bitmap=includes_EOT_char;
+	for(i=0;i<npref_query_points;i++)
+	{
+		last_char_pref_counts[i]=pref_count_query_points[i]+1;
+		for(k=0;k<4;k++)
+			last_char_pref_counts[i]-=char_pref_counts[k+i*4];
+	};
+	for(i=0,j=1;i<6;i++)
+	{
+		if(side->right_extension_bitmap&(1<<i))
+		{
+			includes_EOT_char=((BBWT->primary_idx>=(pref_count_query_points[j-1]+1))&&
+					(BBWT->primary_idx<=pref_count_query_points[j]));
+			side->freqs[0][i]=includes_EOT_char;
+			side->freqs[1][i]=char_pref_counts[j*4]-char_pref_counts[(j-1)*4]-includes_EOT_char;
+			for(k=2;k<5;k++)
+				side->freqs[k][i]=char_pref_counts[j*4+k-1]-char_pref_counts[(j-1)*4+k-1];
+			side->freqs[5][i]=last_char_pref_counts[j]-last_char_pref_counts[j-1];
+			last_char_freq+=side->freqs[5][i];
+			j++;
+		};
+	};
+	side->left_extension_bitmap|=((last_char_freq>0)<<5);
+	for(k=1;k<5;k++)
+		for(i=0;i<6;i++)
+			if(side->freqs[k][i])
+			{
+				side->left_extension_bitmap|=(1<<k);
+				break;
+			};
+	side->nleft_extensions=__builtin_popcount(side->left_extension_bitmap);
+	includes_EOT_char=(BBWT->primary_idx<(pref_count_query_points[0]+1));
+	side->child_starts[0]=char_pref_counts[0]+BBWT->char_base[0]+1-includes_EOT_char;
+	for(k=1;k<4;k++)
+		side->child_starts[k]=char_pref_counts[k]+BBWT->char_base[k]+1;
+};
+
+// The condition of SLT_joint_execute_iterator for pushing the node aW,
+// where a is row c of the extension tables
+static inline unsigned int SLT_multi_pair_pushes(const SLT_multi_side_t * side1,
+		const SLT_multi_side_t * side2,unsigned int c,unsigned int options)
+{
+	unsigned int nchildren=0,nchildren1=0,nchildren2=0;
+	unsigned int j;
+	for(j=0;j<6;j++)
+	{
+		nchildren1+=(side1->freqs[c][j]!=0);
+		nchildren2+=(side2->freqs[c][j]!=0);
+		nchildren+=(side1->freqs[c][j]+side2->freqs[c][j]>0);
+	};
+	if(options & SLT_joint_or_enum)
+		return nchildren1>1 || nchildren2>1 || nchildren>1 ||
+				side1->freqs[c][0]+side1->freqs[c][5]+side2->freqs[c][0]+side2->freqs[c][5]>=2;
+	return nchildren1>0 && nchildren2>0 && (nchildren>1 ||
+			side1->freqs[c][0]+side1->freqs[c][5]+side2->freqs[c][0]+side2->freqs[c][5]>=2);
+};
+
+static inline void SLT_multi_set_side1(SLT_joint_params_t * SLT_params,const SLT_multi_side_t * side)
+{
+	SLT_params->nright_extensions1=side->nright_extensions;
+	SLT_params->nleft_extensions1=side->nleft_extensions;
+	SLT_params->right_extension_bitmap1=side->right_extension_bitmap;
+	SLT_params->left_extension_bitmap1=side->left_extension_bitmap;
+	memcpy(SLT_params->left_right_extension_freqs1,side->freqs,sizeof(side->freqs));
+};
+
+static inline void SLT_multi_set_side2(SLT_joint_params_t * SLT_params,const SLT_multi_side_t * side)
+{
+	SLT_params->nright_extensions2=side->nright_extensions;
+	SLT_params->nleft_extensions2=side->nleft_extensions;
+	SLT_params->right_extension_bitmap2=side->right_extension_bitmap;
+	SLT_params->left_extension_bitmap2=side->left_extension_bitmap;
+	memcpy(SLT_params->left_right_extension_freqs2,side->freqs,sizeof(side->freqs));
+};
+
+// Depth first traversal of the subtree of root. Nodes at split_depth are
+// not entered but handed to split, with a clone of the state.
+static void SLT_multi_traverse(SLT_multi_iterator_t * SLT_iterator,const SLT_multi_stack_item_t * root,
+		const SLT_multi_ref_item_t * root_refs,void * intern_state,unsigned int split_depth,
+		SLT_multi_split_t * split)
+{
+	Basic_BWT_t * query=SLT_iterator->query;
+	unsigned int nrefs=SLT_iterator->nrefs;
+	unsigned int stack_size=16;
+	unsigned int stack_idx=0;
+	unsigned int ref_stack_size=4*nrefs;
+	unsigned int ref_stack_idx=0;
+	SLT_multi_stack_item_t * stack=(SLT_multi_stack_item_t *)mem_malloc(mem_stacks,stack_size*sizeof(SLT_multi_stack_item_t));
+	SLT_multi_ref_item_t * ref_stack=(SLT_multi_ref_item_t *)mem_malloc(mem_stacks,ref_stack_size*sizeof(SLT_multi_ref_item_t));
+	SLT_multi_ref_item_t * node_refs=(SLT_multi_ref_item_t *)mem_malloc(mem_stacks,nrefs*sizeof(SLT_multi_ref_item_t));
+	SLT_multi_side_t * ref_sides=(SLT_multi_side_t *)mem_malloc(mem_stacks,nrefs*sizeof(SLT_multi_side_t));
+	SLT_multi_side_t query_side;
+	SLT_multi_stack_item_t node;
+	SLT_multi_stack_item_t * child;
+	SLT_multi_ref_item_t * child_ref;
+	SLT_joint_params_t SLT_params;
+	unsigned int nsplit=split?split->n:0;
+	unsigned int i,j,c;
+
+	stack[stack_idx]=*root;
+	stack[stack_idx].refs_offset=0;
+	memcpy(ref_stack,root_refs,root->nrefs*sizeof(SLT_multi_ref_item_t));
+	ref_stack_idx=root->nrefs;
+	stack_idx++;
+	do
+	{
+		// Pop a node and move its reference items out of the reference stack
+		node=stack[--stack_idx];
+		memcpy(node_refs,&ref_stack[node.refs_offset],node.nrefs*sizeof(SLT_multi_ref_item_t));
+		ref_stack_idx=node.refs_offset;
+
+		SLT_multi_expand(query,node.interval_start,node.child_freqs,&query_side);
+		for(i=0;i<node.nrefs;i++)
+			SLT_multi_expand(SLT_iterator->refs[node_refs[i].ref],node_refs[i].interval_start,
+					node_refs[i].child_freqs,&ref_sides[i]);
+
+		// Push the children in reverse order so that they are popped in
+		// lexicographic order
+		for(c=4;c>0;c--)
+		{
+			if(stack_idx==stack_size)
+			{
+				stack_size*=2;
+				stack=(SLT_multi_stack_item_t *)mem_realloc(mem_stacks,stack,stack_size*sizeof(SLT_multi_stack_item_t),
+						stack_size/2*sizeof(SLT_multi_stack_item_t));
+			};
+			if(ref_stack_idx+node.nrefs>ref_stack_size)
+			{
+				ref_stack=(SLT_multi_ref_item_t *)mem_realloc(mem_stacks,ref_stack,
+						(2*ref_stack_size+node.nrefs)*sizeof(SLT_multi_ref_item_t),ref_stack_size*sizeof(SLT_multi_ref_item_t));
+				ref_stack_size=2*ref_stack_size+node.nrefs;
+			};
+			child=&stack[stack_idx];
+			child->nrefs=0;
+			child->refs_offset=ref_stack_idx;
+			for(i=0;i<node.nrefs;i++)
+			{
+				if(!SLT_multi_pair_pushes(&query_side,&ref_sides[i],c,SLT_iterator->options))
+					continue;
+				child_ref=&ref_stack[ref_stack_idx+child->nrefs++];
+				child_ref->ref=node_refs[i].ref;
+				child_ref->interval_start=ref_sides[i].child_starts[c-1];
+				child_ref->interval_size=0;
+				for(j=0;j<6;j++)
+				{
+					child_ref->child_freqs[j]=ref_sides[i].freqs[c][j];
+					child_ref->interval_size+=ref_sides[i].freqs[c][j];
+				};
+			};
+			if(child->nrefs==0)
+				continue;
+			child->WL_char=c;
+			child->string_depth=node.string_depth+1;
+			child->interval_start=query_side.child_starts[c-1];
+			child->interval_size=0;
+			for(j=0;j<6;j++)
+			{
+				child->child_freqs[j]=query_side.freqs[c][j];
+				child->interval_size+=query_side.freqs[c][j];
+			};
+			if(child->string_depth==split_depth)
+			{
+				split->items[split->n]=*child;
+				split->refs[split->n]=(SLT_multi_ref_item_t *)mem_malloc(mem_stacks,child->nrefs*sizeof(SLT_multi_ref_item_t));
+				memcpy(split->refs[split->n],&ref_stack[ref_stack_idx],child->nrefs*sizeof(SLT_multi_ref_item_t));
+				split->n++;
+			}
+			else
+			{
+				ref_stack_idx+=child->nrefs;
+				stack_idx++;
+			};
+		};
+
+		SLT_params.WL_char=node.WL_char;
+		SLT_params.string_depth=node.string_depth;
+		SLT_params.interval_start1=node.interval_start;
+		SLT_params.interval_size1=node.interval_size;
+		SLT_multi_set_side1(&SLT_params,&query_side);
+		for(i=0;i<node.nrefs;i++)
+		{
+			SLT_params.interval_start2=node_refs[i].interval_start;
+			SLT_params.interval_size2=node_refs[i].interval_size;
+			SLT_multi_set_side2(&SLT_params,&ref_sides[i]);
+			SLT_iterator->SLT_callback(&SLT_params,node_refs[i].ref,intern_state,SLT_iterator->mem);
+		};
+		for(;split && nsplit<split->n;nsplit++)
+			split->states[nsplit]=SLT_iterator->SLT_cloner(intern_state,nsplit);
+	}while(stack_idx);
+	SLT_iterator->SLT_free(intern_state,SLT_iterator->mem);
+	mem_free(mem_stacks,stack,stack_size*sizeof(SLT_multi_stack_item_t));
+	mem_free(mem_stacks,ref_stack,ref_stack_size*sizeof(SLT_multi_ref_item_t));
+	mem_free(mem_stacks,node_refs,nrefs*sizeof(SLT_multi_ref_item_t));
+	mem_free(mem_stacks,ref_sides,nrefs*sizeof(SLT_multi_side_t));
+};
+
+void SLT_multi_execute_iterator(SLT_multi_iterator_t * SLT_iterator)
+{
+	Basic_BWT_t * query=SLT_iterator->query;
+	Basic_BWT_t * BBWT;
+	SLT_multi_stack_item_t root;
+	SLT_multi_ref_item_t * root_refs;
+	SLT_multi_split_t * split;
+	unsigned int r,i;
+
+	if(SLT_iterator->nrefs==0)
+		return;
+	// The root: the whole BWT, whose first row is the '$' row
+	root.WL_char=0;
+	root.string_depth=0;
+	root.interval_start=0;
+	root.interval_size=query->textlen+1;
+	root.child_freqs[0]=1;
+	for(i=1;i<5;i++)
+		root.child_freqs[i]=query->char_base[i]-query->char_base[i-1];
+	root.child_freqs[5]=query->textlen-query->char_base[4];
+	root.nrefs=SLT_iterator->nrefs;
+	root_refs=(SLT_multi_ref_item_t *)mem_malloc(mem_stacks,SLT_iterator->nrefs*sizeof(SLT_multi_ref_item_t));
+	for(r=0;r<SLT_iterator->nrefs;r++)
+	{
+		BBWT=SLT_iterator->refs[r];
+		root_refs[r].ref=r;
+		root_refs[r].interval_start=0;
+		root_refs[r].interval_size=BBWT->textlen+1;
+		root_refs[r].child_freqs[0]=1;
+		for(i=1;i<5;i++)
+			root_refs[r].child_freqs[i]=BBWT->char_base[i]-BBWT->char_base[i-1];
+		root_refs[r].child_freqs[5]=BBWT->textlen-BBWT->char_base[4];
+	};
+
+	split=(SLT_multi_split_t *)mem_malloc(mem_stacks,sizeof(SLT_multi_split_t));
+	split->n=0;
+	split->states=malloc((1<<(2*SLT_multi_split_depth))*sizeof(void *));
+	phase_begin("master");
+	SLT_multi_traverse(SLT_iterator,&root,root_refs,SLT_iterator->intern_state,SLT_multi_split_depth,split);
+	mem_free(mem_stacks,root_refs,SLT_iterator->nrefs*sizeof(SLT_multi_ref_item_t));
+	phase_next("slaves");
+	#pragma omp parallel for schedule(dynamic) num_threads(SLT_iterator->cores)
+	for(i=0;i<split->n;i++)
+	{
+		SLT_multi_traverse(SLT_iterator,&split->items[i],split->refs[i],split->states[i],
+				SLT_multi_no_split,NULL);
+		mem_free(mem_stacks,split->refs[i],split->items[i].nrefs*sizeof(SLT_multi_ref_item_t));
+	};
+	phase_next("combine");
+	SLT_iterator->SLT_combiner(split->states,SLT_iterator->intern_state,split->n,SLT_iterator->mem);
+	phase_end();
+	mem_free(mem_stacks,split,sizeof(SLT_multi_split_t));
+};
@@ -0,0 +1,63 @@
+#ifndef SLT_multi_h
+#define SLT_multi_h
+#include"SLT.h"
+
+// Joint traversal of one query text against many reference texts. The
+// tree is walked once and every node carries the set of references for
+// which the pairwise joint iterator, with the same enumeration option
+// (SLT_joint_and_enum or SLT_joint_or_enum), would visit it, with their
+// intervals. A reference leaves the set of a subtree as soon as the pairwise
+// traversal would not enter it. With SLT_joint_or_enum the nodes are those
+// of the union of the query and reference trees, and either side may be
+// empty.
+//
+// The callback is called once per node and active reference, with the
+// query as text 1 and the reference as text 2 of SLT_params, so that it
+// sees exactly the nodes and parameters of SLT_joint_execute_iterator on
+// (query, refs[ref]).
+typedef void (*SLT_multi_callback_t)(const SLT_joint_params_t * SLT_params,unsigned int ref,
+		void * intern_state, unsigned int memory);
+
+typedef struct
+{
+	SLT_multi_callback_t SLT_callback;
+	SLT_cloner_t SLT_cloner;
+	SLT_combiner_t SLT_combiner;
+	SLT_free_t SLT_free;
+	void * intern_state;
+	Basic_BWT_t * query;
+	Basic_BWT_t ** refs;
+	unsigned int nrefs;
+	unsigned int options;
+	unsigned int mem;
+	unsigned int cores;
+} SLT_multi_iterator_t;
+
+static inline SLT_multi_iterator_t * new_SLT_multi_iterator(SLT_multi_callback_t SLT_callback,SLT_cloner_t SLT_cloner,
+		SLT_combiner_t SLT_combiner, SLT_free_t SLT_free, void * intern_state,
+		Basic_BWT_t * query,Basic_BWT_t ** refs,unsigned int nrefs,unsigned int options,
+		unsigned int mem,unsigned int cores)
+{
+	SLT_multi_iterator_t * SLT_iterator=(SLT_multi_iterator_t *)malloc(sizeof(SLT_multi_iterator_t));
+	SLT_iterator->SLT_callback=SLT_callback;
+	SLT_iterator->SLT_cloner=SLT_cloner;
+	SLT_iterator->SLT_combiner=SLT_combiner;
+	SLT_iterator->SLT_free=SLT_free;
+	SLT_iterator->intern_state=intern_state;
+	SLT_iterator->query=query;
+	SLT_iterator->refs=refs;
+	SLT_iterator->nrefs=nrefs;
+	SLT_iterator->options=options;
+	SLT_iterator->mem=mem;
+	SLT_iterator->cores=cores;
+	return SLT_iterator;
+};
+
+static inline void free_SLT_multi_iterator(SLT_multi_iterator_t * SLT_iterator)
+{
+	free(SLT_iterator);
+};
+
+void SLT_multi_execute_iterator(SLT_multi_iterator_t * SLT_iterator);
+
+#endif
@@ -2,6 +2,7 @@
 #include<stdlib.h>
 #include <string.h>
 #include"SLT_single_string.h"
+#include"mem_account.h"
 
 typedef struct 
 {
@@ -80,7 +81,7 @@ void SLT_execute_iterator(SLT_iterator_t_single_string * SLT_iterator)
 //		BBWT->textlen);
 
 	SLT_stack_item_t * SLT_stack=(SLT_stack_item_t *)
-		malloc((min_SLT_stack_size+1)*sizeof(SLT_stack_item_t));
+		mem_malloc(mem_stacks,(min_SLT_stack_size+1)*sizeof(SLT_stack_item_t));
 // Push the root node on the stack
 	SLT_stack[curr_stack_idx].WL_char=0;
 	SLT_stack[curr_stack_idx].string_depth=0;
@@ -229,8 +230,8 @@ void SLT_execute_iterator(SLT_iterator_t_single_string * SLT_iterator)
 			if(curr_stack_size<=curr_stack_idx)
 			{
 				curr_stack_size*=2;
-				SLT_stack=(SLT_stack_item_t*)realloc(SLT_stack, 
-					sizeof(SLT_stack_item_t)*(curr_stack_size+1));
+				SLT_stack=(SLT_stack_item_t*)mem_realloc(mem_stacks,SLT_stack,
+					sizeof(SLT_stack_item_t)*(curr_stack_size+1),sizeof(SLT_stack_item_t)*(curr_stack_size/2+1));
 			};
 			SLT_stack[curr_stack_idx].WL_char=1;
 			SLT_stack[curr_stack_idx].string_depth=string_depth;
@@ -269,8 +270,8 @@ void SLT_execute_iterator(SLT_iterator_t_single_string * SLT_iterator)
 				if(curr_stack_size<=curr_stack_idx)
 				{
 					curr_stack_size*=2;
-					SLT_stack=(SLT_stack_item_t*)realloc(SLT_stack, 
-						sizeof(SLT_stack_item_t)*(curr_stack_size+1));
+					SLT_stack=(SLT_stack_item_t*)mem_realloc(mem_stacks,SLT_stack,
+						sizeof(SLT_stack_item_t)*(curr_stack_size+1),sizeof(SLT_stack_item_t)*(curr_stack_size/2+1));
 				};
 				SLT_stack[curr_stack_idx].WL_char=i+1;
 				SLT_stack[curr_stack_idx].string_depth=string_depth;
@@ -301,5 +302,5 @@ void SLT_execute_iterator(SLT_iterator_t_single_string * SLT_iterator)
 		SLT_iterator->SLT_callback(&SLT_params,SLT_iterator->intern_state, SLT_iterator->mem);
 	}while(curr_stack_idx);
 	printf("The number of traversed suffix tree nodes is %d\n",ntraversed_nodes);
-	free(SLT_stack);
+	mem_free(mem_stacks,SLT_stack,(curr_stack_size+1)*sizeof(SLT_stack_item_t));
 };
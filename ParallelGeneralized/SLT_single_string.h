@@ -1,5 +1,5 @@
-#ifndef SLT_h
-#define SLT_h
+#ifndef SLT_single_string_h
+#define SLT_single_string_h
 #include"indexed_DNA5_seq.h"
 #include"DNA5_Basic_BWT.h"
 
@@ -0,0 +1,254 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include"DNA5_Basic_BWT.h"
+#include"SLT_MAWs.h"
+#include"kernel_metrics.h"
+#include"phase_log.h"
+#include"synth_genome.h"
+
+/*
+ Pipeline benchmark on synthetic genomes: for every genome length, draws a
+ genome with synth_genome and a mutated copy of it, indexes both, and runs
+ every metric on the pair for every number of cores. The report has one
+ line per phase (bwt, pack, master, slaves, combine, and total for the whole
+ metric) with its wall time, CPU time and peak resident memory, so that runs
+ with the same options are comparable.
+*/
+
+#define max_bench_values 32
+#define bench_format_tsv 0
+#define bench_format_json 1
+#define min_MAW_len 2
+
+typedef struct
+{
+	unsigned int format;
+	FILE * out;
+	unsigned int nlines;
+	char model[64];
+	double divergence;
+	unsigned int textlen1;
+	unsigned int textlen2;
+} bench_report_t;
+
+static void report_phase(bench_report_t * report,unsigned int cores,const char * metric,double value,
+		const char * phase,unsigned int count,double wall,double cpu,long max_rss_kb)
+{
+	if(report->format==bench_format_tsv) {
+		if(report->nlines==0)
+			fprintf(report->out,"model\tdivergence\ttextlen1\ttextlen2\tcores\tmetric\tvalue\t"
+					"phase\tcount\twall\tcpu\tmax_rss_kb\n");
+		fprintf(report->out,"%s\t%f\t%u\t%u\t%u\t%s\t%f\t%s\t%u\t%f\t%f\t%ld\n",report->model,
+				report->divergence,report->textlen1,report->textlen2,cores,metric,value,phase,count,
+				wall,cpu,max_rss_kb);
+	}
+	else
+		fprintf(report->out,"%s\n {\"model\": \"%s\", \"divergence\": %f, \"textlen1\": %u, \"textlen2\": %u, "
+				"\"cores\": %u, \"metric\": \"%s\", \"value\": %f, \"phase\": \"%s\", \"count\": %u, "
+				"\"wall\": %f, \"cpu\": %f, \"max_rss_kb\": %ld}",report->nlines?",":"[",report->model,
+				report->divergence,report->textlen1,report->textlen2,cores,metric,value,phase,count,
+				wall,cpu,max_rss_kb);
+	report->nlines++;
+};
+
+// The phases recorded in log, and a total line from wall_start and cpu_start
+static void report_log(bench_report_t * report,unsigned int cores,const char * metric,double value,
+		const phase_log_t * log,double wall_start,double cpu_start)
+{
+	unsigned int i;
+	const phase_t * phase;
+	for(i=0;i<log->nphases;i++) {
+		phase=&log->phases[i];
+		report_phase(report,cores,metric,value,phase->name,phase->count,phase->wall,phase->cpu,
+				phase->max_rss_kb);
+	}
+	report_phase(report,cores,metric,value,"total",1,phase_wall_time()-wall_start,
+			phase_cpu_time()-cpu_start,phase_max_rss_kb());
+};
+
+static Basic_BWT_t * bench_index(unsigned char * text,unsigned int textlen,bench_report_t * report)
+{
+	phase_log_t log;
+	Basic_BWT_t * BBWT;
+	double wall=phase_wall_time();
+	double cpu=phase_cpu_time();
+	memset(&log,0,sizeof(log));
+	phase_log=&log;
+	BBWT=Build_BWT_index_from_text(text,textlen,Basic_bwt_free_text);
+	phase_log=NULL;
+	if(BBWT)
+		report_log(report,1,"index",textlen,&log,wall,cpu);
+	return BBWT;
+};
+
+int main(int argc, char **argv) {
+								/*options: -n lengths) comma separated genome lengths (default 1000000)
+										   -m model) uniform (default), gc:<fraction> or markov:<order>
+										   -R count:length[:divergence]) insert count repeats of
+											length bases, each mutated at divergence (default 0)
+										   -d rate) divergence of the second genome from the first:
+											rate of substitutions and single base indels (default 0.01)
+										   -t cores) comma separated numbers of cores (default 1)
+										   -M metrics) comma separated metrics (default
+											maws,rws:1:2,present,jaccard,lw,kernel)
+										   -w) also time the output path: the MAWs of both genomes
+											written to output.txt
+										   -s seed) seed of mt19937ar (default 1)
+										   -f tsv|json) report format (default tsv)
+										   -o file) report file (default bench_report.tsv or .json, -
+											for the standard output)
+										*/
+	synth_params_t params;
+	bench_report_t report;
+	unsigned int lengths[max_bench_values]={1000000};
+	unsigned int cores[max_bench_values]={1};
+	unsigned int nlengths=1,ncores=1,nmetrics=0;
+	kernel_metric_t metrics[max_bench_values];
+	kernel_result_t result;
+	char metric_names[max_bench_values][kernel_metric_name_len];
+	const char * metric_spec="maws,rws:1:2,present,jaccard,lw,kernel";
+	const char * out_path=NULL;
+	unsigned int output_path=0;
+	unsigned char * text1;
+	unsigned char * text2;
+	Basic_BWT_t * BBWT1;
+	Basic_BWT_t * BBWT2;
+	phase_log_t log;
+	double wall,cpu,LW;
+	unsigned int i,l,c,m,nMAWs,nMAWs1,nMAWs2;
+	char * spec;
+	char * tok;
+	int opt,usage=0,res=0;
+	memset(&params,0,sizeof(params));
+	memset(&report,0,sizeof(report));
+	params.seed=1;
+	report.divergence=0.01;
+	while(!usage && (opt=getopt(argc,argv,"n:m:R:d:t:M:ws:f:o:"))!=-1) {
+		switch(opt) {
+		case 'n':
+			if(kernel_parse_list(optarg,lengths,max_bench_values,&nlengths)!=0)
+				usage=1;
+			break;
+		case 'm':
+			if(synth_parse_model(optarg,&params)!=0)
+				usage=1;
+			break;
+		case 'R':
+			if(sscanf(optarg,"%u:%u:%lf",&params.nrepeats,&params.repeat_len,&params.repeat_divergence)<2)
+				usage=1;
+			break;
+		case 'd':
+			report.divergence=atof(optarg);
+			break;
+		case 't':
+			if(kernel_parse_list(optarg,cores,max_bench_values,&ncores)!=0)
+				usage=1;
+			break;
+		case 'M':
+			metric_spec=optarg;
+			break;
+		case 'w':
+			output_path=1;
+			break;
+		case 's':
+			params.seed=strtoull(optarg,NULL,10);
+			break;
+		case 'f':
+			if(strcmp(optarg,"tsv")==0)
+				report.format=bench_format_tsv;
+			else if(strcmp(optarg,"json")==0)
+				report.format=bench_format_json;
+			else
+				usage=1;
+			break;
+		case 'o':
+			out_path=optarg;
+			break;
+		default:
+			usage=1;
+		}
+	}
+	spec=strdup(metric_spec);
+	for(tok=strtok(spec,",");tok && nmetrics<max_bench_values;tok=strtok(NULL,",")) {
+		if(kernel_parse_metric(tok,&metrics[nmetrics])!=0) {
+			fprintf(stderr," Error: unknown metric %s\n",tok);
+			usage=1;
+			break;
+		}
+		kernel_metric_name(&metrics[nmetrics],metric_names[nmetrics]);
+		nmetrics++;
+	}
+	free(spec);
+	for(i=0;i<nlengths;i++)
+		if(lengths[i]==0)
+			usage=1;
+	for(i=0;i<ncores;i++)
+		if(cores[i]==0)
+			usage=1;
+	if(usage || optind!=argc) {
+		fprintf(stderr," Usage: %s [-n lengths] [-m model] [-R count:length[:divergence]] [-d rate] [-t cores] [-M metrics] [-w] [-s seed] [-f tsv|json] [-o output]\n",argv[0]);
+		return ( 1 );
+	}
+	if(out_path==NULL)
+		out_path=report.format==bench_format_tsv?"bench_report.tsv":"bench_report.json";
+	report.out=stdout;
+	if(strcmp(out_path,"-")!=0 && (report.out=fopen(out_path,"w"))==NULL) {
+		fprintf(stderr," Error: Cannot open output file %s!\n",out_path);
+		return ( 1 );
+	}
+	synth_model_name(&params,report.model,sizeof(report.model));
+
+	for(l=0;l<nlengths && res==0;l++) {
+		params.length=lengths[l];
+		text1=synth_genome(&params);
+		text2=text1?synth_mutated_copy(text1,params.length,report.divergence,params.seed+1,params.cores,&report.textlen2):NULL;
+		report.textlen1=params.length;
+		if(text2==NULL || report.textlen2==0) {
+			fprintf(stderr," Error: Cannot generate the genomes of length %u!\n",params.length);
+			free(text1);
+			free(text2);
+			res=1;
+			break;
+		}
+		BBWT1=bench_index(text1,report.textlen1,&report);
+		BBWT2=bench_index(text2,report.textlen2,&report);
+		free(text1);
+		free(text2);
+		if(BBWT1==NULL || BBWT2==NULL) {
+			fprintf(stderr," Error: Cannot index the genomes of length %u!\n",params.length);
+			res=1;
+		}
+		for(c=0;c<ncores && res==0;c++) {
+			for(m=0;m<nmetrics;m++) {
+				memset(&log,0,sizeof(log));
+				wall=phase_wall_time();
+				cpu=phase_cpu_time();
+				phase_log=&log;
+				kernel_compute(BBWT1,BBWT2,&metrics[m],cores[c],&result);
+				phase_log=NULL;
+				report_log(&report,cores[c],metric_names[m],result.value,&log,wall,cpu);
+			}
+			if(output_path) {
+				fclose(fopen("output.txt","w"));
+				memset(&log,0,sizeof(log));
+				wall=phase_wall_time();
+				cpu=phase_cpu_time();
+				phase_log=&log;
+				nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&LW,1,cores[c],1,NULL);
+				phase_log=NULL;
+				report_log(&report,cores[c],"maws_output",nMAWs,&log,wall,cpu);
+			}
+		}
+		if(BBWT1)
+			free_Basic_BWT(BBWT1);
+		if(BBWT2)
+			free_Basic_BWT(BBWT2);
+	}
+	if(report.format==bench_format_json)
+		fprintf(report.out,"%s\n]\n",report.nlines?"":"[");
+	if(report.out!=stdout)
+		fclose(report.out);
+	return res;
+}
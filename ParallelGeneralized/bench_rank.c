@@ -0,0 +1,436 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include<unistd.h>
+#include"DNA5_Basic_BWT.h"
+#include"mt19937ar.h"
+
+/*
+ Micro-benchmark of the rank queries of the BWT index: ns per query for
+ random single ranks (DNA5_get_char_pref_counts), clustered ranks of 1 to
+ 7 points inside one interval as issued by the SLT iterators
+ (DNA5_multipe_char_pref_counts), sequential LF walks (LF_map) and random
+ character extraction (DNA5_extract_char), on indexes from cache resident
+ to far beyond the last level cache.
+
+ Every index layout is a rank_layout_ops_t built from the DNA5 index of the
+ same text. To compare a new layout, add its operations to rank_layouts:
+ the harness times it on the same queries and checks that it returns the
+ same answers as the DNA5 layout.
+
+ The text is random: the cost of the queries does not depend on it, and a
+ random string already has a valid LF mapping, so no BWT has to be built.
+*/
+
+#define max_bench_sizes 16
+#define max_query_points 7
+#define bench_rank_seed 5489
+// Largest interval of a clustered query
+#define max_cluster_size 4096
+#define bench_rank_nlayouts (sizeof(rank_layouts)/sizeof(rank_layouts[0]))
+
+typedef struct
+{
+	const char * name;
+	// The layout of the index, NULL on error
+	void * (*build)(Basic_BWT_t * BBWT);
+	void (*free)(void * index);
+	size_t (*bytes)(void * index);
+	// counts[c] is the number of occurrences of character c (0 to 3 for ACGT)
+	// among the characters 0 to pos of the BWT
+	void (*rank)(void * index,unsigned int pos,unsigned int * counts);
+	// rank of t increasing positions, 4 counts per position
+	void (*multi_rank)(void * index,unsigned int t,unsigned int * positions,unsigned int * counts);
+	unsigned int (*extract)(void * index,unsigned int pos);
+	// As LF_map: the row of the suffix preceding the one of row pos+1, or
+	// 0xffffffff at the primary index
+	unsigned int (*LF)(void * index,unsigned int pos);
+} rank_layout_ops_t;
+
+// The DNA5 layout of DNA5_Basic_BWT, used as is
+static void * DNA5_layout_build(Basic_BWT_t * BBWT)
+{
+	return BBWT;
+};
+
+static void DNA5_layout_free(void * index)
+{
+};
+
+static size_t DNA5_layout_bytes(void * index)
+{
+	return ((Basic_BWT_t *)index)->size;
+};
+
+static void DNA5_layout_rank(void * index,unsigned int pos,unsigned int * counts)
+{
+	DNA5_get_char_pref_counts(counts,((Basic_BWT_t *)index)->indexed_BWT,pos);
+};
+
+static void DNA5_layout_multi_rank(void * index,unsigned int t,unsigned int * positions,unsigned int * counts)
+{
+	DNA5_multipe_char_pref_counts(((Basic_BWT_t *)index)->indexed_BWT,t,positions,counts);
+};
+
+static unsigned int DNA5_layout_extract(void * index,unsigned int pos)
+{
+	return DNA5_extract_char(((Basic_BWT_t *)index)->indexed_BWT,pos);
+};
+
+static unsigned int DNA5_layout_LF(void * index,unsigned int pos)
+{
+	return LF_map(pos,(Basic_BWT_t *)index);
+};
+
+// One byte per character and the counts before every block of
+// byte_layout_block characters. Reference point for the packed layout.
+#define byte_layout_block 64
+
+typedef struct
+{
+	unsigned char * chars;
+	unsigned int * counts;
+	unsigned int len;
+	unsigned int char_base[5];
+	unsigned int primary_idx;
+} byte_layout_t;
+
+static void * byte_layout_build(Basic_BWT_t * BBWT)
+{
+	byte_layout_t * layout=(byte_layout_t *)malloc(sizeof(byte_layout_t));
+	unsigned int counts[4]={0,0,0,0};
+	unsigned int i;
+	layout->len=BBWT->textlen+1;
+	layout->chars=(unsigned char *)malloc(layout->len);
+	layout->counts=(unsigned int *)malloc(4*(layout->len/byte_layout_block+1)*sizeof(unsigned int));
+	memcpy(layout->char_base,BBWT->char_base,sizeof(layout->char_base));
+	layout->primary_idx=BBWT->primary_idx;
+	for(i=0;i<layout->len;i++) {
+		if(i%byte_layout_block==0)
+			memcpy(&layout->counts[4*(i/byte_layout_block)],counts,sizeof(counts));
+		layout->chars[i]=DNA5_extract_char(BBWT->indexed_BWT,i);
+		if(layout->chars[i]<4)
+			counts[layout->chars[i]]++;
+	}
+	return layout;
+};
+
+static void byte_layout_free(void * index)
+{
+	byte_layout_t * layout=(byte_layout_t *)index;
+	free(layout->chars);
+	free(layout->counts);
+	free(layout);
+};
+
+static size_t byte_layout_bytes(void * index)
+{
+	byte_layout_t * layout=(byte_layout_t *)index;
+	return layout->len+4*(layout->len/byte_layout_block+1)*sizeof(unsigned int);
+};
+
+static void byte_layout_rank(void * index,unsigned int pos,unsigned int * counts)
+{
+	byte_layout_t * layout=(byte_layout_t *)index;
+	unsigned int i=pos-pos%byte_layout_block;
+	unsigned int c[5];
+	memcpy(c,&layout->counts[4*(pos/byte_layout_block)],4*sizeof(unsigned int));
+	for(;i<=pos;i++)
+		c[layout->chars[i]]++;
+	memcpy(counts,c,4*sizeof(unsigned int));
+};
+
+static void byte_layout_multi_rank(void * index,unsigned int t,unsigned int * positions,unsigned int * counts)
+{
+	unsigned int i;
+	for(i=0;i<t;i++)
+		byte_layout_rank(index,positions[i],&counts[4*i]);
+};
+
+static unsigned int byte_layout_extract(void * index,unsigned int pos)
+{
+	return ((byte_layout_t *)index)->chars[pos];
+};
+
+static unsigned int byte_layout_LF(void * index,unsigned int pos)
+{
+	byte_layout_t * layout=(byte_layout_t *)index;
+	unsigned int counts[4];
+	unsigned int c;
+	pos++;
+	if(pos==layout->primary_idx)
+		return 0xffffffff;
+	c=layout->chars[pos];
+	byte_layout_rank(index,pos,counts);
+	return layout->char_base[c]+counts[c]-(c==0 && pos>layout->primary_idx)-1;
+};
+
+static const rank_layout_ops_t rank_layouts[]=
+{
+	{"DNA5",DNA5_layout_build,DNA5_layout_free,DNA5_layout_bytes,DNA5_layout_rank,
+			DNA5_layout_multi_rank,DNA5_layout_extract,DNA5_layout_LF},
+	{"bytes",byte_layout_build,byte_layout_free,byte_layout_bytes,byte_layout_rank,
+			byte_layout_multi_rank,byte_layout_extract,byte_layout_LF},
+};
+
+static double bench_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1e9+ts.tv_nsec;
+};
+
+// DNA5 index of a random BWT of len characters, with the placeholder 'A'
+// at a random primary index as in Build_BWT_index_from_text
+static Basic_BWT_t * random_BWT(unsigned int len)
+{
+	static const unsigned char bases[4]={'A','C','G','T'};
+	Basic_BWT_t * BBWT=new_Basic_BWT();
+	unsigned char * text=(unsigned char *)malloc(len+2);
+	unsigned int char_count[4];
+	unsigned int i;
+	for(i=0;i<=len;i++)
+		text[i]=bases[genrand_int32()&3];
+	BBWT->primary_idx=1+genrand_int32()%len;
+	text[BBWT->primary_idx]='A';
+	BBWT->indexed_BWT=build_basic_DNA5_seq(text,len+1,&BBWT->size,char_count);
+	free(text);
+	if(BBWT->indexed_BWT==NULL) {
+		free(BBWT);
+		return NULL;
+	}
+	BBWT->char_base[0]=0;
+	BBWT->char_base[1]=char_count[0]-1;
+	for(i=2;i<5;i++)
+		BBWT->char_base[i]=BBWT->char_base[i-1]+char_count[i-1];
+	BBWT->textlen=len;
+	return BBWT;
+};
+
+// nqueries clustered queries of t points: an interval of random size (log
+// uniform up to max_cluster_size) cut at t-1 random places, as the right
+// extensions of an SLT node
+static void cluster_queries(unsigned int * positions,unsigned int nqueries,unsigned int t,unsigned int len)
+{
+	unsigned int q,i,j,size,start,p;
+	unsigned int * points;
+	for(q=0;q<nqueries;q++) {
+		points=&positions[q*max_query_points];
+		size=t+(unsigned int)(genrand_res53()*genrand_res53()*max_cluster_size);
+		if(size>len-1)
+			size=len-1;
+		start=1+genrand_int32()%(len-size);
+		points[0]=start-1;
+		for(i=1;i<t;i++) {
+			p=start+genrand_int32()%size;
+			for(j=i;j>1 && points[j-1]>p;j--)
+				points[j]=points[j-1];
+			points[j]=p;
+		}
+		// Strictly increasing, as the child intervals are not empty
+		for(i=1;i<t;i++)
+			if(points[i]<=points[i-1])
+				points[i]=points[i-1]+1;
+	}
+};
+
+typedef struct
+{
+	const char * test;
+	unsigned int t;
+	unsigned int nqueries;
+	unsigned int npoints;
+	double ns;
+	unsigned long long checksum;
+} rank_result_t;
+
+static void run_layout(const rank_layout_ops_t * ops,void * index,unsigned int len,
+		const unsigned int * random_positions,unsigned int * cluster_positions[max_query_points],
+		unsigned int nqueries,unsigned int nreps,rank_result_t * results)
+{
+	unsigned int counts[4*max_query_points];
+	unsigned int rep,q,t,i,pos;
+	unsigned long long sum;
+	double start,ns;
+	rank_result_t * result;
+	for(rep=0;rep<nreps;rep++) {
+		result=results;
+
+		sum=0;
+		start=bench_ns();
+		for(q=0;q<nqueries;q++) {
+			ops->rank(index,random_positions[q],counts);
+			sum+=counts[random_positions[q]&3];
+		}
+		ns=bench_ns()-start;
+		result->test="rank";
+		result->t=1;
+		result->npoints=nqueries;
+		result->checksum=sum;
+		if(rep==0 || ns<result->ns)
+			result->ns=ns;
+		result++;
+
+		for(t=1;t<=max_query_points;t++) {
+			sum=0;
+			start=bench_ns();
+			for(q=0;q<nqueries;q++) {
+				ops->multi_rank(index,t,&cluster_positions[t-1][q*max_query_points],counts);
+				for(i=0;i<t;i++)
+					sum+=counts[4*i+(i&3)];
+			}
+			ns=bench_ns()-start;
+			result->test="multi_rank";
+			result->t=t;
+			result->npoints=nqueries*t;
+			result->checksum=sum;
+			if(rep==0 || ns<result->ns)
+				result->ns=ns;
+			result++;
+		}
+
+		// Walks restart at a random row when they reach the primary index
+		sum=0;
+		pos=random_positions[0];
+		start=bench_ns();
+		for(q=0;q<nqueries;q++) {
+			pos=ops->LF(index,pos);
+			if(pos==0xffffffff)
+				pos=random_positions[q];
+			sum+=pos;
+		}
+		ns=bench_ns()-start;
+		result->test="LF_walk";
+		result->t=1;
+		result->npoints=nqueries;
+		result->checksum=sum;
+		if(rep==0 || ns<result->ns)
+			result->ns=ns;
+		result++;
+
+		sum=0;
+		start=bench_ns();
+		for(q=0;q<nqueries;q++)
+			sum+=ops->extract(index,random_positions[q])*(q+1);
+		ns=bench_ns()-start;
+		result->test="extract";
+		result->t=1;
+		result->npoints=nqueries;
+		result->checksum=sum;
+		if(rep==0 || ns<result->ns)
+			result->ns=ns;
+	}
+	for(i=0;i<max_query_points+3;i++)
+		results[i].nqueries=nqueries;
+};
+
+int main(int argc, char **argv) {
+								/*options: -n sizes) comma separated BWT lengths (default
+											1000000,16000000,128000000)
+										   -q queries) queries per test (default 1000000)
+										   -r reps) repetitions of every test, the fastest is
+											reported (default 3)
+										   -l layout) time only this layout (the DNA5 layout is
+											always built as the reference)
+										   -o file) report file (default -, the standard output)
+										*/
+	unsigned int sizes[max_bench_sizes]={1000000,16000000,128000000};
+	unsigned int nsizes=3;
+	unsigned int nqueries=1000000;
+	unsigned int nreps=3;
+	const char * only_layout=NULL;
+	const char * out_path="-";
+	FILE * out=stdout;
+	unsigned int * random_positions;
+	unsigned int * cluster_positions[max_query_points];
+	rank_result_t reference[max_query_points+3];
+	rank_result_t results[max_query_points+3];
+	Basic_BWT_t * BBWT;
+	void * index;
+	unsigned int s,l,t,i,len;
+	char * spec;
+	char * tok;
+	int opt,usage=0;
+	while(!usage && (opt=getopt(argc,argv,"n:q:r:l:o:"))!=-1) {
+		switch(opt) {
+		case 'n':
+			nsizes=0;
+			spec=strdup(optarg);
+			for(tok=strtok(spec,",");tok && nsizes<max_bench_sizes;tok=strtok(NULL,","))
+				if((sizes[nsizes++]=atoi(tok))<2*max_cluster_size)
+					usage=1;
+			free(spec);
+			break;
+		case 'q':
+			nqueries=atoi(optarg);
+			break;
+		case 'r':
+			nreps=atoi(optarg);
+			break;
+		case 'l':
+			only_layout=optarg;
+			break;
+		case 'o':
+			out_path=optarg;
+			break;
+		default:
+			usage=1;
+		}
+	}
+	if(usage || optind!=argc || nsizes==0 || nqueries==0 || nreps==0) {
+		fprintf(stderr," Usage: %s [-n sizes] [-q queries] [-r reps] [-l layout] [-o output]\n",argv[0]);
+		fprintf(stderr," Every size must be at least %u\n",2*max_cluster_size);
+		return ( 1 );
+	}
+	if(strcmp(out_path,"-")!=0 && (out=fopen(out_path,"w"))==NULL) {
+		fprintf(stderr," Error: Cannot open output file %s!\n",out_path);
+		return ( 1 );
+	}
+
+	init_genrand(bench_rank_seed);
+	random_positions=(unsigned int *)malloc(nqueries*sizeof(unsigned int));
+	for(t=0;t<max_query_points;t++)
+		cluster_positions[t]=(unsigned int *)malloc(nqueries*max_query_points*sizeof(unsigned int));
+	fprintf(out,"layout\tlength\tbytes\ttest\tpoints\tqueries\tns_per_query\tns_per_point\tsame_answers\n");
+	for(s=0;s<nsizes;s++) {
+		len=sizes[s];
+		if((BBWT=random_BWT(len))==NULL) {
+			fprintf(stderr," Error: Cannot allocate an index of length %u!\n",len);
+			continue;
+		}
+		for(i=0;i<nqueries;i++)
+			random_positions[i]=genrand_int32()%len;
+		for(t=1;t<=max_query_points;t++)
+			cluster_queries(cluster_positions[t-1],nqueries,t,len);
+		for(l=0;l<bench_rank_nlayouts;l++) {
+			if(l && only_layout && strcmp(only_layout,rank_layouts[l].name)!=0)
+				continue;
+			if((index=rank_layouts[l].build(BBWT))==NULL) {
+				fprintf(stderr," Error: Cannot build the %s layout of length %u!\n",rank_layouts[l].name,len);
+				continue;
+			}
+			run_layout(&rank_layouts[l],index,len,random_positions,cluster_positions,nqueries,nreps,
+					l?results:reference);
+			if(l==0 && only_layout && strcmp(only_layout,rank_layouts[l].name)!=0) {
+				rank_layouts[l].free(index);
+				continue;
+			}
+			for(i=0;i<max_query_points+3;i++) {
+				rank_result_t * result=l?&results[i]:&reference[i];
+				fprintf(out,"%s\t%u\t%lu\t%s\t%u\t%u\t%f\t%f\t%s\n",rank_layouts[l].name,len,
+						(unsigned long)rank_layouts[l].bytes(index),result->test,result->t,
+						result->nqueries,result->ns/result->nqueries,result->ns/result->npoints,
+						result->checksum==reference[i].checksum?"yes":"NO");
+			}
+			rank_layouts[l].free(index);
+		}
+		free_Basic_BWT(BBWT);
+	}
+	free(random_positions);
+	for(t=0;t<max_query_points;t++)
+		free(cluster_positions[t]);
+	if(out!=stdout)
+		fclose(out);
+	return 0;
+}
@@ -0,0 +1,242 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include"DNA5_Basic_BWT.h"
+#include"kernel_metrics.h"
+#include"phase_log.h"
+#include"synth_genome.h"
+
+/*
+ Scaling study on synthetic genomes: runs every metric for every number of
+ cores and every genome length in one invocation, and writes one CSV line
+ per phase (master, slaves, combine, and total for the whole metric) with
+ its wall time, CPU time, speedup and parallel efficiency.
+
+ Strong scaling (the default) indexes every pair of genomes once and runs
+ it on every number of cores: the speedup of a phase is its wall time on
+ the first number of cores of -t over its wall time on c cores, and the
+ efficiency is the speedup times the first number of cores over c. Weak
+ scaling (-W) draws genomes of length times c bases for c cores: the
+ efficiency is the wall time on the first number of cores over the wall
+ time on c cores, and the speedup is the scaled speedup, the efficiency
+ times c over the first number of cores.
+
+ Every point is the run with the smallest total wall time out of -r runs.
+*/
+
+#define max_scaling_values 32
+#define scaling_phases 3
+
+static const char * const scaling_phase_names[scaling_phases]={"master","slaves","combine"};
+
+typedef struct
+{
+	double wall[scaling_phases+1];
+	double cpu[scaling_phases+1];
+	unsigned int count[scaling_phases+1];
+	double value;
+} scaling_point_t;
+
+// The fastest of runs runs of metric on cores cores. The last entry of the
+// point is the whole metric.
+static void scaling_run(Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,const kernel_metric_t * metric,
+		unsigned int cores,unsigned int runs,scaling_point_t * point)
+{
+	phase_log_t log;
+	kernel_result_t result;
+	scaling_point_t run;
+	double wall,cpu;
+	unsigned int r,i,p;
+	for(r=0;r<runs;r++) {
+		memset(&log,0,sizeof(log));
+		memset(&run,0,sizeof(run));
+		wall=phase_wall_time();
+		cpu=phase_cpu_time();
+		phase_log=&log;
+		kernel_compute(BBWT1,BBWT2,metric,cores,&result);
+		phase_log=NULL;
+		run.wall[scaling_phases]=phase_wall_time()-wall;
+		run.cpu[scaling_phases]=phase_cpu_time()-cpu;
+		run.count[scaling_phases]=1;
+		run.value=result.value;
+		for(i=0;i<log.nphases;i++)
+			for(p=0;p<scaling_phases;p++)
+				if(strcmp(log.phases[i].name,scaling_phase_names[p])==0) {
+					run.wall[p]=log.phases[i].wall;
+					run.cpu[p]=log.phases[i].cpu;
+					run.count[p]=log.phases[i].count;
+				}
+		if(r==0 || run.wall[scaling_phases]<point->wall[scaling_phases])
+			*point=run;
+	}
+};
+
+int main(int argc, char **argv) {
+								/*options: -n lengths) comma separated genome lengths, per core
+											with -W (default 1000000,4000000)
+										   -t cores) comma separated numbers of cores, the first
+											being the reference of the speedups (default 1,2,4,8)
+										   -W) weak scaling: genomes of length times cores bases
+										   -m model) uniform (default), gc:<fraction> or markov:<order>
+										   -R count:length[:divergence]) insert count repeats of
+											length bases, each mutated at divergence (default 0)
+										   -d rate) divergence of the second genome from the first
+											(default 0.01)
+										   -M metrics) comma separated metrics (default maws,kernel)
+										   -r runs) runs per point, the fastest is kept (default 3)
+										   -s seed) seed of mt19937ar (default 1)
+										   -o file) CSV file (default bench_scaling.csv, - for the
+											standard output)
+										*/
+	synth_params_t params;
+	unsigned int lengths[max_scaling_values]={1000000,4000000};
+	unsigned int cores[max_scaling_values]={1,2,4,8};
+	unsigned int nlengths=2,ncores=4,nmetrics=0,runs=3,weak=0;
+	kernel_metric_t metrics[max_scaling_values];
+	char metric_names[max_scaling_values][kernel_metric_name_len];
+	scaling_point_t base[max_scaling_values];
+	scaling_point_t point;
+	const char * metric_spec="maws,kernel";
+	const char * out_path="bench_scaling.csv";
+	FILE * out=stdout;
+	char model[64];
+	double divergence=0.01,speedup,efficiency,ratio;
+	unsigned char * text1;
+	unsigned char * text2;
+	unsigned int textlen2,i,l,c,m,p;
+	Basic_BWT_t * BBWT1=NULL;
+	Basic_BWT_t * BBWT2=NULL;
+	char * spec;
+	char * tok;
+	int opt,usage=0,res=0;
+	memset(&params,0,sizeof(params));
+	params.seed=1;
+	while(!usage && (opt=getopt(argc,argv,"n:t:Wm:R:d:M:r:s:o:"))!=-1) {
+		switch(opt) {
+		case 'n':
+			if(kernel_parse_list(optarg,lengths,max_scaling_values,&nlengths)!=0)
+				usage=1;
+			break;
+		case 't':
+			if(kernel_parse_list(optarg,cores,max_scaling_values,&ncores)!=0)
+				usage=1;
+			break;
+		case 'W':
+			weak=1;
+			break;
+		case 'm':
+			if(synth_parse_model(optarg,&params)!=0)
+				usage=1;
+			break;
+		case 'R':
+			if(sscanf(optarg,"%u:%u:%lf",&params.nrepeats,&params.repeat_len,&params.repeat_divergence)<2)
+				usage=1;
+			break;
+		case 'd':
+			divergence=atof(optarg);
+			break;
+		case 'M':
+			metric_spec=optarg;
+			break;
+		case 'r':
+			runs=atoi(optarg);
+			break;
+		case 's':
+			params.seed=strtoull(optarg,NULL,10);
+			break;
+		case 'o':
+			out_path=optarg;
+			break;
+		default:
+			usage=1;
+		}
+	}
+	spec=strdup(metric_spec);
+	for(tok=strtok(spec,",");tok && nmetrics<max_scaling_values;tok=strtok(NULL,",")) {
+		if(kernel_parse_metric(tok,&metrics[nmetrics])!=0) {
+			fprintf(stderr," Error: unknown metric %s\n",tok);
+			usage=1;
+			break;
+		}
+		kernel_metric_name(&metrics[nmetrics],metric_names[nmetrics]);
+		nmetrics++;
+	}
+	free(spec);
+	for(i=0;i<nlengths;i++)
+		if(lengths[i]==0)
+			usage=1;
+	for(i=0;i<ncores;i++)
+		if(cores[i]==0)
+			usage=1;
+	if(usage || optind!=argc || runs==0) {
+		fprintf(stderr," Usage: %s [-n lengths] [-t cores] [-W] [-m model] [-R count:length[:divergence]] [-d rate] [-M metrics] [-r runs] [-s seed] [-o output]\n",argv[0]);
+		return ( 1 );
+	}
+	if(strcmp(out_path,"-")!=0 && (out=fopen(out_path,"w"))==NULL) {
+		fprintf(stderr," Error: Cannot open output file %s!\n",out_path);
+		return ( 1 );
+	}
+	synth_model_name(&params,model,sizeof(model));
+	fprintf(out,"scaling,model,divergence,length,textlen1,textlen2,cores,metric,value,phase,count,"
+			"wall,cpu,speedup,efficiency\n");
+
+	for(l=0;l<nlengths && res==0;l++)
+		for(c=0;c<ncores && res==0;c++) {
+			// Strong scaling indexes the genomes once per length
+			if(c==0 || weak) {
+				if(BBWT1)
+					free_Basic_BWT(BBWT1);
+				if(BBWT2)
+					free_Basic_BWT(BBWT2);
+				BBWT1=BBWT2=NULL;
+				params.length=weak?lengths[l]*cores[c]:lengths[l];
+				text1=synth_genome(&params);
+				text2=text1?synth_mutated_copy(text1,params.length,divergence,params.seed+1,0,&textlen2):NULL;
+				if(text2==NULL || textlen2==0) {
+					fprintf(stderr," Error: Cannot generate the genomes of length %u!\n",params.length);
+					free(text1);
+					free(text2);
+					res=1;
+					break;
+				}
+				BBWT1=Build_BWT_index_from_text(text1,params.length,Basic_bwt_free_text);
+				BBWT2=Build_BWT_index_from_text(text2,textlen2,Basic_bwt_free_text);
+				free(text1);
+				free(text2);
+				if(BBWT1==NULL || BBWT2==NULL) {
+					fprintf(stderr," Error: Cannot index the genomes of length %u!\n",params.length);
+					res=1;
+					break;
+				}
+			}
+			for(m=0;m<nmetrics;m++) {
+				scaling_run(BBWT1,BBWT2,&metrics[m],cores[c],runs,&point);
+				if(c==0)
+					base[m]=point;
+				for(p=0;p<=scaling_phases;p++) {
+					ratio=point.wall[p]>0?base[m].wall[p]/point.wall[p]:0;
+					if(weak) {
+						efficiency=ratio;
+						speedup=ratio*cores[c]/cores[0];
+					}
+					else {
+						speedup=ratio;
+						efficiency=ratio*cores[0]/cores[c];
+					}
+					fprintf(out,"%s,%s,%f,%u,%u,%u,%u,%s,%f,%s,%u,%f,%f,%f,%f\n",weak?"weak":"strong",model,
+							divergence,lengths[l],params.length,textlen2,cores[c],metric_names[m],point.value,
+							p<scaling_phases?scaling_phase_names[p]:"total",point.count[p],point.wall[p],
+							point.cpu[p],speedup,efficiency);
+				}
+			}
+			fflush(out);
+		}
+	if(BBWT1)
+		free_Basic_BWT(BBWT1);
+	if(BBWT2)
+		free_Basic_BWT(BBWT2);
+	if(out!=stdout)
+		fclose(out);
+	return res;
+}
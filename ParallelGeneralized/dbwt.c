@@ -804,7 +804,7 @@ uchar * dbwt_bwt(uchar * T,long n,unsigned int *_last,unsigned int free_text)
   
 
  // dbwt_report_mem("done");
-//  printf("%.2f bpc\n",(double) dbwt_max_alloc/n);
+//  printf("%.2f bpc\n",(double) mem_peak(mem_construction)/n);
   //printf("end");  getchar();
   for (c=0; c<=SIGMA; c++) {
     dbwt_free_queue(Q[TYPE_L][c]);
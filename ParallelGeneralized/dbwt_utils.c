@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "dbwt_utils.h"
+#include "mem_account.h"
 
 int dbwt_blog(ulong x)
 {
@@ -19,21 +20,16 @@ int l;
   return l;
 }
 
-size_t dbwt_cur_alloc=0, dbwt_max_alloc=0;
+// The allocations of the construction are accounted in mem_construction
 void * dbwt_mymalloc(size_t n)
 {
   void *p;
 
-  p = malloc(n);
+  p = mem_malloc(mem_construction,n);
   if (p == NULL) {
     printf("malloc failed.\n");
     exit(1);
   }
-  dbwt_cur_alloc += n;
-  if (dbwt_cur_alloc > dbwt_max_alloc) {
-    dbwt_max_alloc = dbwt_cur_alloc;
-    //printf("allocated %ld\n",max_alloc);
-  }
 
   if (n == 0) {
     printf("warning: 0 bytes allocated p=%p\n",p);
@@ -46,16 +42,11 @@ void *dbwt_myrealloc(void *ptr, size_t new, size_t old)
 {
   void *p;
 
-  p = realloc(ptr, new);
+  p = mem_realloc(mem_construction, ptr, new, old);
   if (new > 0 && p == NULL) {
     printf("realloc failed. ptr=%p new=%d old=%d\n",ptr,new,old);
     exit(1);
   }
-  dbwt_cur_alloc += new - old;
-  if (dbwt_cur_alloc > dbwt_max_alloc) {
-    dbwt_max_alloc = dbwt_cur_alloc;
-    //printf("allocated %ld\n",max_alloc);
-  }
 //  printf("free alloc_pointer %p with size %lu\n",ptr,(long unsigned int )old);
 //  printf("alloc_pointer is %p with size %lu\n",p,(long unsigned int )new);
   return p;
@@ -65,14 +56,13 @@ void dbwt_report_mem(char *s)
 {
   puts(s);
   printf("allocated total %lu   max %lu\n", 
-	(unsigned long) dbwt_cur_alloc,(unsigned long) dbwt_max_alloc);
+	(unsigned long) mem_current(mem_construction),(unsigned long) mem_peak(mem_construction));
 }
 
 
 void dbwt_myfree(void *p, size_t s)
 {
-  free(p);
-  dbwt_cur_alloc -= s;
+  mem_free(mem_construction,p,s);
 //  printf("free alloc_pointer %p with size %lu\n",p,(long unsigned int )s);
 
 }
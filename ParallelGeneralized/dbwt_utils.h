@@ -51,7 +51,6 @@ void * dbwt_mymalloc(size_t n);
 void * dbwt_myrealloc(void *ptr, size_t new, size_t old);
 void  dbwt_myfree(void *p, size_t s);
 void dbwt_report_mem(char *s);
-extern size_t dbwt_cur_alloc, dbwt_max_alloc;
 
 unsigned int dbwt_getbits(unsigned short *B, unsigned long i, int d);
 
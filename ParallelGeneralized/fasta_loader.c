@@ -0,0 +1,474 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<pthread.h>
+#include<zlib.h>
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
+#include"fasta_loader.h"
+
+#define FASTA_read_chunk_size (1<<20)
+// Decompressed chunks in flight between the gzip reader thread and the parser
+#define FASTA_gz_nchunks 4
+// Expected ratio between the decompressed and the compressed size
+#define FASTA_gz_size_ratio 4
+
+static const unsigned char complement_table[256]={['A']='T',['C']='G',['G']='C',['T']='A',
+	[FASTA_record_separator]=FASTA_record_separator};
+
+static inline unsigned int is_DNA_base(unsigned char c)
+{
+	return c=='A' || c=='C' || c=='G' || c=='T';
+};
+
+static int fasta_parser_reserve(fasta_parser_t * parser,size_t n)
+{
+	size_t needed=parser->seqlen+n+FASTA_buffer_slack;
+	size_t new_capacity;
+	unsigned char * new_seq;
+	if(needed<=parser->capacity)
+		return 0;
+	new_capacity=parser->capacity*2>needed?parser->capacity*2:needed;
+	new_seq=(unsigned char *)realloc(parser->seq,new_capacity);
+	if(new_seq==NULL)
+		return FASTA_error_memory;
+	parser->seq=new_seq;
+	parser->capacity=new_capacity;
+	return 0;
+};
+
+// Returns the first newline in [p,end), or end
+static inline const unsigned char * skip_header(const unsigned char * p,const unsigned char * end)
+{
+#ifdef __SSE2__
+	const __m128i newline=_mm_set1_epi8('\n');
+	unsigned int mask;
+	for(;p+16<=end;p+=16)
+	{
+		mask=_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p),newline));
+		if(mask)
+			return p+__builtin_ctz(mask);
+	};
+#endif
+	while(p<end && *p!='\n')
+		p++;
+	return p;
+};
+
+// Copies the bases in [p,end) to *_out, stopping at the first '>' which is
+// returned (end if there is none). Whole blocks of bases, the common case in
+// sequence lines, are copied with a single store.
+static inline const unsigned char * copy_bases(const unsigned char * p,const unsigned char * end,
+		unsigned char ** _out)
+{
+	unsigned char * out=*_out;
+#ifdef __SSE2__
+	const __m128i A=_mm_set1_epi8('A');
+	const __m128i C=_mm_set1_epi8('C');
+	const __m128i G=_mm_set1_epi8('G');
+	const __m128i T=_mm_set1_epi8('T');
+	const __m128i gt=_mm_set1_epi8('>');
+	__m128i block;
+	unsigned int keep,stop;
+	for(;p+16<=end;)
+	{
+		block=_mm_loadu_si128((const __m128i *)p);
+		keep=_mm_movemask_epi8(_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(block,A),_mm_cmpeq_epi8(block,C)),
+				_mm_or_si128(_mm_cmpeq_epi8(block,G),_mm_cmpeq_epi8(block,T))));
+		if(keep==0xffff)
+		{
+			_mm_storeu_si128((__m128i *)out,block);
+			out+=16;
+			p+=16;
+			continue;
+		};
+		stop=_mm_movemask_epi8(_mm_cmpeq_epi8(block,gt));
+		if(stop)
+			keep&=(1u<<__builtin_ctz(stop))-1;
+		while(keep)
+		{
+			*out++=p[__builtin_ctz(keep)];
+			keep&=keep-1;
+		};
+		if(stop)
+		{
+			*_out=out;
+			return p+__builtin_ctz(stop);
+		};
+		p+=16;
+	};
+#endif
+	for(;p<end && *p!='>';p++)
+		if(is_DNA_base(*p))
+			*out++=*p;
+	*_out=out;
+	return p;
+};
+
+// Open a new record at the '>' of its header
+static int begin_record(fasta_parser_t * parser)
+{
+	fasta_records_t * records=&parser->records;
+	unsigned int * new_starts;
+	char ** new_names;
+	parser->nrecords++;
+	if(!(parser->options&FASTA_load_records))
+		return 0;
+	if(records->nrecords==parser->records_capacity)
+	{
+		parser->records_capacity=parser->records_capacity*2+16;
+		new_starts=(unsigned int *)realloc(records->starts,parser->records_capacity*sizeof(unsigned int));
+		if(new_starts==NULL)
+			return FASTA_error_memory;
+		records->starts=new_starts;
+		new_names=(char **)realloc(records->names,parser->records_capacity*sizeof(char *));
+		if(new_names==NULL)
+			return FASTA_error_memory;
+		records->names=new_names;
+	};
+	records->starts[records->nrecords]=0;
+	records->names[records->nrecords]=NULL;
+	records->nrecords++;
+	parser->name_len=0;
+	parser->name_done=0;
+	return 0;
+};
+
+// Collect the record name: the header up to the first blank
+static void append_name(fasta_parser_t * parser,const unsigned char * p,const unsigned char * end)
+{
+	for(;p<end && !parser->name_done;p++)
+	{
+		if(*p==' ' || *p=='\t' || *p=='\r' || parser->name_len==FASTA_max_name_len)
+			parser->name_done=1;
+		else
+			parser->name[parser->name_len++]=*p;
+	};
+};
+
+// The header of the last record is complete: its bases start at seqlen
+static int end_header(fasta_parser_t * parser,size_t seqlen)
+{
+	fasta_records_t * records=&parser->records;
+	char * name;
+	if(!(parser->options&FASTA_load_records))
+		return 0;
+	if((name=(char *)malloc(parser->name_len+1))==NULL)
+		return FASTA_error_memory;
+	memcpy(name,parser->name,parser->name_len);
+	name[parser->name_len]=0;
+	records->starts[records->nrecords-1]=seqlen;
+	records->names[records->nrecords-1]=name;
+	return 0;
+};
+
+void fasta_parser_init(fasta_parser_t * parser,size_t size_hint,unsigned int options)
+{
+	memset(parser,0,sizeof(fasta_parser_t));
+	parser->options=options;
+	parser->state=FASTA_state_start;
+	if(size_hint)
+	{
+		parser->seq=(unsigned char *)malloc(size_hint+FASTA_buffer_slack);
+		if(parser->seq)
+			parser->capacity=size_hint+FASTA_buffer_slack;
+	};
+};
+
+int fasta_parser_feed(fasta_parser_t * parser,const unsigned char * chunk,size_t n)
+{
+	const unsigned char * p=chunk;
+	const unsigned char * end=chunk+n;
+	const unsigned char * header_end;
+	unsigned char * out;
+	int res=0;
+	if(fasta_parser_reserve(parser,n)!=0)
+		return FASTA_error_memory;
+	out=parser->seq+parser->seqlen;
+	while(p<end && res==0)
+	{
+		switch(parser->state)
+		{
+		case FASTA_state_start:
+			if(*p!='>')
+				return FASTA_error_format;
+			parser->state=FASTA_state_header;
+			res=begin_record(parser);
+			p++;
+			break;
+		case FASTA_state_header:
+			header_end=skip_header(p,end);
+			if(parser->options&FASTA_load_records)
+				append_name(parser,p,header_end);
+			p=header_end;
+			if(p<end)
+			{
+				parser->state=FASTA_state_sequence;
+				res=end_header(parser,out-parser->seq);
+				p++;
+			};
+			break;
+		default:
+			p=copy_bases(p,end,&out);
+			if(p<end)
+			{
+				// Each '>' is replaced by at most one separator, so the
+				// reserved room is enough. Without FASTA_load_records the
+				// separators only go between non-empty records.
+				if((parser->options&FASTA_load_records) ||
+						(out>parser->seq && out[-1]!=FASTA_record_separator))
+					*out++=FASTA_record_separator;
+				parser->state=FASTA_state_header;
+				res=begin_record(parser);
+				p++;
+			};
+		};
+	};
+	parser->seqlen=out-parser->seq;
+	return res;
+};
+
+// Hands the sequence over to the caller. With FASTA_load_RC the sequence is
+// followed by 'Z', its reverse complement and another 'Z'. The returned
+// buffer holds a 0 byte past the end.
+int fasta_parser_finish(fasta_parser_t * parser,unsigned char ** seq,unsigned int * seqlen)
+{
+	size_t n;
+	unsigned char * out;
+	if(parser->state==FASTA_state_start)
+		return FASTA_error_format;
+	if(parser->options&FASTA_load_records)
+	{
+		if(fasta_parser_reserve(parser,1)!=0)
+			return FASTA_error_memory;
+		if(parser->state==FASTA_state_header && end_header(parser,parser->seqlen)!=0)
+			return FASTA_error_memory;
+		parser->seq[parser->seqlen++]=FASTA_record_separator;
+	};
+	n=parser->seqlen;
+	if(parser->options&FASTA_load_RC)
+	{
+		if(fasta_parser_reserve(parser,n+2)!=0)
+			return FASTA_error_memory;
+		out=parser->seq+n;
+		*out++='Z';
+		fasta_reverse_complement(parser->seq,n,out);
+		out+=n;
+		*out++='Z';
+		parser->seqlen=out-parser->seq;
+	};
+	// dbwt reads the byte past the text as part of its last S* substring,
+	// it must sort before every character
+	if(fasta_parser_reserve(parser,1)!=0)
+		return FASTA_error_memory;
+	parser->seq[parser->seqlen]=0;
+	*seq=parser->seq;
+	*seqlen=parser->seqlen;
+	parser->seq=NULL;
+	parser->capacity=0;
+	return 0;
+};
+
+// Reverse complement of the n bytes of seq, written to out. The record
+// separators stay separators.
+void fasta_reverse_complement(const unsigned char * seq,size_t n,unsigned char * out)
+{
+	size_t i;
+	for(i=n;i>0;i--)
+		*out++=complement_table[seq[i-1]];
+};
+
+void fasta_parser_free(fasta_parser_t * parser)
+{
+	free(parser->seq);
+	parser->seq=NULL;
+	parser->capacity=0;
+	free_fasta_records(&parser->records);
+	parser->records_capacity=0;
+};
+
+void free_fasta_records(fasta_records_t * records)
+{
+	unsigned int i;
+	if(records->names)
+		for(i=0;i<records->nrecords;i++)
+			free(records->names[i]);
+	free(records->names);
+	free(records->starts);
+	memset(records,0,sizeof(fasta_records_t));
+};
+
+typedef struct
+{
+	gzFile gz;
+	unsigned char * chunk[FASTA_gz_nchunks];
+	int chunk_len[FASTA_gz_nchunks];
+	unsigned int nproduced;
+	unsigned int nconsumed;
+	unsigned int stop;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} gz_pipe_t;
+
+// Producer: decompress the input into the free chunks until the end of the
+// stream, an error (chunk length -1), or until the consumer stops. gzread goes
+// through concatenated gzip members, hence BGZF files, transparently.
+static void * gz_pipe_reader(void * arg)
+{
+	gz_pipe_t * pipe=(gz_pipe_t *)arg;
+	unsigned int idx;
+	int n,err;
+	do
+	{
+		pthread_mutex_lock(&pipe->lock);
+		while(pipe->nproduced-pipe->nconsumed==FASTA_gz_nchunks && !pipe->stop)
+			pthread_cond_wait(&pipe->cond,&pipe->lock);
+		idx=pipe->nproduced%FASTA_gz_nchunks;
+		n=pipe->stop?0:1;
+		pthread_mutex_unlock(&pipe->lock);
+		if(n)
+		{
+			n=gzread(pipe->gz,pipe->chunk[idx],FASTA_read_chunk_size);
+			// A truncated stream ends without data but with an error set
+			if(n==0 && gzerror(pipe->gz,&err)!=NULL && err!=Z_OK)
+				n=-1;
+		};
+		pthread_mutex_lock(&pipe->lock);
+		pipe->chunk_len[idx]=n;
+		pipe->nproduced++;
+		pthread_cond_signal(&pipe->cond);
+		pthread_mutex_unlock(&pipe->lock);
+	} while(n>0);
+	return NULL;
+};
+
+// Parse a gzip (or BGZF) compressed FASTA file, decompressing on a separate
+// thread so that inflating and parsing overlap. Closes fd.
+static int load_fasta_gz(int fd,fasta_parser_t * parser)
+{
+	gz_pipe_t pipe;
+	pthread_t reader;
+	unsigned int i,idx;
+	int n,res=0;
+	memset(&pipe,0,sizeof(gz_pipe_t));
+	if((pipe.gz=gzdopen(fd,"rb"))==NULL)
+	{
+		close(fd);
+		return FASTA_error_memory;
+	};
+	gzbuffer(pipe.gz,FASTA_read_chunk_size/4);
+	for(i=0;i<FASTA_gz_nchunks;i++)
+		if((pipe.chunk[i]=(unsigned char *)malloc(FASTA_read_chunk_size))==NULL)
+			res=FASTA_error_memory;
+	pthread_mutex_init(&pipe.lock,NULL);
+	pthread_cond_init(&pipe.cond,NULL);
+	if(res==0 && pthread_create(&reader,NULL,gz_pipe_reader,&pipe)!=0)
+		res=FASTA_error_memory;
+	if(res==0)
+	{
+		do
+		{
+			pthread_mutex_lock(&pipe.lock);
+			while(pipe.nproduced==pipe.nconsumed)
+				pthread_cond_wait(&pipe.cond,&pipe.lock);
+			idx=pipe.nconsumed%FASTA_gz_nchunks;
+			n=pipe.chunk_len[idx];
+			pthread_mutex_unlock(&pipe.lock);
+			if(n>0)
+				res=fasta_parser_feed(parser,pipe.chunk[idx],n);
+			else if(n<0)
+				res=FASTA_error_read;
+			pthread_mutex_lock(&pipe.lock);
+			pipe.nconsumed++;
+			if(res!=0)
+				pipe.stop=1;
+			pthread_cond_signal(&pipe.cond);
+			pthread_mutex_unlock(&pipe.lock);
+		} while(n>0 && res==0);
+		pthread_join(reader,NULL);
+	};
+	pthread_mutex_destroy(&pipe.lock);
+	pthread_cond_destroy(&pipe.cond);
+	for(i=0;i<FASTA_gz_nchunks;i++)
+		free(pipe.chunk[i]);
+	gzclose(pipe.gz);
+	return res;
+};
+
+// Load a (Multi)FASTA file. gzip and BGZF files are recognised by their magic
+// number and decompressed on the fly. Other regular files are memory mapped
+// and parsed in one go into a buffer sized after the file; anything that
+// cannot be mapped is read in chunks.
+static int load_fasta_parser(const char * path,unsigned int options,fasta_parser_t * parser,
+		unsigned char ** seq,unsigned int * seqlen)
+{
+	struct stat st;
+	unsigned char * data;
+	unsigned char magic[2];
+	ssize_t nread=0;
+	int fd,res=0;
+	memset(parser,0,sizeof(fasta_parser_t));
+	if((fd=open(path,O_RDONLY))<0)
+		return FASTA_error_open;
+	if(fstat(fd,&st)!=0)
+		st.st_mode=0;
+	if(S_ISREG(st.st_mode) && pread(fd,magic,2,0)==2 && magic[0]==0x1f && magic[1]==0x8b)
+	{
+		fasta_parser_init(parser,st.st_size*FASTA_gz_size_ratio,options);
+		res=load_fasta_gz(fd,parser);
+	}
+	else if(S_ISREG(st.st_mode) && st.st_size>0 &&
+			(data=(unsigned char *)mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0))!=MAP_FAILED)
+	{
+		madvise(data,st.st_size,MADV_SEQUENTIAL);
+		fasta_parser_init(parser,(options&FASTA_load_RC)?2*st.st_size+2:st.st_size,options);
+		res=fasta_parser_feed(parser,data,st.st_size);
+		munmap(data,st.st_size);
+		close(fd);
+	}
+	else
+	{
+		fasta_parser_init(parser,0,options);
+		data=(unsigned char *)malloc(FASTA_read_chunk_size);
+		if(data==NULL)
+			res=FASTA_error_memory;
+		while(res==0 && (nread=read(fd,data,FASTA_read_chunk_size))>0)
+			res=fasta_parser_feed(parser,data,nread);
+		if(nread<0)
+			res=FASTA_error_read;
+		free(data);
+		close(fd);
+	};
+	if(res==0)
+		res=fasta_parser_finish(parser,seq,seqlen);
+	return res;
+};
+
+int load_fasta(const char * path,unsigned int options,
+		unsigned char ** seq,unsigned int * seqlen)
+{
+	fasta_parser_t parser;
+	int res=load_fasta_parser(path,options&~FASTA_load_records,&parser,seq,seqlen);
+	fasta_parser_free(&parser);
+	return res;
+};
+
+int load_fasta_records(const char * path,unsigned char ** seq,unsigned int * seqlen,
+		fasta_records_t * records)
+{
+	fasta_parser_t parser;
+	int res=load_fasta_parser(path,FASTA_load_records,&parser,seq,seqlen);
+	if(res==0)
+	{
+		*records=parser.records;
+		memset(&parser.records,0,sizeof(fasta_records_t));
+	};
+	fasta_parser_free(&parser);
+	return res;
+};
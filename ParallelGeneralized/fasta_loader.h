@@ -0,0 +1,69 @@
+#ifndef fasta_loader_h
+#define fasta_loader_h
+#include<stdlib.h>
+
+// Options of load_fasta
+#define FASTA_load_plain 0
+#define FASTA_load_RC 1
+// End every record with FASTA_record_separator and keep the record
+// boundaries and names (see load_fasta_records)
+#define FASTA_load_records 2
+
+#define FASTA_record_separator 'Z'
+#define FASTA_max_name_len 255
+
+// Error codes returned by the loader
+#define FASTA_error_open -1
+#define FASTA_error_format -2
+#define FASTA_error_memory -3
+#define FASTA_error_read -4
+
+// Bytes the parser may write past the end of the sequence (vector stores)
+#define FASTA_buffer_slack 16
+
+#define FASTA_state_start 0
+#define FASTA_state_header 1
+#define FASTA_state_sequence 2
+
+// Records of a multi-FASTA file loaded with FASTA_load_records: record i
+// starts at text position starts[i] and ends with a separator
+typedef struct
+{
+	unsigned int nrecords;
+	unsigned int * starts;
+	char ** names;
+} fasta_records_t;
+
+// Stateful (Multi)FASTA parser. The input can be fed in chunks of any size;
+// record headers, newlines and every character other than the uppercase
+// A, C, G, T are dropped and the records are concatenated with a
+// FASTA_record_separator between them, so that no word spans two records.
+typedef struct
+{
+	unsigned char * seq;
+	size_t seqlen;
+	size_t capacity;
+	unsigned int options;
+	unsigned int state;
+	unsigned int nrecords;
+	fasta_records_t records;
+	unsigned int records_capacity;
+	unsigned int name_len;
+	unsigned int name_done;
+	char name[FASTA_max_name_len+1];
+} fasta_parser_t;
+
+void fasta_parser_init(fasta_parser_t * parser,size_t size_hint,unsigned int options);
+int fasta_parser_feed(fasta_parser_t * parser,const unsigned char * chunk,size_t n);
+int fasta_parser_finish(fasta_parser_t * parser,unsigned char ** seq,unsigned int * seqlen);
+void fasta_parser_free(fasta_parser_t * parser);
+void fasta_reverse_complement(const unsigned char * seq,size_t n,unsigned char * out);
+
+int load_fasta(const char * path,unsigned int options,
+		unsigned char ** seq,unsigned int * seqlen);
+// Load every record as its own document (FASTA_load_RC is not supported)
+int load_fasta_records(const char * path,unsigned char ** seq,unsigned int * seqlen,
+		fasta_records_t * records);
+void free_fasta_records(fasta_records_t * records);
+
+#endif
@@ -1,6 +1,7 @@
 #include<stdlib.h>
 #include<stdio.h>
 #include"indexed_DNA5_seq.h"
+#include"mem_account.h"
 
 #define DNA5_chars_per_7bits ((3))
 #define DNA5_bits_per_byte ((8))
@@ -53,6 +54,13 @@ unsigned int get_DNA_index_seq_size(unsigned int seqlen)
 //	return DNA5_ceildiv(seqlen,DNA5_chars_per_block)*DNA5_bytes_per_block;
 };
 
+// Size in bytes of the packed sequence itself, starting at the block aligned
+// pointer, i.e. without the alignment slack of get_DNA_index_seq_size
+unsigned int get_DNA_index_seq_payload_size(unsigned int seqlen)
+{
+	return get_DNA_index_seq_size(seqlen)-DNA5_bytes_per_block;
+};
+
 static inline void DNA5_set_7bits_at(unsigned int * indexed_seq,unsigned int pos,unsigned int val)
 {
 	unsigned int val_write;
@@ -142,7 +150,7 @@ unsigned int * new_basic_DNA5_seq(unsigned int seqlen,
 	unsigned int *_output_size)
 {
 	unsigned int alloc_size=get_DNA_index_seq_size(seqlen);
-	unsigned int * indexed_seq0=(unsigned int *)calloc(1,alloc_size);
+	unsigned int * indexed_seq0=(unsigned int *)mem_calloc(mem_index,alloc_size);
 	unsigned int * indexed_seq=round_to_next_block_boundary(indexed_seq0);
 	if(indexed_seq0==NULL)
 	{
@@ -150,6 +158,7 @@ unsigned int * new_basic_DNA5_seq(unsigned int seqlen,
 		return 0;
 	};
 	*(((unsigned int **)indexed_seq)-1)=indexed_seq0;
+	(*_output_size)=alloc_size;
 	return indexed_seq;
 };
 
@@ -160,7 +169,7 @@ unsigned int * build_basic_DNA5_seq(unsigned char * orig_seq,
 //	unsigned int nblocks=DNA5_ceildiv(seqlen,DNA5_chars_per_block);
 //	unsigned int alloc_size=nblocks*DNA5_bytes_per_block;
 	unsigned int alloc_size=get_DNA_index_seq_size(seqlen);
-	unsigned int * indexed_seq0=(unsigned int *)calloc(1,alloc_size);
+	unsigned int * indexed_seq0=(unsigned int *)mem_calloc(mem_index,alloc_size);
 	unsigned int * indexed_seq=round_to_next_block_boundary(indexed_seq0);
 	unsigned int i,j;
 	unsigned char packed_7bits;
@@ -227,10 +236,11 @@ unsigned int * build_basic_DNA5_seq(unsigned char * orig_seq,
 	return indexed_seq;
 };
 
-void free_basic_DNA5_seq(unsigned int * indexed_seq)
+// size is the one returned by new_basic_DNA5_seq or build_basic_DNA5_seq
+void free_basic_DNA5_seq(unsigned int * indexed_seq,unsigned int size)
 {
 	unsigned int * real_pointer=*(((unsigned int **)indexed_seq)-1);
-	free(real_pointer);
+	mem_free(mem_index,real_pointer,size);
 };
 
 #define subblock_size 32
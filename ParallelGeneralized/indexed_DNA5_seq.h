@@ -10,11 +10,12 @@ unsigned int * new_basic_DNA5_seq(unsigned int seqlen,
 void complete_basic_DNA5_seq(unsigned int * indexed_seq,unsigned int seqlen);
 unsigned int * build_basic_DNA5_seq(unsigned char * orig_seq,
 	unsigned int seqlen,unsigned int *_output_size,unsigned int * count);
-void free_basic_DNA5_seq(unsigned int * indexed_seq);
+void free_basic_DNA5_seq(unsigned int * indexed_seq,unsigned int size);
 inline void DNA5_set_char(unsigned int * indexed_seq,
 	unsigned int charpos,unsigned char char_val);
 void DNA5_get_char_pref_counts(unsigned int * count,unsigned int * indexed_seq,unsigned int pos);
 inline unsigned int get_DNA_index_seq_size(unsigned int seqlen);
+unsigned int get_DNA_index_seq_payload_size(unsigned int seqlen);
 inline void DNA5_set_triplet_at(unsigned int * indexed_seq,unsigned int pos,unsigned char * chars);
 void DNA5_pack_indexed_seq_from_text(unsigned char * orig_text,
 	unsigned int * indexed_seq,unsigned int textlen);
@@ -0,0 +1,390 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<sys/stat.h>
+#include"DNA5_Basic_BWT.h"
+#include"kernel_metrics.h"
+
+/*
+ Batch mode: compares many pairs of genomes in one process, building or
+ loading the index of every genome once and keeping as many indexes resident
+ as the memory budget allows.
+
+ The manifest has one entry per line ('#' starts a comment):
+	genome <name> <path>
+	job <name1> <name2> <metric>
+ where metric is maws, present, jaccard, lw, kernel or rws:<delta1>:<delta2>.
+ Every job is written to one TSV or JSON output, in manifest order.
+*/
+
+#define max_line_len 4096
+
+#define batch_format_tsv 0
+#define batch_format_json 1
+
+typedef struct
+{
+	char * name;
+	char * path;
+	Basic_BWT_t * BBWT;
+	// Bytes of the resident index, or the estimate made before loading it
+	size_t bytes;
+	unsigned long long last_use;
+} batch_genome_t;
+
+typedef struct
+{
+	unsigned int genome1;
+	unsigned int genome2;
+	kernel_metric_t metric;
+	unsigned int done;
+	int status;
+	kernel_result_t result;
+} batch_job_t;
+
+typedef struct
+{
+	unsigned int ngenomes;
+	unsigned int genomes_capacity;
+	batch_genome_t * genomes;
+	unsigned int njobs;
+	unsigned int jobs_capacity;
+	batch_job_t * jobs;
+	size_t budget;
+	size_t resident;
+	unsigned long long clock;
+	unsigned int RC;
+	unsigned int cores;
+	const char * cache_dir;
+	unsigned int shared;
+	unsigned int nloads;
+	unsigned int nevictions;
+} batch_t;
+
+static int find_genome(const batch_t * batch,const char * name)
+{
+	unsigned int i;
+	for(i=0;i<batch->ngenomes;i++)
+		if(strcmp(batch->genomes[i].name,name)==0)
+			return i;
+	return -1;
+};
+
+
+// Size of the index of a genome before it is loaded: the cached index file,
+// or the packed size of a text as long as the FASTA file (four times as long
+// if it is compressed)
+static size_t estimate_index_bytes(const batch_t * batch,const batch_genome_t * genome)
+{
+	struct stat st;
+	unsigned char magic[2]={0,0};
+	size_t len;
+	FILE * f;
+	char * path;
+	if(batch->cache_dir) {
+		path=kernel_index_path(genome->path,batch->RC,batch->cache_dir);
+		if(path && stat(path,&st)==0) {
+			free(path);
+			return st.st_size;
+		}
+		free(path);
+	}
+	if(stat(genome->path,&st)!=0)
+		return 0;
+	len=st.st_size;
+	if((f=fopen(genome->path,"rb"))) {
+		if(fread(magic,1,2,f)==2 && magic[0]==0x1f && magic[1]==0x8b)
+			len*=4;
+		fclose(f);
+	}
+	if(batch->RC)
+		len=2*len+2;
+	return get_DNA_index_seq_size(len+1);
+};
+
+static int read_manifest(const char * path,batch_t * batch)
+{
+	char line[max_line_len];
+	char kind[16],a[max_line_len],b[max_line_len],c[max_line_len];
+	unsigned int lineno=0;
+	int n,g1,g2;
+	FILE * f;
+	batch_genome_t * genome;
+	batch_job_t * job;
+	if((f=fopen(path,"r"))==NULL) {
+		fprintf(stderr," Error: Cannot open manifest %s!\n",path);
+		return -1;
+	}
+	while(fgets(line,max_line_len,f)) {
+		lineno++;
+		if((n=sscanf(line,"%15s %s %s %s",kind,a,b,c))<=0 || kind[0]=='#')
+			continue;
+		if(strcmp(kind,"genome")==0 && n==3) {
+			if(find_genome(batch,a)>=0 || strchr(a,'/')) {
+				fprintf(stderr," Error: %s:%u: duplicate or invalid genome name %s\n",path,lineno,a);
+				break;
+			}
+			if(batch->ngenomes==batch->genomes_capacity) {
+				batch->genomes_capacity=batch->genomes_capacity?2*batch->genomes_capacity:16;
+				batch->genomes=realloc(batch->genomes,batch->genomes_capacity*sizeof(batch_genome_t));
+			}
+			genome=&batch->genomes[batch->ngenomes++];
+			memset(genome,0,sizeof(batch_genome_t));
+			genome->name=strdup(a);
+			genome->path=strdup(b);
+		}
+		else if(strcmp(kind,"job")==0 && n==4) {
+			if((g1=find_genome(batch,a))<0 || (g2=find_genome(batch,b))<0) {
+				fprintf(stderr," Error: %s:%u: unknown genome in job\n",path,lineno);
+				break;
+			}
+			if(batch->njobs==batch->jobs_capacity) {
+				batch->jobs_capacity=batch->jobs_capacity?2*batch->jobs_capacity:64;
+				batch->jobs=realloc(batch->jobs,batch->jobs_capacity*sizeof(batch_job_t));
+			}
+			job=&batch->jobs[batch->njobs];
+			memset(job,0,sizeof(batch_job_t));
+			job->genome1=g1;
+			job->genome2=g2;
+			if(kernel_parse_metric(c,&job->metric)!=0) {
+				fprintf(stderr," Error: %s:%u: unknown metric %s\n",path,lineno,c);
+				break;
+			}
+			batch->njobs++;
+		}
+		else {
+			fprintf(stderr," Error: %s:%u: invalid manifest line\n",path,lineno);
+			break;
+		}
+	}
+	if(!feof(f)) {
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	return 0;
+};
+
+static void evict_genome(batch_t * batch,batch_genome_t * genome)
+{
+	free_Basic_BWT(genome->BBWT);
+	genome->BBWT=NULL;
+	batch->resident-=genome->bytes;
+	batch->nevictions++;
+};
+
+// Evict the least recently used indexes, except those of the current job,
+// until bytes more fit in the budget
+static void make_room(batch_t * batch,size_t bytes,const batch_job_t * job)
+{
+	unsigned int i;
+	batch_genome_t * lru;
+	while(batch->resident+bytes>batch->budget) {
+		lru=NULL;
+		for(i=0;i<batch->ngenomes;i++)
+			if(batch->genomes[i].BBWT && i!=job->genome1 && i!=job->genome2 &&
+					(lru==NULL || batch->genomes[i].last_use<lru->last_use))
+				lru=&batch->genomes[i];
+		if(lru==NULL)
+			return;
+		evict_genome(batch,lru);
+	}
+};
+
+// Load the index of a genome from the cache directory, or build it from the
+// FASTA file (and save it in the cache directory)
+static int load_genome(batch_t * batch,batch_genome_t * genome)
+{
+	char * path=NULL;
+	if(batch->cache_dir && (path=kernel_index_path(genome->path,batch->RC,batch->cache_dir))==NULL)
+		return -1;
+	if(batch->shared)
+		genome->BBWT=kernel_share_index(genome->path,batch->RC,path);
+	else
+		genome->BBWT=kernel_build_index(genome->path,batch->RC,path);
+	free(path);
+	if(genome->BBWT==NULL)
+		return -1;
+	genome->bytes=genome->BBWT->size;
+	batch->resident+=genome->bytes;
+	batch->nloads++;
+	return 0;
+};
+
+static int acquire_genome(batch_t * batch,unsigned int g,const batch_job_t * job)
+{
+	batch_genome_t * genome=&batch->genomes[g];
+	genome->last_use=++batch->clock;
+	if(genome->BBWT)
+		return 0;
+	make_room(batch,estimate_index_bytes(batch,genome),job);
+	return load_genome(batch,genome);
+};
+
+// Next job to run: the pending job with the most indexes already resident,
+// the earliest in the manifest among those
+static batch_job_t * next_job(batch_t * batch)
+{
+	unsigned int i,resident;
+	int best_resident=-1;
+	batch_job_t * best=NULL;
+	batch_job_t * job;
+	for(i=0;i<batch->njobs;i++) {
+		job=&batch->jobs[i];
+		if(job->done)
+			continue;
+		resident=(batch->genomes[job->genome1].BBWT!=NULL)+
+				(job->genome2!=job->genome1 && batch->genomes[job->genome2].BBWT!=NULL);
+		if(job->genome2==job->genome1)
+			resident*=2;
+		if((int)resident>best_resident) {
+			best_resident=resident;
+			best=job;
+			if(resident==2)
+				break;
+		}
+	}
+	return best;
+};
+
+static void run_job(batch_t * batch,batch_job_t * job)
+{
+	job->done=1;
+	if(acquire_genome(batch,job->genome1,job)!=0 || acquire_genome(batch,job->genome2,job)!=0) {
+		job->status=-1;
+		return;
+	}
+	kernel_compute(batch->genomes[job->genome1].BBWT,batch->genomes[job->genome2].BBWT,
+			&job->metric,batch->cores,&job->result);
+};
+
+static void write_results(const batch_t * batch,unsigned int format,FILE * out)
+{
+	unsigned int i;
+	const batch_job_t * job;
+	const kernel_result_t * result;
+	char metric[kernel_metric_name_len];
+	if(format==batch_format_tsv)
+		fprintf(out,"genome1\tgenome2\tmetric\tstatus\tvalue\tcommon\tn1\tn2\tseconds\n");
+	else
+		fprintf(out,"{\"loads\": %u, \"evictions\": %u, \"jobs\": [",batch->nloads,batch->nevictions);
+	for(i=0;i<batch->njobs;i++) {
+		job=&batch->jobs[i];
+		result=&job->result;
+		kernel_metric_name(&job->metric,metric);
+		if(format==batch_format_tsv)
+			fprintf(out,"%s\t%s\t%s\t%s\t%f\t%u\t%u\t%u\t%f\n",batch->genomes[job->genome1].name,
+					batch->genomes[job->genome2].name,metric,job->status?"error":"ok",
+					result->value,result->common,result->nMAWs1,result->nMAWs2,result->seconds);
+		else
+			fprintf(out,"%s\n {\"genome1\": \"%s\", \"genome2\": \"%s\", \"metric\": \"%s\", \"status\": \"%s\", "
+					"\"value\": %f, \"common\": %u, \"n1\": %u, \"n2\": %u, \"seconds\": %f}",i?",":"",
+					batch->genomes[job->genome1].name,batch->genomes[job->genome2].name,metric,
+					job->status?"error":"ok",result->value,result->common,result->nMAWs1,result->nMAWs2,result->seconds);
+	}
+	if(format==batch_format_json)
+		fprintf(out,"\n]}\n");
+};
+
+static void free_batch(batch_t * batch)
+{
+	unsigned int i;
+	for(i=0;i<batch->ngenomes;i++) {
+		if(batch->genomes[i].BBWT)
+			free_Basic_BWT(batch->genomes[i].BBWT);
+		free(batch->genomes[i].name);
+		free(batch->genomes[i].path);
+	}
+	free(batch->genomes);
+	free(batch->jobs);
+};
+
+int main(int argc, char **argv) {
+								/*options: -m MB) memory budget for the resident indexes (default 1024)
+										   -t cores) number of cores
+										   -r) index the genomes followed by their reverse complement
+										   -d dir) cache directory: load the indexes saved there, save
+											the ones built from FASTA files. The indexes are keyed
+											on the absolute path, size and time of modification of
+											the FASTA files
+										   -s) with -d, attach the indexes of the cache directory
+											read-only instead of loading private copies: concurrent
+											processes share one copy of every index, and wait for
+											the first of them to publish the indexes it builds
+										   -f tsv|json) output format (default tsv)
+										   -o file) output file (default batch_results.tsv or .json, - for
+											the standard output)
+								  argv: 1) manifest
+										*/
+	batch_t batch;
+	batch_job_t * job;
+	unsigned int format=batch_format_tsv;
+	const char * out_path=NULL;
+	FILE * out=stdout;
+	int opt;
+	int usage=0;
+	int res=0;
+	memset(&batch,0,sizeof(batch_t));
+	batch.budget=(size_t)1024<<20;
+	batch.cores=1;
+	while(!usage && (opt=getopt(argc,argv,"m:t:rd:sf:o:"))!=-1) {
+		switch(opt) {
+		case 'm':
+			batch.budget=(size_t)atol(optarg)<<20;
+			break;
+		case 't':
+			batch.cores=atoi(optarg);
+			break;
+		case 'r':
+			batch.RC=1;
+			break;
+		case 'd':
+			batch.cache_dir=optarg;
+			break;
+		case 's':
+			batch.shared=1;
+			break;
+		case 'f':
+			if(strcmp(optarg,"tsv")==0)
+				format=batch_format_tsv;
+			else if(strcmp(optarg,"json")==0)
+				format=batch_format_json;
+			else {
+				fprintf(stderr," Error: invalid output format: %s\n",optarg);
+				return ( 1 );
+			}
+			break;
+		case 'o':
+			out_path=optarg;
+			break;
+		default:
+			usage=1;
+		}
+	}
+	if(usage || optind!=argc-1 || batch.cores==0 || (batch.shared && batch.cache_dir==NULL)) {
+		fprintf(stderr," Usage: %s [-m MB] [-t cores] [-r] [-d cache_dir [-s]] [-f tsv|json] [-o output] manifest\n",argv[0]);
+		return ( 1 );
+	}
+	if(read_manifest(argv[optind],&batch)!=0) {
+		free_batch(&batch);
+		return ( 1 );
+	}
+	while((job=next_job(&batch)))
+		run_job(&batch,job);
+	if(out_path==NULL)
+		out_path=format==batch_format_tsv?"batch_results.tsv":"batch_results.json";
+	if(strcmp(out_path,"-")!=0 && (out=fopen(out_path,"w"))==NULL) {
+		fprintf(stderr," Error: Cannot open output file %s!\n",out_path);
+		free_batch(&batch);
+		return ( 1 );
+	}
+	write_results(&batch,format,out);
+	if(out!=stdout)
+		fclose(out);
+	for(job=batch.jobs;job<batch.jobs+batch.njobs;job++)
+		if(job->status)
+			res=1;
+	free_batch(&batch);
+	return res;
+}
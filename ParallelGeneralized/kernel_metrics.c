@@ -0,0 +1,226 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/file.h>
+#include<sys/stat.h>
+#include<sys/time.h>
+#include"kernel_metrics.h"
+#include"SLT_MAWs.h"
+#include"fasta_loader.h"
+#include"phase_log.h"
+
+#define min_MAW_len 2
+
+static double gettime( void )
+{
+	struct timeval ttime;
+	gettimeofday( &ttime , 0 );
+	return ttime.tv_sec + ttime.tv_usec * 0.000001;
+};
+
+// Parse maws, present, jaccard, lw, kernel or rws:<delta1>:<delta2>
+int kernel_parse_metric(const char * spec,kernel_metric_t * metric)
+{
+	metric->delta1=metric->delta2=0;
+	if(strcmp(spec,"maws")==0)
+		metric->metric=kernel_metric_maws;
+	else if(strcmp(spec,"present")==0)
+		metric->metric=kernel_metric_present;
+	else if(strcmp(spec,"jaccard")==0)
+		metric->metric=kernel_metric_jaccard;
+	else if(strcmp(spec,"lw")==0)
+		metric->metric=kernel_metric_lw;
+	else if(strcmp(spec,"kernel")==0)
+		metric->metric=kernel_metric_kernel;
+	else if(sscanf(spec,"rws:%u:%u",&metric->delta1,&metric->delta2)==2)
+		metric->metric=kernel_metric_rws;
+	else
+		return -1;
+	return 0;
+};
+
+// Parse a comma separated list of at most max numbers, the options of the
+// benchmarks
+int kernel_parse_list(const char * spec,unsigned int * values,unsigned int max,unsigned int * n)
+{
+	char * end;
+	*n=0;
+	while(*spec && *n<max) {
+		values[(*n)++]=strtoul(spec,&end,10);
+		if(end==spec || (*end && *end!=','))
+			return -1;
+		spec=*end?end+1:end;
+	}
+	return *spec?-1:0;
+};
+
+// name must hold kernel_metric_name_len characters
+void kernel_metric_name(const kernel_metric_t * metric,char * name)
+{
+	switch(metric->metric) {
+	case kernel_metric_maws: strcpy(name,"maws"); break;
+	case kernel_metric_rws: sprintf(name,"rws:%u:%u",metric->delta1,metric->delta2); break;
+	case kernel_metric_present: strcpy(name,"present"); break;
+	case kernel_metric_jaccard: strcpy(name,"jaccard"); break;
+	case kernel_metric_lw: strcpy(name,"lw"); break;
+	default: strcpy(name,"kernel");
+	}
+};
+
+void kernel_compute(Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,const kernel_metric_t * metric,
+		unsigned int cores,kernel_result_t * result)
+{
+	double t=gettime();
+	memset(result,0,sizeof(kernel_result_t));
+	if(metric->metric==kernel_metric_rws)
+		result->common=SLT_find_RWs(BBWT1,BBWT2,min_MAW_len,&result->nMAWs1,&result->nMAWs2,&result->value,
+				0,cores,metric->metric,metric->delta1,metric->delta2,NULL);
+	else
+		result->common=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&result->nMAWs1,&result->nMAWs2,&result->value,
+				0,cores,metric->metric,NULL);
+	switch(metric->metric) {
+	case kernel_metric_maws:
+	case kernel_metric_rws:
+	case kernel_metric_present:
+		result->value=result->common;
+		break;
+	case kernel_metric_jaccard:
+		result->value=(double)result->common/(result->nMAWs1+result->nMAWs2-result->common);
+		break;
+	}
+	result->seconds=gettime()-t;
+};
+
+// kernel_compute of query against every reference, from one traversal of
+// the query. seconds is the time of the whole traversal.
+void kernel_compute_multi(Basic_BWT_t * query,Basic_BWT_t ** refs,unsigned int nrefs,
+		const kernel_metric_t * metric,unsigned int cores,kernel_result_t * results)
+{
+	unsigned int * counts=malloc(3*nrefs*sizeof(unsigned int));
+	double * values=malloc(nrefs*sizeof(double));
+	double t=gettime();
+	unsigned int r;
+	SLT_find_MAWs_multi(query,refs,nrefs,min_MAW_len,cores,metric->metric,metric->delta1,metric->delta2,
+			counts,counts+nrefs,counts+2*nrefs,values);
+	t=gettime()-t;
+	for(r=0;r<nrefs;r++) {
+		results[r].common=counts[r];
+		results[r].nMAWs1=counts[nrefs+r];
+		results[r].nMAWs2=counts[2*nrefs+r];
+		results[r].seconds=t;
+		switch(metric->metric) {
+		case kernel_metric_jaccard:
+			results[r].value=(double)counts[r]/(counts[nrefs+r]+counts[2*nrefs+r]-counts[r]);
+			break;
+		case kernel_metric_lw:
+		case kernel_metric_kernel:
+			results[r].value=values[r];
+			break;
+		default:
+			results[r].value=counts[r];
+		}
+	}
+	free(counts);
+	free(values);
+};
+
+// Index of a FASTA file, followed by its reverse complement if RC. With an
+// index_path the index is loaded from there if possible, and saved there
+// after it is built otherwise. Returns NULL on error.
+Basic_BWT_t * kernel_build_index(const char * fasta_path,unsigned int RC,const char * index_path)
+{
+	Basic_BWT_t * BBWT;
+	unsigned char * text;
+	unsigned int textlen;
+	int res;
+	if(index_path && (BBWT=Basic_BWT_load(index_path)))
+		return BBWT;
+	phase_begin("parse");
+	res=load_fasta(fasta_path,RC?FASTA_load_RC:FASTA_load_plain,&text,&textlen);
+	phase_end();
+	if(res!=0) {
+		fprintf(stderr," Error: Cannot read %s (error %d)!\n",fasta_path,res);
+		return NULL;
+	}
+	if(textlen==0) {
+		fprintf(stderr," Error: %s has no sequence!\n",fasta_path);
+		free(text);
+		return NULL;
+	}
+	BBWT=Build_BWT_index_from_text(text,textlen,Basic_bwt_free_text);
+	free(text);
+	if(BBWT==NULL) {
+		fprintf(stderr," Error: Cannot build the index of %s!\n",fasta_path);
+		return NULL;
+	}
+	if(index_path && Basic_BWT_save(BBWT,index_path)!=0)
+		fprintf(stderr," Warning: Cannot save the index of %s to %s\n",fasta_path,index_path);
+	return BBWT;
+};
+
+// FNV-1a hash of n bytes, continuing from h
+static unsigned long long hash_bytes(unsigned long long h,const void * bytes,size_t n)
+{
+	const unsigned char * b=(const unsigned char *)bytes;
+	while(n--)
+		h=(h^*b++)*1099511628211ULL;
+	return h;
+};
+
+// Path of the index of a FASTA file in the cache directory dir, as
+// <dir>/<file name>.<key>[.rc].dna5bwt. The key hashes the absolute path,
+// the size and the modification time of the file, so that files of the
+// same name never share an index, and a modified file gets a new one.
+// Returns NULL if the file cannot be read.
+char * kernel_index_path(const char * fasta_path,unsigned int RC,const char * dir)
+{
+	const char * name=strrchr(fasta_path,'/');
+	char * full_path;
+	char * index_path;
+	struct stat st;
+	unsigned long long key=14695981039346656037ULL;
+	if(stat(fasta_path,&st)!=0 || (full_path=realpath(fasta_path,NULL))==NULL) {
+		fprintf(stderr," Error: Cannot read %s!\n",fasta_path);
+		return NULL;
+	}
+	key=hash_bytes(key,full_path,strlen(full_path));
+	key=hash_bytes(key,&st.st_size,sizeof(st.st_size));
+	key=hash_bytes(key,&st.st_mtime,sizeof(st.st_mtime));
+	free(full_path);
+	name=name?name+1:fasta_path;
+	index_path=malloc(strlen(dir)+strlen(name)+40);
+	sprintf(index_path,"%s/%s.%016llx%s.dna5bwt",dir,name,key,RC?".rc":"");
+	return index_path;
+};
+
+// Index of a FASTA file shared with the other processes through index_path:
+// attached read-only if it was published there, built and published there
+// otherwise. A lock file next to the index makes concurrent callers wait
+// for the first one to publish it rather than build their own. If the index
+// cannot be published, the private index that was built is returned.
+Basic_BWT_t * kernel_share_index(const char * fasta_path,unsigned int RC,const char * index_path)
+{
+	Basic_BWT_t * BBWT;
+	Basic_BWT_t * built;
+	char * lock_path=malloc(strlen(index_path)+8);
+	int fd;
+	sprintf(lock_path,"%s.lock",index_path);
+	if((fd=open(lock_path,O_RDWR|O_CREAT,0666))>=0)
+		flock(fd,LOCK_EX);
+	free(lock_path);
+	if((BBWT=Basic_BWT_attach(index_path))==NULL && (built=kernel_build_index(fasta_path,RC,NULL))) {
+		if(Basic_BWT_save(built,index_path)==0 && (BBWT=Basic_BWT_attach(index_path)))
+			free_Basic_BWT(built);
+		else {
+			fprintf(stderr," Warning: Cannot publish the index of %s to %s\n",fasta_path,index_path);
+			BBWT=built;
+		}
+	}
+	if(fd>=0) {
+		flock(fd,LOCK_UN);
+		close(fd);
+	}
+	return BBWT;
+};
@@ -0,0 +1,46 @@
+#ifndef kernel_metrics_h
+#define kernel_metrics_h
+#include"DNA5_Basic_BWT.h"
+
+// Pairwise metrics of the batch and server modes, numbered as the result
+// codes of test_SLT_MAWs
+#define kernel_metric_maws 1
+#define kernel_metric_rws 2
+#define kernel_metric_present 3
+#define kernel_metric_jaccard 4
+#define kernel_metric_lw 5
+#define kernel_metric_kernel 6
+
+#define kernel_metric_name_len 64
+
+typedef struct
+{
+	unsigned int metric;
+	// Frequency thresholds of kernel_metric_rws
+	unsigned int delta1;
+	unsigned int delta2;
+} kernel_metric_t;
+
+// value is the metric itself: a count for maws, rws and present, the
+// Jaccard similarity, the LW distance or the Markovian kernel
+typedef struct
+{
+	double value;
+	unsigned int common;
+	unsigned int nMAWs1;
+	unsigned int nMAWs2;
+	double seconds;
+} kernel_result_t;
+
+int kernel_parse_metric(const char * spec,kernel_metric_t * metric);
+int kernel_parse_list(const char * spec,unsigned int * values,unsigned int max,unsigned int * n);
+void kernel_metric_name(const kernel_metric_t * metric,char * name);
+void kernel_compute(Basic_BWT_t * BBWT1,Basic_BWT_t * BBWT2,const kernel_metric_t * metric,
+		unsigned int cores,kernel_result_t * result);
+void kernel_compute_multi(Basic_BWT_t * query,Basic_BWT_t ** refs,unsigned int nrefs,
+		const kernel_metric_t * metric,unsigned int cores,kernel_result_t * results);
+Basic_BWT_t * kernel_build_index(const char * fasta_path,unsigned int RC,const char * index_path);
+Basic_BWT_t * kernel_share_index(const char * fasta_path,unsigned int RC,const char * index_path);
+char * kernel_index_path(const char * fasta_path,unsigned int RC,const char * dir);
+
+#endif
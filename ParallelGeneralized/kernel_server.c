@@ -0,0 +1,350 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<signal.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include"DNA5_Basic_BWT.h"
+#include"kernel_metrics.h"
+#include"fasta_loader.h"
+
+/*
+ Server mode: keeps the indexes of a set of reference genomes resident and
+ answers requests on a Unix domain socket, so that a query costs only the
+ indexing of the query and one traversal of it against all the requested
+ references (SLT_multi).
+
+ Requests and replies are lines of text. A reply is either one line starting
+ with "ok" or "error", or the result lines followed by a line "end".
+	load <name> <path>          index a reference       -> ok <name> <bytes>
+	unload <name>               drop a reference        -> ok
+	list                        <name> <textlen> <bytes> per reference, end
+	query <metric> <source> <references>
+	                            <reference> <metric> <value> <common> <n1> <n2> <seconds>
+	                            per reference, end
+	shutdown                    stop the server         -> ok
+ The source of a query is path:<FASTA file> or seq:<sequence>, the
+ references are a comma separated list of names or * for all of them, and
+ the metric is one of kernel_parse_metric. Fields are tab separated.
+*/
+
+typedef struct
+{
+	char * name;
+	char * path;
+	Basic_BWT_t * BBWT;
+} server_reference_t;
+
+typedef struct
+{
+	unsigned int nreferences;
+	unsigned int references_capacity;
+	server_reference_t * references;
+	unsigned int RC;
+	unsigned int cores;
+	const char * cache_dir;
+	unsigned int shared;
+	unsigned int shutdown;
+} server_t;
+
+static int find_reference(const server_t * server,const char * name)
+{
+	unsigned int i;
+	for(i=0;i<server->nreferences;i++)
+		if(strcmp(server->references[i].name,name)==0)
+			return i;
+	return -1;
+};
+
+static int add_reference(server_t * server,const char * name,const char * path)
+{
+	server_reference_t * reference;
+	char * index_path=NULL;
+	Basic_BWT_t * BBWT;
+	if(find_reference(server,name)>=0 || strchr(name,'/'))
+		return -1;
+	if(server->cache_dir && (index_path=kernel_index_path(path,server->RC,server->cache_dir))==NULL)
+		return -1;
+	if(server->shared)
+		BBWT=kernel_share_index(path,server->RC,index_path);
+	else
+		BBWT=kernel_build_index(path,server->RC,index_path);
+	free(index_path);
+	if(BBWT==NULL)
+		return -1;
+	if(server->nreferences==server->references_capacity) {
+		server->references_capacity=server->references_capacity?2*server->references_capacity:16;
+		server->references=realloc(server->references,server->references_capacity*sizeof(server_reference_t));
+	}
+	reference=&server->references[server->nreferences++];
+	reference->name=strdup(name);
+	reference->path=strdup(path);
+	reference->BBWT=BBWT;
+	return 0;
+};
+
+static void remove_reference(server_t * server,unsigned int r)
+{
+	free_Basic_BWT(server->references[r].BBWT);
+	free(server->references[r].name);
+	free(server->references[r].path);
+	server->references[r]=server->references[--server->nreferences];
+};
+
+// Index of a sequence sent inline, cleaned as a FASTA record
+static Basic_BWT_t * index_sequence(const server_t * server,const char * seq)
+{
+	fasta_parser_t parser;
+	unsigned char * text;
+	unsigned int textlen;
+	Basic_BWT_t * BBWT;
+	fasta_parser_init(&parser,strlen(seq),server->RC?FASTA_load_RC:FASTA_load_plain);
+	if(fasta_parser_feed(&parser,(const unsigned char *)">query\n",7)!=0 ||
+			fasta_parser_feed(&parser,(const unsigned char *)seq,strlen(seq))!=0 ||
+			fasta_parser_finish(&parser,&text,&textlen)!=0) {
+		fasta_parser_free(&parser);
+		return NULL;
+	}
+	fasta_parser_free(&parser);
+	if(textlen==0) {
+		free(text);
+		return NULL;
+	}
+	BBWT=Build_BWT_index_from_text(text,textlen,Basic_bwt_free_text);
+	free(text);
+	return BBWT;
+};
+
+static void query(server_t * server,char * metric_spec,char * source,char * names,FILE * out)
+{
+	kernel_metric_t metric;
+	kernel_result_t * results;
+	Basic_BWT_t * BBWT;
+	Basic_BWT_t ** BBWTs;
+	char metric_name[kernel_metric_name_len];
+	char * name;
+	char * saveptr;
+	unsigned int * refs;
+	unsigned int nrefs=0;
+	unsigned int nnames;
+	unsigned int i;
+	int r;
+	if(kernel_parse_metric(metric_spec,&metric)!=0) {
+		fprintf(out,"error unknown metric %s\n",metric_spec);
+		return;
+	}
+	// Resolve the references before indexing the query. A name may be
+	// listed more than once: one slot per name, at most one per comma.
+	nnames=1;
+	for(i=0;names[i];i++)
+		nnames+=names[i]==',';
+	if(strcmp(names,"*")==0)
+		nnames=server->nreferences;
+	refs=malloc((nnames+1)*sizeof(unsigned int));
+	if(strcmp(names,"*")==0)
+		for(;nrefs<server->nreferences;nrefs++)
+			refs[nrefs]=nrefs;
+	else
+		for(name=strtok_r(names,",",&saveptr);name;name=strtok_r(NULL,",",&saveptr)) {
+			if((r=find_reference(server,name))<0) {
+				fprintf(out,"error unknown reference %s\n",name);
+				free(refs);
+				return;
+			}
+			refs[nrefs++]=r;
+		}
+	if(strncmp(source,"path:",5)==0)
+		BBWT=kernel_build_index(source+5,server->RC,NULL);
+	else if(strncmp(source,"seq:",4)==0)
+		BBWT=index_sequence(server,source+4);
+	else {
+		fprintf(out,"error the source must be path:<file> or seq:<sequence>\n");
+		free(refs);
+		return;
+	}
+	if(BBWT==NULL) {
+		fprintf(out,"error cannot index the query\n");
+		free(refs);
+		return;
+	}
+	// All the references from one traversal of the query
+	BBWTs=malloc((nrefs+1)*sizeof(Basic_BWT_t *));
+	results=malloc((nrefs+1)*sizeof(kernel_result_t));
+	for(i=0;i<nrefs;i++)
+		BBWTs[i]=server->references[refs[i]].BBWT;
+	kernel_compute_multi(BBWT,BBWTs,nrefs,&metric,server->cores,results);
+	kernel_metric_name(&metric,metric_name);
+	for(i=0;i<nrefs;i++)
+		fprintf(out,"%s\t%s\t%f\t%u\t%u\t%u\t%f\n",server->references[refs[i]].name,metric_name,
+				results[i].value,results[i].common,results[i].nMAWs1,results[i].nMAWs2,results[i].seconds);
+	free(BBWTs);
+	free(results);
+	fprintf(out,"end\n");
+	free_Basic_BWT(BBWT);
+	free(refs);
+};
+
+static void handle_request(server_t * server,char * line,FILE * out)
+{
+	char * args[4];
+	char * saveptr;
+	unsigned int nargs=0;
+	unsigned int i;
+	int r;
+	line[strcspn(line,"\r\n")]=0;
+	while(nargs<4 && (args[nargs]=strtok_r(nargs?NULL:line," \t",&saveptr)))
+		nargs++;
+	if(nargs==0)
+		return;
+	if(strcmp(args[0],"load")==0 && nargs==3) {
+		if(add_reference(server,args[1],args[2])!=0)
+			fprintf(out,"error cannot load %s\n",args[1]);
+		else
+			fprintf(out,"ok %s %u\n",args[1],server->references[server->nreferences-1].BBWT->size);
+	}
+	else if(strcmp(args[0],"unload")==0 && nargs==2) {
+		if((r=find_reference(server,args[1]))<0)
+			fprintf(out,"error unknown reference %s\n",args[1]);
+		else {
+			remove_reference(server,r);
+			fprintf(out,"ok\n");
+		}
+	}
+	else if(strcmp(args[0],"list")==0 && nargs==1) {
+		for(i=0;i<server->nreferences;i++)
+			fprintf(out,"%s\t%u\t%u\n",server->references[i].name,
+					server->references[i].BBWT->textlen,server->references[i].BBWT->size);
+		fprintf(out,"end\n");
+	}
+	else if(strcmp(args[0],"query")==0 && nargs==4)
+		query(server,args[1],args[2],args[3],out);
+	else if(strcmp(args[0],"shutdown")==0 && nargs==1) {
+		server->shutdown=1;
+		fprintf(out,"ok\n");
+	}
+	else
+		fprintf(out,"error invalid request\n");
+};
+
+// Serve the requests of one client until it disconnects
+static void serve_client(server_t * server,int fd)
+{
+	FILE * in=fdopen(fd,"r");
+	FILE * out=fdopen(dup(fd),"w");
+	char * line=NULL;
+	size_t capacity=0;
+	if(in==NULL || out==NULL) {
+		if(in)
+			fclose(in);
+		else
+			close(fd);
+		if(out)
+			fclose(out);
+		return;
+	}
+	while(!server->shutdown && getline(&line,&capacity,in)>0) {
+		handle_request(server,line,out);
+		fflush(out);
+	}
+	free(line);
+	fclose(in);
+	fclose(out);
+};
+
+static int read_references(server_t * server,const char * path)
+{
+	char line[4096],kind[16],name[4096],genome_path[4096];
+	int n;
+	FILE * f;
+	if((f=fopen(path,"r"))==NULL) {
+		fprintf(stderr," Error: Cannot open manifest %s!\n",path);
+		return -1;
+	}
+	while(fgets(line,sizeof(line),f)) {
+		if((n=sscanf(line,"%15s %s %s",kind,name,genome_path))<=0 || kind[0]=='#' || strcmp(kind,"job")==0)
+			continue;
+		if(strcmp(kind,"genome")!=0 || n!=3 || add_reference(server,name,genome_path)!=0) {
+			fprintf(stderr," Error: Cannot load the reference on line: %s",line);
+			fclose(f);
+			return -1;
+		}
+	}
+	fclose(f);
+	return 0;
+};
+
+int main(int argc, char **argv) {
+								/*options: -t cores) number of cores of each traversal
+										   -r) index the genomes followed by their reverse complement
+										   -d dir) cache directory of the reference indexes (see kernel_batch)
+										   -s) with -d, attach the indexes of the cache directory
+											read-only, shared with the other processes (see kernel_batch)
+										   -g manifest) load the genome lines of a kernel_batch manifest
+											as references
+								  argv: 1) socket path
+										*/
+	server_t server;
+	struct sockaddr_un addr;
+	const char * manifest=NULL;
+	int opt,usage=0;
+	int listen_fd,fd;
+	unsigned int i;
+	memset(&server,0,sizeof(server_t));
+	server.cores=1;
+	while(!usage && (opt=getopt(argc,argv,"t:rd:sg:"))!=-1) {
+		switch(opt) {
+		case 't':
+			server.cores=atoi(optarg);
+			break;
+		case 'r':
+			server.RC=1;
+			break;
+		case 'd':
+			server.cache_dir=optarg;
+			break;
+		case 's':
+			server.shared=1;
+			break;
+		case 'g':
+			manifest=optarg;
+			break;
+		default:
+			usage=1;
+		}
+	}
+	if(usage || optind!=argc-1 || server.cores==0 || strlen(argv[optind])>=sizeof(addr.sun_path) ||
+			(server.shared && server.cache_dir==NULL)) {
+		fprintf(stderr," Usage: %s [-t cores] [-r] [-d cache_dir [-s]] [-g manifest] socket\n",argv[0]);
+		return ( 1 );
+	}
+	if(manifest && read_references(&server,manifest)!=0)
+		return ( 1 );
+	signal(SIGPIPE,SIG_IGN);
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	strcpy(addr.sun_path,argv[optind]);
+	unlink(addr.sun_path);
+	if((listen_fd=socket(AF_UNIX,SOCK_STREAM,0))<0 ||
+			bind(listen_fd,(struct sockaddr *)&addr,sizeof(addr))!=0 || listen(listen_fd,16)!=0) {
+		perror(" Error: Cannot listen on the socket");
+		return ( 1 );
+	}
+	fprintf(stderr,"Serving %u references on %s\n",server.nreferences,addr.sun_path);
+	// One client at a time: every traversal uses all the cores of the
+	// OpenMP thread pool, which lives as long as the server
+	while(!server.shutdown) {
+		if((fd=accept(listen_fd,NULL,NULL))<0)
+			continue;
+		serve_client(&server,fd);
+	}
+	close(listen_fd);
+	unlink(addr.sun_path);
+	for(i=0;i<server.nreferences;i++) {
+		free_Basic_BWT(server.references[i].BBWT);
+		free(server.references[i].name);
+		free(server.references[i].path);
+	}
+	free(server.references);
+	return 0;
+}
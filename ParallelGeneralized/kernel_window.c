@@ -0,0 +1,210 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include"DNA5_Basic_BWT.h"
+#include"kernel_metrics.h"
+#include"fasta_loader.h"
+
+/*
+ Window mode: profile of a metric along a query genome against one
+ reference. The query is cut into windows of a given size and step (the
+ last one ends at the end of the query) and every window is compared with
+ the reference.
+
+ The reference index is built or loaded once. The windows are indexed in
+ groups, and every group is compared with one joint traversal of the
+ reference (kernel_compute_multi), with the reference as the query of the
+ traversal and the windows as its references. The values are those of
+ test_SLT_MAWs with the reference as the first text and the window as the
+ second: maws, jaccard, lw and kernel are symmetric, while present counts
+ the MAWs of the reference that occur in the window and rws:d1:d2 applies
+ d1 to the reference and d2 to the window.
+
+ The profile has one line per window: its start and end in the query, the
+ metric and its value, the words counted by the metric (the MAWs or rare
+ words common to both texts, or the MAWs of the reference present in the
+ window), and the MAWs or rare words of the reference (n_ref) and of the
+ window (n_window).
+*/
+
+#define default_window_size 10000
+#define default_window_group 64
+
+typedef struct
+{
+	unsigned int start;
+	unsigned int end;
+	kernel_result_t result;
+} window_t;
+
+// Text of the window [start,end), followed by 'Z', its reverse complement
+// and another 'Z' if RC, and by the 0 byte dbwt expects past the text
+static unsigned char * window_text(const unsigned char * text,unsigned int start,unsigned int end,
+		unsigned int RC,unsigned int * textlen)
+{
+	unsigned int len=end-start;
+	unsigned char * wtext=malloc(2*len+3);
+	unsigned char * out=wtext;
+	memcpy(out,text+start,len);
+	out+=len;
+	if(RC) {
+		*out++='Z';
+		fasta_reverse_complement(text+start,len,out);
+		out+=len;
+		*out++='Z';
+	}
+	*textlen=out-wtext;
+	*out=0;
+	return wtext;
+};
+
+// Compare n windows with the reference. Returns -1 if a window cannot be
+// indexed.
+static int run_window_group(Basic_BWT_t * ref,const unsigned char * text,window_t * windows,
+		unsigned int n,const kernel_metric_t * metric,unsigned int RC,unsigned int cores)
+{
+	Basic_BWT_t ** BBWTs=calloc(n,sizeof(Basic_BWT_t *));
+	kernel_result_t * results=malloc(n*sizeof(kernel_result_t));
+	unsigned char * wtext;
+	unsigned int i,textlen;
+	int res=0;
+	// dbwt keeps its state in globals, the windows are indexed one at a time
+	for(i=0;i<n && res==0;i++) {
+		wtext=window_text(text,windows[i].start,windows[i].end,RC,&textlen);
+		if((BBWTs[i]=Build_BWT_index_from_text(wtext,textlen,Basic_bwt_free_text))==NULL)
+			res=-1;
+		free(wtext);
+	}
+	if(res==0) {
+		kernel_compute_multi(ref,BBWTs,n,metric,cores,results);
+		for(i=0;i<n;i++)
+			windows[i].result=results[i];
+	}
+	for(i=0;i<n;i++)
+		if(BBWTs[i])
+			free_Basic_BWT(BBWTs[i]);
+	free(BBWTs);
+	free(results);
+	return res;
+};
+
+static void write_profile(const window_t * windows,unsigned int nwindows,
+		const kernel_metric_t * metric,FILE * out)
+{
+	unsigned int i;
+	char name[kernel_metric_name_len];
+	kernel_metric_name(metric,name);
+	fprintf(out,"start\tend\tmetric\tvalue\tcommon\tn_ref\tn_window\n");
+	for(i=0;i<nwindows;i++)
+		fprintf(out,"%u\t%u\t%s\t%f\t%u\t%u\t%u\n",windows[i].start,windows[i].end,name,
+				windows[i].result.value,windows[i].result.common,windows[i].result.nMAWs1,
+				windows[i].result.nMAWs2);
+};
+
+int main(int argc, char **argv) {
+								/*options: -w size) window size (default 10000)
+										   -s step) window step (default the window size)
+										   -m metric) maws, present, jaccard, lw, kernel (default)
+											or rws:<delta1>:<delta2>, with the reference as the
+											first text of present and delta1
+										   -t cores) number of cores
+										   -r) index the reference and the windows followed by their
+											reverse complement
+										   -i file) reference index: loaded from there if it
+											exists, saved there after it is built otherwise
+										   -g n) windows compared per traversal of the reference
+											(default 64)
+										   -o file) output file (default window_profile.tsv, - for
+											the standard output)
+								  argv: 1) reference FASTA file
+										2) query FASTA file
+										*/
+	kernel_metric_t metric={kernel_metric_kernel,0,0};
+	unsigned int size=default_window_size;
+	unsigned int step=0;
+	unsigned int group=default_window_group;
+	unsigned int cores=1;
+	unsigned int RC=0;
+	const char * index_path=NULL;
+	const char * out_path="window_profile.tsv";
+	FILE * out=stdout;
+	Basic_BWT_t * ref;
+	unsigned char * text;
+	unsigned int textlen,nwindows,start,i,n;
+	window_t * windows;
+	int opt,res,usage=0;
+	while(!usage && (opt=getopt(argc,argv,"w:s:m:t:ri:g:o:"))!=-1) {
+		switch(opt) {
+		case 'w':
+			size=atoi(optarg);
+			break;
+		case 's':
+			step=atoi(optarg);
+			break;
+		case 'm':
+			if(kernel_parse_metric(optarg,&metric)!=0) {
+				fprintf(stderr," Error: unknown metric %s\n",optarg);
+				return ( 1 );
+			}
+			break;
+		case 't':
+			cores=atoi(optarg);
+			break;
+		case 'r':
+			RC=1;
+			break;
+		case 'i':
+			index_path=optarg;
+			break;
+		case 'g':
+			group=atoi(optarg);
+			break;
+		case 'o':
+			out_path=optarg;
+			break;
+		default:
+			usage=1;
+		}
+	}
+	if(step==0)
+		step=size;
+	if(usage || optind!=argc-2 || cores==0 || size==0 || group==0) {
+		fprintf(stderr," Usage: %s [-w size] [-s step] [-m metric] [-t cores] [-r] [-i index] [-g windows] [-o output] reference query\n",argv[0]);
+		return ( 1 );
+	}
+	if((ref=kernel_build_index(argv[optind],RC,index_path))==NULL)
+		return ( 1 );
+	if((res=load_fasta(argv[optind+1],FASTA_load_plain,&text,&textlen))!=0 || textlen==0) {
+		fprintf(stderr," Error: Cannot read %s (error %d)!\n",argv[optind+1],res);
+		free_Basic_BWT(ref);
+		return ( 1 );
+	}
+
+	nwindows=textlen<=size?1:(textlen-size+step-1)/step+1;
+	windows=calloc(nwindows,sizeof(window_t));
+	for(i=0,start=0;i<nwindows;i++,start+=step) {
+		windows[i].start=start;
+		windows[i].end=start+size<textlen?start+size:textlen;
+	}
+	res=0;
+	for(i=0;i<nwindows && res==0;i+=n) {
+		n=nwindows-i<group?nwindows-i:group;
+		if((res=run_window_group(ref,text,windows+i,n,&metric,RC,cores))!=0)
+			fprintf(stderr," Error: Cannot index the windows from %u!\n",windows[i].start);
+	}
+	free(text);
+	free_Basic_BWT(ref);
+
+	if(res==0 && strcmp(out_path,"-")!=0 && (out=fopen(out_path,"w"))==NULL) {
+		fprintf(stderr," Error: Cannot open output file %s!\n",out_path);
+		res=-1;
+	}
+	if(res==0) {
+		write_profile(windows,nwindows,&metric,out);
+		if(out!=stdout)
+			fclose(out);
+	}
+	free(windows);
+	return res?1:0;
+}
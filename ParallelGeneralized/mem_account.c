@@ -0,0 +1,94 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include"mem_account.h"
+
+const char * const mem_component_names[mem_ncomponents+1]=
+		{"index","construction","stacks","states","output","total"};
+
+// Entry mem_total sums the components
+static size_t mem_cur[mem_ncomponents+1];
+static size_t mem_max[mem_ncomponents+1];
+static size_t mem_phase_max[mem_ncomponents+1];
+
+static inline void mem_raise(size_t * max,size_t value)
+{
+	size_t old=__atomic_load_n(max,__ATOMIC_RELAXED);
+	while(value>old && !__atomic_compare_exchange_n(max,&old,value,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+};
+
+void mem_account(unsigned int component,long long delta)
+{
+	size_t cur=__atomic_add_fetch(&mem_cur[component],(size_t)delta,__ATOMIC_RELAXED);
+	size_t total=__atomic_add_fetch(&mem_cur[mem_total],(size_t)delta,__ATOMIC_RELAXED);
+	if(delta<=0)
+		return;
+	mem_raise(&mem_max[component],cur);
+	mem_raise(&mem_phase_max[component],cur);
+	mem_raise(&mem_max[mem_total],total);
+	mem_raise(&mem_phase_max[mem_total],total);
+};
+
+void * mem_malloc(unsigned int component,size_t size)
+{
+	void * ptr=malloc(size);
+	if(ptr)
+		mem_account(component,size);
+	return ptr;
+};
+
+void * mem_calloc(unsigned int component,size_t size)
+{
+	void * ptr=calloc(1,size);
+	if(ptr)
+		mem_account(component,size);
+	return ptr;
+};
+
+// On failure ptr is left allocated and accounted, as with realloc
+void * mem_realloc(unsigned int component,void * ptr,size_t new_size,size_t old_size)
+{
+	void * new_ptr=realloc(ptr,new_size);
+	if(new_ptr || new_size==0)
+		mem_account(component,(long long)new_size-(long long)old_size);
+	return new_ptr;
+};
+
+void mem_free(unsigned int component,void * ptr,size_t size)
+{
+	if(ptr==NULL)
+		return;
+	free(ptr);
+	mem_account(component,-(long long)size);
+};
+
+size_t mem_current(unsigned int component)
+{
+	return __atomic_load_n(&mem_cur[component],__ATOMIC_RELAXED);
+};
+
+size_t mem_peak(unsigned int component)
+{
+	return __atomic_load_n(&mem_max[component],__ATOMIC_RELAXED);
+};
+
+void mem_phase_reset(void)
+{
+	unsigned int i;
+	for(i=0;i<=mem_ncomponents;i++)
+		__atomic_store_n(&mem_phase_max[i],mem_current(i),__ATOMIC_RELAXED);
+};
+
+size_t mem_phase_peak(unsigned int component)
+{
+	return __atomic_load_n(&mem_phase_max[component],__ATOMIC_RELAXED);
+};
+
+void mem_account_write_json(FILE * out)
+{
+	unsigned int i;
+	fprintf(out,"{");
+	for(i=0;i<=mem_ncomponents;i++)
+		fprintf(out,"%s\"%s\": {\"current\": %lu, \"peak\": %lu}",i?", ":"",mem_component_names[i],
+				(unsigned long)mem_current(i),(unsigned long)mem_peak(i));
+	fprintf(out,"}");
+};
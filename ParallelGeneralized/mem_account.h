@@ -0,0 +1,41 @@
+#ifndef mem_account_h
+#define mem_account_h
+#include<stdio.h>
+#include<stddef.h>
+
+// Bytes in use, current and peak, per component of the program. The
+// allocations of a component go through mem_malloc, mem_calloc, mem_realloc
+// and mem_free, which take the size of the block as the dbwt allocator does;
+// memory allocated otherwise is declared with mem_account. Thread safe.
+// The packed BWTs and their sampled suffix arrays
+#define mem_index 0
+// Temporaries of the BWT construction (dbwt, the unpacked BWT)
+#define mem_construction 1
+// Stacks of the SLT traversals and their lists of slave tasks
+#define mem_stacks 2
+// States of the callbacks and their clones
+#define mem_states 3
+// Buffers of the MAWs written to output.txt
+#define mem_output 4
+#define mem_ncomponents 5
+// All the components
+#define mem_total mem_ncomponents
+
+extern const char * const mem_component_names[mem_ncomponents+1];
+
+void * mem_malloc(unsigned int component,size_t size);
+void * mem_calloc(unsigned int component,size_t size);
+void * mem_realloc(unsigned int component,void * ptr,size_t new_size,size_t old_size);
+void mem_free(unsigned int component,void * ptr,size_t size);
+void mem_account(unsigned int component,long long delta);
+
+size_t mem_current(unsigned int component);
+size_t mem_peak(unsigned int component);
+// Start the peaks returned by mem_phase_peak at the current usage
+void mem_phase_reset(void);
+size_t mem_phase_peak(unsigned int component);
+
+// {"index": {"current": bytes, "peak": bytes}, ..., "total": {...}}
+void mem_account_write_json(FILE * out);
+
+#endif
@@ -5,6 +5,9 @@
    Before using, initialize the state by using init_genrand(seed)  
    or init_by_array(init_key, key_length).
 
+   The functions ending in _r take their state as argument, so that
+   every thread can draw from its own streams.
+
    Copyright (C) 1997 - 2002, Makoto Matsumoto and Takuji Nishimura,
    All rights reserved.                          
 
@@ -45,19 +48,23 @@
 #include <time.h>
 #include <stdlib.h>
 #include <string.h>
+#include "mt19937ar.h"
 /* Period parameters */  
-#define N 624
+#define N mt_state_len
 #define M 397
 #define MATRIX_A 0x9908b0dfUL   /* constant vector a */
 #define UPPER_MASK 0x80000000UL /* most significant w-r bits */
 #define LOWER_MASK 0x7fffffffUL /* least significant r bits */
 
-static unsigned long long mt[N]; /* the array for the state vector  */
-static int mti=N+1; /* mti==N+1 means mt[N] is not initialized */
+/* the state of the functions without _r */
+/* mti==N+1 means mt[N] is not initialized */
+static mt_state_t global_state={{0},N+1};
 
 /* initializes mt[N] with a seed */
-void init_genrand(unsigned long long s)
+void init_genrand_r(mt_state_t * state, unsigned long long s)
 {
+    unsigned long long * mt=state->mt;
+    int mti;
     mt[0]= s & 0xffffffffUL;
     for (mti=1; mti<N; mti++) {
         mt[mti] = 
@@ -69,16 +76,18 @@ void init_genrand(unsigned long long s)
         mt[mti] &= 0xffffffffUL;
         /* for >32 bit machines */
     }
+    state->mti=mti;
 }
 
 /* initialize by an array with array-length */
 /* init_key is the array for initializing keys */
 /* key_length is its length */
 /* slight change for C++, 2004/2/26 */
-void init_by_array(unsigned long long init_key[], int key_length)
+void init_by_array_r(mt_state_t * state, unsigned long long init_key[], int key_length)
 {
+    unsigned long long * mt=state->mt;
     int i, j, k;
-    init_genrand(19650218UL);
+    init_genrand_r(state, 19650218UL);
     i=1; j=0;
     k = (N>key_length ? N : key_length);
     for (; k; k--) {
@@ -100,18 +109,30 @@ void init_by_array(unsigned long long init_key[], int key_length)
     mt[0] = 0x80000000UL; /* MSB is 1; assuring non-zero initial array */ 
 }
 
+/* initializes stream number stream of seed by the key {seed, stream}: */
+/* the streams of different keys are independent for all practical     */
+/* purposes, which serves parallel generation as jumping ahead would,  */
+/* for the cost of one init_by_array per stream                        */
+void init_genrand_stream_r(mt_state_t * state, unsigned long long seed, unsigned long long stream)
+{
+    unsigned long long init_key[4]={seed & 0xffffffffUL, seed >> 32,
+        stream & 0xffffffffUL, stream >> 32};
+    init_by_array_r(state, init_key, 4);
+}
+
 /* generates a random number on [0,0xffffffff]-interval */
-unsigned long long genrand_int32(void)
+unsigned long long genrand_int32_r(mt_state_t * state)
 {
+    unsigned long long * mt=state->mt;
     unsigned long long y;
-    static unsigned long long mag01[2]={0x0UL, MATRIX_A};
+    static const unsigned long long mag01[2]={0x0UL, MATRIX_A};
     /* mag01[x] = x * MATRIX_A  for x=0,1 */
 
-    if (mti >= N) { /* generate N words at one time */
+    if (state->mti >= N) { /* generate N words at one time */
         int kk;
 
-        if (mti == N+1)   /* if init_genrand() has not been called, */
-            init_genrand(5489UL); /* a default initial seed is used */
+        if (state->mti == N+1)   /* if init_genrand() has not been called, */
+            init_genrand_r(state, 5489UL); /* a default initial seed is used */
 
         for (kk=0;kk<N-M;kk++) {
             y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
@@ -124,10 +145,10 @@ unsigned long long genrand_int32(void)
         y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
         mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
 
-        mti = 0;
+        state->mti = 0;
     }
   
-    y = mt[mti++];
+    y = mt[state->mti++];
 
     /* Tempering */
     y ^= (y >> 11);
@@ -139,37 +160,77 @@ unsigned long long genrand_int32(void)
 }
 
 /* generates a random number on [0,0x7fffffff]-interval */
-long genrand_int31(void)
+long genrand_int31_r(mt_state_t * state)
 {
-    return (long)(genrand_int32()>>1);
+    return (long)(genrand_int32_r(state)>>1);
 }
 
 /* generates a random number on [0,1]-real-interval */
-double genrand_real1(void)
+double genrand_real1_r(mt_state_t * state)
 {
-    return genrand_int32()*(1.0/4294967295.0); 
+    return genrand_int32_r(state)*(1.0/4294967295.0); 
     /* divided by 2^32-1 */ 
 }
 
 /* generates a random number on [0,1)-real-interval */
-double genrand_real2(void)
+double genrand_real2_r(mt_state_t * state)
 {
-    return genrand_int32()*(1.0/4294967296.0); 
+    return genrand_int32_r(state)*(1.0/4294967296.0); 
     /* divided by 2^32 */
 }
 
 /* generates a random number on (0,1)-real-interval */
-double genrand_real3(void)
+double genrand_real3_r(mt_state_t * state)
 {
-    return (((double)genrand_int32()) + 0.5)*(1.0/4294967296.0); 
+    return (((double)genrand_int32_r(state)) + 0.5)*(1.0/4294967296.0); 
     /* divided by 2^32 */
 }
 
 /* generates a random number on [0,1) with 53-bit resolution*/
-double genrand_res53(void) 
+double genrand_res53_r(mt_state_t * state) 
 { 
-    unsigned long long a=genrand_int32()>>5, b=genrand_int32()>>6; 
+    unsigned long long a=genrand_int32_r(state)>>5, b=genrand_int32_r(state)>>6; 
     return(a*67108864.0+b)*(1.0/9007199254740992.0); 
 } 
 /* These real versions are due to Isaku Wada, 2002/01/09 added */
 
+/* the functions on the global state, not thread safe */
+void init_genrand(unsigned long long s)
+{
+    init_genrand_r(&global_state, s);
+}
+
+void init_by_array(unsigned long long init_key[], int key_length)
+{
+    init_by_array_r(&global_state, init_key, key_length);
+}
+
+unsigned long long genrand_int32(void)
+{
+    return genrand_int32_r(&global_state);
+}
+
+long genrand_int31(void)
+{
+    return genrand_int31_r(&global_state);
+}
+
+double genrand_real1(void)
+{
+    return genrand_real1_r(&global_state);
+}
+
+double genrand_real2(void)
+{
+    return genrand_real2_r(&global_state);
+}
+
+double genrand_real3(void)
+{
+    return genrand_real3_r(&global_state);
+}
+
+double genrand_res53(void) 
+{ 
+    return genrand_res53_r(&global_state);
+} 
@@ -1,5 +1,15 @@
 #ifndef mt19937ar_h
 #define mt19937ar_h
+
+#define mt_state_len 624
+
+// The state of one generator, for the functions ending in _r
+typedef struct
+{
+	unsigned long long mt[mt_state_len];
+	int mti;
+} mt_state_t;
+
 void init_genrand(unsigned long long s);
 unsigned long long genrand_int32(void);
 
@@ -10,4 +20,15 @@ double genrand_real2(void);
 double genrand_real3(void);
 double genrand_res53(void);
 
+void init_genrand_r(mt_state_t * state, unsigned long long s);
+void init_by_array_r(mt_state_t * state, unsigned long long init_key[], int key_length);
+// Independent streams of one seed, numbered from 0
+void init_genrand_stream_r(mt_state_t * state, unsigned long long seed, unsigned long long stream);
+unsigned long long genrand_int32_r(mt_state_t * state);
+long genrand_int31_r(mt_state_t * state);
+double genrand_real1_r(mt_state_t * state);
+double genrand_real2_r(mt_state_t * state);
+double genrand_real3_r(mt_state_t * state);
+double genrand_res53_r(mt_state_t * state);
+
 #endif
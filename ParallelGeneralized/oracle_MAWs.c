@@ -0,0 +1,458 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<math.h>
+#include<sys/time.h>
+#include"oracle_MAWs.h"
+#include"dbwt.h"
+
+#define min_MAW_len 2
+
+// Extension characters, numbered as in SLT_joint_params_t: the text
+// boundary, the bases and the other characters
+#define oracle_sigma 6
+#define oracle_other 5
+// Codes of the separators ending text1 and text2 in the concatenation
+#define oracle_sep1 6
+#define oracle_sep2 7
+
+// A node of the generalized suffix tree while it is open on the stack
+typedef struct
+{
+	unsigned int depth;
+	// Suffix array index of its first suffix
+	unsigned int lb;
+	// left[t][a] is the frequency of aW in text t, freqs[t][a][b] that of aWb
+	unsigned int left[2][oracle_sigma];
+	unsigned int freqs[2][oracle_sigma][oracle_sigma];
+} oracle_node_t;
+
+typedef struct
+{
+	unsigned int common;
+	unsigned int nMAWs1;
+	unsigned int nMAWs2;
+	double LW;
+	double D[2];
+	double N;
+} oracle_sums_t;
+
+typedef struct
+{
+	const int * S;
+	const int * SA;
+	const int * run;
+	unsigned int textlen[2];
+	const kernel_metric_t * metrics;
+	unsigned int nmetrics;
+	oracle_sums_t * sums;
+	unsigned int kernel;
+	// prefix[t][y] is the sum of (g_t(y')-1)^2 for y'<=y, prefixN[y] that of
+	// (g_1(y')-1)(g_2(y')-1)
+	double * prefix[2];
+	double * prefixN;
+} oracle_t;
+
+static double gettime( void )
+{
+	struct timeval ttime;
+	gettimeofday( &ttime , 0 );
+	return ttime.tv_sec + ttime.tv_usec * 0.000001;
+};
+
+// The correction of the expected frequency of a word of length y in a text
+// of length textlen, as in the SLT kernel
+static inline double oracle_g(unsigned int textlen,unsigned int y)
+{
+	double length=(double)textlen+2;
+	return (length-y+2)/(length-y+1)*(length-y+2)/(length-y+3);
+};
+
+static inline unsigned int oracle_code(unsigned char c)
+{
+	switch(c) {
+	case 'A': return 1;
+	case 'C': return 2;
+	case 'G': return 3;
+	case 'T': return 4;
+	default: return oracle_other;
+	}
+};
+
+static inline unsigned int oracle_text(const oracle_t * o,unsigned int p)
+{
+	return p>o->textlen[0];
+};
+
+// Extension character following the first depth characters of suffix p
+static inline unsigned int oracle_right(const oracle_t * o,unsigned int p,unsigned int depth)
+{
+	int c=o->S[p+depth];
+	return c>=oracle_sep1?0:(unsigned int)c;
+};
+
+static inline unsigned int oracle_left(const oracle_t * o,unsigned int p)
+{
+	if(p==0 || p==o->textlen[0]+1)
+		return 0;
+	return (unsigned int)o->S[p-1];
+};
+
+// Length of the suffix p up to its separator, included
+static inline unsigned int oracle_leaf_depth(const oracle_t * o,unsigned int p)
+{
+	return (oracle_text(o,p)?o->textlen[0]+o->textlen[1]+1:o->textlen[0])-p+1;
+};
+
+// The words aWb of one text, from the frequencies of a node W: z[a][b] is
+// the kernel term of aWb if defined[a][b]
+static void oracle_kernel_terms(const unsigned int freqs[oracle_sigma][oracle_sigma],unsigned int textlen,
+		unsigned int depth,double z[5][5],unsigned int defined[5][5])
+{
+	unsigned int faw[5],fwb[5],left[5],right[5];
+	unsigned int a,b,fw=0;
+	double g=oracle_g(textlen,depth+2);
+	for(a=0;a<5;a++) {
+		faw[a]=fwb[a]=left[a]=right[a]=0;
+		for(b=0;b<oracle_sigma;b++) {
+			left[a]+=freqs[a][b];
+			right[a]+=freqs[b][a];
+			if(b<5) {
+				faw[a]+=freqs[a][b];
+				fwb[a]+=freqs[b][a];
+			}
+		}
+		fw+=faw[a];
+	}
+	for(a=0;a<5;a++)
+		for(b=0;b<5;b++) {
+			defined[a][b]=(left[a] && right[b] && (freqs[a][b] || (a && b)));
+			if(freqs[a][b])
+				z[a][b]=g*fw/faw[a]*freqs[a][b]/fwb[b]-1;
+			else
+				z[a][b]=-1;
+		}
+};
+
+// Evaluate the metrics on the words aWb of the node W
+static void oracle_visit(oracle_t * o,const oracle_node_t * node)
+{
+	unsigned int left[2][oracle_sigma],right[2][oracle_sigma],nleft[2],nright[2];
+	unsigned int freq_left[2],freq_right[2];
+	unsigned int occurs[2],maxrep,maw1,maw2,rw1,rw2;
+	unsigned int defined[2][5][5];
+	double z[2][5][5];
+	double x=1.0/((double)(node->depth+2)*(node->depth+2));
+	unsigned int a,b,c,i,t;
+	oracle_sums_t * sums;
+	// W must be over ACGT
+	if(node->depth>(unsigned int)o->run[o->SA[node->lb]])
+		return;
+	for(t=0;t<2;t++) {
+		nleft[t]=nright[t]=occurs[t]=0;
+		for(a=0;a<oracle_sigma;a++) {
+			left[t][a]=right[t][a]=0;
+			for(b=0;b<oracle_sigma;b++) {
+				left[t][a]+=node->freqs[t][a][b];
+				right[t][a]+=node->freqs[t][b][a];
+			}
+			occurs[t]+=left[t][a];
+		}
+		for(a=0;a<oracle_sigma;a++) {
+			nleft[t]+=(left[t][a]>0);
+			nright[t]+=(right[t][a]>0);
+		}
+	}
+	maxrep=(nleft[0]>1 && nright[0]>1) || (nleft[1]>1 && nright[1]>1);
+
+	for(i=0;i<o->nmetrics;i++) {
+		sums=&o->sums[i];
+		if(o->metrics[i].metric==kernel_metric_kernel) {
+			for(t=0;t<2;t++)
+				if(occurs[t])
+					oracle_kernel_terms((const unsigned int (*)[oracle_sigma])node->freqs[t],o->textlen[t],
+							node->depth,z[t],defined[t]);
+				else
+					memset(defined[t],0,sizeof(defined[t]));
+			for(a=0;a<5;a++)
+				for(b=0;b<5;b++) {
+					for(t=0;t<2;t++)
+						if(defined[t][a][b])
+							sums->D[t]+=z[t][a][b]*z[t][a][b];
+					if(defined[0][a][b] && defined[1][a][b])
+						sums->N+=z[0][a][b]*z[1][a][b];
+				}
+			continue;
+		}
+		if(node->depth+2<min_MAW_len)
+			continue;
+		for(a=1;a<5;a++)
+			for(b=1;b<5;b++) {
+				maw1=(left[0][a] && right[0][b] && node->freqs[0][a][b]==0);
+				maw2=(left[1][a] && right[1][b] && node->freqs[1][a][b]==0);
+				switch(o->metrics[i].metric) {
+				case kernel_metric_present:
+					sums->common+=(maw1 && node->freqs[1][a][b]!=0);
+					break;
+				case kernel_metric_rws:
+					// Rare words are reported at the maximal repeats only
+					if(!maxrep)
+						break;
+					for(t=0;t<2;t++) {
+						freq_left[t]=freq_right[t]=0;
+						for(c=1;c<5;c++) {
+							freq_left[t]+=node->freqs[t][a][c];
+							freq_right[t]+=node->freqs[t][c][b];
+						}
+					}
+					rw1=(freq_left[0]>=o->metrics[i].delta2 && freq_right[0]>=o->metrics[i].delta2
+							&& node->freqs[0][a][b]<=o->metrics[i].delta1);
+					rw2=(freq_left[1]>=o->metrics[i].delta2 && freq_right[1]>=o->metrics[i].delta2
+							&& node->freqs[1][a][b]<=o->metrics[i].delta1);
+					sums->nMAWs1+=rw1;
+					sums->nMAWs2+=rw2;
+					sums->common+=(rw1 && rw2);
+					break;
+				default:
+					sums->nMAWs1+=maw1;
+					sums->nMAWs2+=maw2;
+					sums->common+=(maw1 && maw2);
+					// The words absent from one text only
+					sums->LW+=x*(maw1+maw2)-2*x*(maw1 && maw2);
+				}
+			}
+	}
+};
+
+// The words W on the edge from a node of depth parent_depth to its child
+// starting with suffix p: W has a single right extension, so every word aWb
+// of text t has the kernel term g_t(|aWb|)-1
+static void oracle_edge(oracle_t * o,unsigned int parent_depth,unsigned int p,unsigned int child_depth,
+		const unsigned int left[2][oracle_sigma])
+{
+	unsigned int run=o->run[p];
+	unsigned int max_depth=child_depth-1;
+	unsigned int nleft[2]={0,0};
+	unsigned int ncommon=0;
+	unsigned int a,i,t;
+	// The last W must be followed by a base or the end of the text
+	if(o->S[p+run]<oracle_sep1) {
+		if(run==0)
+			return;
+		run--;
+	}
+	if(run<max_depth)
+		max_depth=run;
+	if(max_depth<=parent_depth)
+		return;
+	for(a=0;a<5;a++) {
+		nleft[0]+=(left[0][a]>0);
+		nleft[1]+=(left[1][a]>0);
+		ncommon+=(left[0][a] && left[1][a]);
+	}
+	for(i=0;i<o->nmetrics;i++) {
+		if(o->metrics[i].metric!=kernel_metric_kernel)
+			continue;
+		for(t=0;t<2;t++)
+			if(nleft[t])
+				o->sums[i].D[t]+=nleft[t]*(o->prefix[t][max_depth+2]-o->prefix[t][parent_depth+2]);
+		if(ncommon)
+			o->sums[i].N+=ncommon*(o->prefixN[max_depth+2]-o->prefixN[parent_depth+2]);
+	}
+};
+
+// Attach the node or leaf of depth child_depth starting with suffix p to
+// parent
+static void oracle_attach(oracle_t * o,oracle_node_t * parent,unsigned int p,unsigned int child_depth,
+		const unsigned int left[2][oracle_sigma])
+{
+	unsigned int b=oracle_right(o,p,parent->depth);
+	unsigned int a,t;
+	for(t=0;t<2;t++)
+		for(a=0;a<oracle_sigma;a++) {
+			parent->freqs[t][a][b]+=left[t][a];
+			parent->left[t][a]+=left[t][a];
+		}
+	if(o->kernel)
+		oracle_edge(o,parent->depth,p,child_depth,left);
+};
+
+static oracle_node_t * oracle_push(oracle_node_t ** stack,unsigned int * top,unsigned int * capacity,
+		unsigned int depth,unsigned int lb)
+{
+	if(*top==*capacity) {
+		*capacity*=2;
+		*stack=(oracle_node_t *)realloc(*stack,*capacity*sizeof(oracle_node_t));
+		if(*stack==NULL)
+			return NULL;
+	}
+	memset(&(*stack)[*top],0,sizeof(oracle_node_t));
+	(*stack)[*top].depth=depth;
+	(*stack)[*top].lb=lb;
+	return &(*stack)[(*top)++];
+};
+
+// Bottom up traversal of the LCP intervals: every internal node is visited
+// when its last suffix has been attached
+static int oracle_traverse(oracle_t * o,const int * LCP,unsigned int n)
+{
+	unsigned int capacity=1024,top=0;
+	oracle_node_t * stack=(oracle_node_t *)malloc(capacity*sizeof(oracle_node_t));
+	oracle_node_t * node;
+	unsigned int leaf[2][oracle_sigma];
+	unsigned int i,lcp,p;
+	if(stack==NULL || oracle_push(&stack,&top,&capacity,0,0)==NULL)
+		goto error;
+	for(i=0;i<n;i++) {
+		lcp=(i+1<n)?(unsigned int)LCP[i+1]:0;
+		if(lcp>stack[top-1].depth && oracle_push(&stack,&top,&capacity,lcp,i)==NULL)
+			goto error;
+		p=o->SA[i];
+		memset(leaf,0,sizeof(leaf));
+		leaf[oracle_text(o,p)][oracle_left(o,p)]=1;
+		oracle_attach(o,&stack[top-1],p,oracle_leaf_depth(o,p),(const unsigned int (*)[oracle_sigma])leaf);
+		while(stack[top-1].depth>lcp) {
+			node=&stack[--top];
+			oracle_visit(o,node);
+			if(stack[top-1].depth<lcp) {
+				// The node and the next suffix branch below the top of the stack
+				oracle_node_t closed=*node;
+				if(oracle_push(&stack,&top,&capacity,lcp,closed.lb)==NULL)
+					goto error;
+				node=&closed;
+				oracle_attach(o,&stack[top-1],o->SA[node->lb],node->depth,
+						(const unsigned int (*)[oracle_sigma])node->left);
+			}
+			else
+				oracle_attach(o,&stack[top-1],o->SA[node->lb],node->depth,
+						(const unsigned int (*)[oracle_sigma])node->left);
+		}
+	}
+	// The root
+	oracle_visit(o,&stack[0]);
+	free(stack);
+	return 0;
+error:
+	free(stack);
+	return -1;
+};
+
+static double * oracle_prefix_sums(unsigned int textlen1,unsigned int textlen2,unsigned int size)
+{
+	double * prefix=(double *)malloc(size*sizeof(double));
+	unsigned int y;
+	if(prefix==NULL)
+		return NULL;
+	prefix[0]=0;
+	for(y=1;y<size;y++)
+		prefix[y]=prefix[y-1]+(oracle_g(textlen1,y)-1)*(oracle_g(textlen2,y)-1);
+	return prefix;
+};
+
+int oracle_compute(const unsigned char * text1,unsigned int textlen1,
+		const unsigned char * text2,unsigned int textlen2,
+		const kernel_metric_t * metrics,unsigned int nmetrics,kernel_result_t * results)
+{
+	unsigned int n=textlen1+textlen2+2;
+	unsigned int min_textlen=textlen1<textlen2?textlen1:textlen2;
+	int * S=(int *)malloc(n*sizeof(int));
+	int * SA=(int *)malloc(n*sizeof(int));
+	int * LCP=(int *)malloc(n*sizeof(int));
+	int * aux=(int *)malloc((n+1)*sizeof(int));
+	oracle_t o;
+	double t=gettime();
+	unsigned int i,j;
+	int h,res=-1;
+	memset(&o,0,sizeof(o));
+	o.sums=(oracle_sums_t *)calloc(nmetrics+1,sizeof(oracle_sums_t));
+	if(S==NULL || SA==NULL || LCP==NULL || aux==NULL || o.sums==NULL)
+		goto return_point;
+	for(i=0;i<textlen1;i++)
+		S[i]=oracle_code(text1[i]);
+	S[textlen1]=oracle_sep1;
+	for(i=0;i<textlen2;i++)
+		S[textlen1+1+i]=oracle_code(text2[i]);
+	S[n-1]=oracle_sep2;
+	if(dbwt_sais_int(S,SA,n,oracle_sep2+1)!=0)
+		goto return_point;
+
+	// LCP[i] of SA[i-1] and SA[i] by the permuted LCP array (Karkkainen et
+	// al.), aux holding the previous suffix of every suffix and then its LCP
+	aux[SA[0]]=-1;
+	for(i=1;i<n;i++)
+		aux[SA[i]]=SA[i-1];
+	for(i=0,h=0;i<n;i++) {
+		if(aux[i]<0) {
+			aux[i]=h=0;
+			continue;
+		}
+		// The separators are unique, so no common prefix spans them
+		while(S[i+h]==S[aux[i]+h] && S[i+h]<oracle_sep1)
+			h++;
+		aux[i]=h;
+		if(h>0)
+			h--;
+	}
+	LCP[0]=0;
+	for(i=1;i<n;i++)
+		LCP[i]=aux[SA[i]];
+	// aux now holds the lengths of the runs of bases
+	aux[n]=0;
+	for(j=n;j>0;j--)
+		aux[j-1]=(S[j-1]>=1 && S[j-1]<=4)?aux[j]+1:0;
+
+	o.S=S;
+	o.SA=SA;
+	o.run=aux;
+	o.textlen[0]=textlen1;
+	o.textlen[1]=textlen2;
+	o.metrics=metrics;
+	o.nmetrics=nmetrics;
+	for(i=0;i<nmetrics;i++)
+		o.kernel|=(metrics[i].metric==kernel_metric_kernel);
+	if(o.kernel) {
+		o.prefix[0]=oracle_prefix_sums(textlen1,textlen1,textlen1+3);
+		o.prefix[1]=oracle_prefix_sums(textlen2,textlen2,textlen2+3);
+		o.prefixN=oracle_prefix_sums(textlen1,textlen2,min_textlen+3);
+		if(o.prefix[0]==NULL || o.prefix[1]==NULL || o.prefixN==NULL)
+			goto return_point;
+	}
+	if(oracle_traverse(&o,LCP,n)!=0)
+		goto return_point;
+
+	t=gettime()-t;
+	for(i=0;i<nmetrics;i++) {
+		memset(&results[i],0,sizeof(kernel_result_t));
+		results[i].seconds=t;
+		switch(metrics[i].metric) {
+		case kernel_metric_kernel:
+			results[i].value=o.sums[i].N/sqrt(o.sums[i].D[0]*o.sums[i].D[1]);
+			break;
+		case kernel_metric_present:
+			results[i].common=o.sums[i].common;
+			results[i].value=o.sums[i].common;
+			break;
+		default:
+			results[i].common=o.sums[i].common;
+			results[i].nMAWs1=o.sums[i].nMAWs1;
+			results[i].nMAWs2=o.sums[i].nMAWs2;
+			if(metrics[i].metric==kernel_metric_jaccard)
+				results[i].value=(double)results[i].common/(results[i].nMAWs1+results[i].nMAWs2-results[i].common);
+			else if(metrics[i].metric==kernel_metric_lw)
+				results[i].value=o.sums[i].LW;
+			else
+				results[i].value=results[i].common;
+		}
+	}
+	res=0;
+return_point:
+	free(o.prefix[0]);
+	free(o.prefix[1]);
+	free(o.prefixN);
+	free(o.sums);
+	free(S);
+	free(SA);
+	free(LCP);
+	free(aux);
+	return res;
+};
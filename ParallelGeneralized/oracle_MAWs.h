@@ -0,0 +1,20 @@
+#ifndef oracle_MAWs_h
+#define oracle_MAWs_h
+#include"kernel_metrics.h"
+
+// Reference values of the pairwise metrics, computed without the BWT index
+// and the SLT traversal: the nodes of the generalized suffix tree of the two
+// texts are enumerated bottom up from their suffix array (sais.c) and LCP
+// array, in O(n) time and about 16 bytes per character plus the stack of
+// open nodes. Every metric is evaluated from its definition over the words
+// aWb with W in {A,C,G,T}*; the words W on the edges of the tree, which the
+// Markovian kernel needs, are summed in closed form along each edge.
+//
+// results[i] is set as kernel_compute sets it for metrics[i], with the
+// seconds of the whole computation. The texts are over ACGT, any other
+// character separating words as 'Z' does. Returns -1 if out of memory.
+int oracle_compute(const unsigned char * text1,unsigned int textlen1,
+		const unsigned char * text2,unsigned int textlen2,
+		const kernel_metric_t * metrics,unsigned int nmetrics,kernel_result_t * results);
+
+#endif
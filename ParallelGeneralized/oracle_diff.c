@@ -0,0 +1,197 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<math.h>
+#include"DNA5_Basic_BWT.h"
+#include"kernel_metrics.h"
+#include"oracle_MAWs.h"
+#include"synth_genome.h"
+
+/*
+ Differential test of the SLT path against oracle_compute: for every genome
+ length and every seed, draws a genome with synth_genome and a mutated copy
+ of it, computes every metric on the pair with the suffix array oracle and
+ with kernel_compute for every number of cores, and reports one line per
+ metric and number of cores with both results and times. Counts must be
+ equal and values equal up to the relative tolerance. Exits with 1 if any
+ metric differs.
+*/
+
+#define max_diff_values 32
+
+static int same_value(double x,double y,double tolerance)
+{
+	if(isnan(x) || isnan(y))
+		return isnan(x) && isnan(y);
+	return fabs(x-y)<=tolerance*fmax(1,fmax(fabs(x),fabs(y)));
+};
+
+static int same_result(const kernel_result_t * slt,const kernel_result_t * oracle,double tolerance)
+{
+	return slt->common==oracle->common && slt->nMAWs1==oracle->nMAWs1 && slt->nMAWs2==oracle->nMAWs2
+			&& same_value(slt->value,oracle->value,tolerance);
+};
+
+int main(int argc, char **argv) {
+								/*options: -n lengths) comma separated genome lengths (default
+											1000,10000,100000)
+										   -m model) uniform (default), gc:<fraction> or markov:<order>
+										   -R count:length[:divergence]) insert count repeats of
+											length bases, each mutated at divergence (default 0)
+										   -d rate) divergence of the second genome from the first
+											(default 0.01)
+										   -r rounds) genome pairs per length, with seeds seed to
+											seed+rounds-1 (default 3)
+										   -t cores) comma separated numbers of cores (default 1,4)
+										   -M metrics) comma separated metrics (default
+											maws,rws:1:2,present,jaccard,lw,kernel)
+										   -e tolerance) relative tolerance of the values (default
+											1e-9, the rounding of the sums in a different order)
+										   -s seed) first seed of mt19937ar (default 1)
+										   -o file) report file (default the standard output)
+										*/
+	synth_params_t params;
+	unsigned int lengths[max_diff_values]={1000,10000,100000};
+	unsigned int cores[max_diff_values]={1,4};
+	unsigned int nlengths=3,ncores=2,nmetrics=0,rounds=3;
+	kernel_metric_t metrics[max_diff_values];
+	kernel_result_t oracle_results[max_diff_values];
+	kernel_result_t result;
+	char metric_names[max_diff_values][kernel_metric_name_len];
+	char model[64];
+	const char * metric_spec="maws,rws:1:2,present,jaccard,lw,kernel";
+	const char * out_path=NULL;
+	FILE * out=stdout;
+	double divergence=0.01,tolerance=1e-9;
+	unsigned long long seed=1;
+	unsigned char * text1;
+	unsigned char * text2;
+	unsigned int textlen2;
+	Basic_BWT_t * BBWT1;
+	Basic_BWT_t * BBWT2;
+	unsigned int i,l,r,c,m,same,ndiffs=0,nchecks=0;
+	char * spec;
+	char * tok;
+	int opt,usage=0,res=0;
+	memset(&params,0,sizeof(params));
+	while(!usage && (opt=getopt(argc,argv,"n:m:R:d:r:t:M:e:s:o:"))!=-1) {
+		switch(opt) {
+		case 'n':
+			if(kernel_parse_list(optarg,lengths,max_diff_values,&nlengths)!=0)
+				usage=1;
+			break;
+		case 'm':
+			if(synth_parse_model(optarg,&params)!=0)
+				usage=1;
+			break;
+		case 'R':
+			if(sscanf(optarg,"%u:%u:%lf",&params.nrepeats,&params.repeat_len,&params.repeat_divergence)<2)
+				usage=1;
+			break;
+		case 'd':
+			divergence=atof(optarg);
+			break;
+		case 'r':
+			rounds=atoi(optarg);
+			break;
+		case 't':
+			if(kernel_parse_list(optarg,cores,max_diff_values,&ncores)!=0)
+				usage=1;
+			break;
+		case 'M':
+			metric_spec=optarg;
+			break;
+		case 'e':
+			tolerance=atof(optarg);
+			break;
+		case 's':
+			seed=strtoull(optarg,NULL,10);
+			break;
+		case 'o':
+			out_path=optarg;
+			break;
+		default:
+			usage=1;
+		}
+	}
+	spec=strdup(metric_spec);
+	for(tok=strtok(spec,",");tok && nmetrics<max_diff_values;tok=strtok(NULL,",")) {
+		if(kernel_parse_metric(tok,&metrics[nmetrics])!=0) {
+			fprintf(stderr," Error: unknown metric %s\n",tok);
+			usage=1;
+			break;
+		}
+		kernel_metric_name(&metrics[nmetrics],metric_names[nmetrics]);
+		nmetrics++;
+	}
+	free(spec);
+	for(i=0;i<nlengths;i++)
+		if(lengths[i]==0)
+			usage=1;
+	for(i=0;i<ncores;i++)
+		if(cores[i]==0)
+			usage=1;
+	if(usage || optind!=argc) {
+		fprintf(stderr," Usage: %s [-n lengths] [-m model] [-R count:length[:divergence]] [-d rate] [-r rounds] [-t cores] [-M metrics] [-e tolerance] [-s seed] [-o output]\n",argv[0]);
+		return ( 1 );
+	}
+	if(out_path && (out=fopen(out_path,"w"))==NULL) {
+		fprintf(stderr," Error: Cannot open output file %s!\n",out_path);
+		return ( 1 );
+	}
+	synth_model_name(&params,model,sizeof(model));
+	fprintf(out,"model\ttextlen1\ttextlen2\tseed\tcores\tmetric\tslt_value\toracle_value\tslt_common\t"
+			"oracle_common\tslt_n1\toracle_n1\tslt_n2\toracle_n2\tslt_seconds\toracle_seconds\tsame\n");
+
+	for(l=0;l<nlengths && res==0;l++)
+		for(r=0;r<rounds && res==0;r++) {
+			params.length=lengths[l];
+			params.seed=seed+r;
+			text1=synth_genome(&params);
+			text2=text1?synth_mutated_copy(text1,params.length,divergence,params.seed+1,params.cores,&textlen2):NULL;
+			if(text2==NULL || textlen2==0) {
+				fprintf(stderr," Error: Cannot generate the genomes of length %u!\n",params.length);
+				free(text1);
+				free(text2);
+				res=1;
+				break;
+			}
+			if(oracle_compute(text1,params.length,text2,textlen2,metrics,nmetrics,oracle_results)!=0) {
+				fprintf(stderr," Error: Cannot allocate the oracle of the genomes of length %u!\n",params.length);
+				free(text1);
+				free(text2);
+				res=1;
+				break;
+			}
+			BBWT1=Build_BWT_index_from_text(text1,params.length,Basic_bwt_free_text);
+			BBWT2=Build_BWT_index_from_text(text2,textlen2,Basic_bwt_free_text);
+			free(text1);
+			free(text2);
+			if(BBWT1==NULL || BBWT2==NULL) {
+				fprintf(stderr," Error: Cannot index the genomes of length %u!\n",params.length);
+				res=1;
+			}
+			for(c=0;c<ncores && res==0;c++)
+				for(m=0;m<nmetrics;m++) {
+					kernel_compute(BBWT1,BBWT2,&metrics[m],cores[c],&result);
+					same=same_result(&result,&oracle_results[m],tolerance);
+					ndiffs+=!same;
+					nchecks++;
+					fprintf(out,"%s\t%u\t%u\t%llu\t%u\t%s\t%.12g\t%.12g\t%u\t%u\t%u\t%u\t%u\t%u\t%f\t%f\t%u\n",
+							model,params.length,textlen2,params.seed,cores[c],metric_names[m],result.value,
+							oracle_results[m].value,result.common,oracle_results[m].common,result.nMAWs1,
+							oracle_results[m].nMAWs1,result.nMAWs2,oracle_results[m].nMAWs2,result.seconds,
+							oracle_results[m].seconds,same);
+				}
+			if(BBWT1)
+				free_Basic_BWT(BBWT1);
+			if(BBWT2)
+				free_Basic_BWT(BBWT2);
+		}
+	if(out!=stdout)
+		fclose(out);
+	if(res==0)
+		fprintf(stderr,"%u of %u checks differ\n",ndiffs,nchecks);
+	return res?res:(ndiffs>0);
+}
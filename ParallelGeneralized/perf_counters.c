@@ -0,0 +1,92 @@
+#include<stdio.h>
+#include<string.h>
+#include<unistd.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+#include"perf_counters.h"
+
+const char * const perf_event_names[perf_nevents]=
+		{"cycles","instructions","llc_misses","dtlb_misses","branch_misses"};
+
+perf_counters_t * perf_counters=NULL;
+
+static void perf_event_config(unsigned int event,struct perf_event_attr * attr)
+{
+	switch(event) {
+	case perf_cycles:
+		attr->type=PERF_TYPE_HARDWARE;
+		attr->config=PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case perf_instructions:
+		attr->type=PERF_TYPE_HARDWARE;
+		attr->config=PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case perf_llc_misses:
+		attr->type=PERF_TYPE_HW_CACHE;
+		attr->config=PERF_COUNT_HW_CACHE_LL|(PERF_COUNT_HW_CACHE_OP_READ<<8)|
+				(PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+		break;
+	case perf_dtlb_misses:
+		attr->type=PERF_TYPE_HW_CACHE;
+		attr->config=PERF_COUNT_HW_CACHE_DTLB|(PERF_COUNT_HW_CACHE_OP_READ<<8)|
+				(PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+		break;
+	default:
+		attr->type=PERF_TYPE_HARDWARE;
+		attr->config=PERF_COUNT_HW_BRANCH_MISSES;
+	}
+};
+
+// Every event has its own file descriptor, so that one missing event does
+// not disable the others
+int perf_counters_open(perf_counters_t * counters,unsigned int inherit)
+{
+	struct perf_event_attr attr;
+	unsigned int i;
+	int nopen=0;
+	for(i=0;i<perf_nevents;i++) {
+		memset(&attr,0,sizeof(attr));
+		attr.size=sizeof(attr);
+		perf_event_config(i,&attr);
+		attr.exclude_kernel=1;
+		attr.exclude_hv=1;
+		attr.inherit=inherit;
+		attr.read_format=PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+		counters->fd[i]=syscall(SYS_perf_event_open,&attr,0,-1,-1,0);
+		nopen+=(counters->fd[i]>=0);
+	}
+	return nopen;
+};
+
+void perf_counters_close(perf_counters_t * counters)
+{
+	unsigned int i;
+	for(i=0;i<perf_nevents;i++)
+		if(counters->fd[i]>=0) {
+			close(counters->fd[i]);
+			counters->fd[i]=-1;
+		}
+};
+
+void perf_counters_read(const perf_counters_t * counters,long long * values)
+{
+	// value, time enabled, time running
+	unsigned long long data[3];
+	unsigned int i;
+	for(i=0;i<perf_nevents;i++) {
+		values[i]=-1;
+		if(counters->fd[i]<0 || read(counters->fd[i],data,sizeof(data))!=sizeof(data))
+			continue;
+		if(data[2]>0 && data[2]<data[1])
+			values[i]=(long long)(data[0]*((double)data[1]/data[2]));
+		else
+			values[i]=data[0];
+	}
+};
+
+void perf_counters_diff(const long long * start,const long long * end,long long * values)
+{
+	unsigned int i;
+	for(i=0;i<perf_nevents;i++)
+		values[i]=(start[i]<0 || end[i]<0)?-1:end[i]-start[i];
+};
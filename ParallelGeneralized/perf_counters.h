@@ -0,0 +1,34 @@
+#ifndef perf_counters_h
+#define perf_counters_h
+
+// Hardware counters of the CPU read with perf_event_open (Linux). Events the
+// machine or the kernel do not provide are not counted: their values are -1.
+#define perf_nevents 5
+#define perf_cycles 0
+#define perf_instructions 1
+#define perf_llc_misses 2
+#define perf_dtlb_misses 3
+#define perf_branch_misses 4
+
+typedef struct
+{
+	int fd[perf_nevents];
+} perf_counters_t;
+
+extern const char * const perf_event_names[perf_nevents];
+
+// Counters of the process, read by the phases of phase_log and by the slave
+// tasks of SLT_instrument. NULL, the default, reads nothing.
+extern perf_counters_t * perf_counters;
+
+// Count the events of the calling thread and, with inherit, of the threads
+// it creates afterwards. Returns the number of events that can be counted.
+int perf_counters_open(perf_counters_t * counters,unsigned int inherit);
+void perf_counters_close(perf_counters_t * counters);
+// Values since the counters were opened, scaled up if the kernel had to
+// multiplex them
+void perf_counters_read(const perf_counters_t * counters,long long * values);
+// end-start, -1 for the events not counted
+void perf_counters_diff(const long long * start,const long long * end,long long * values);
+
+#endif
@@ -0,0 +1,136 @@
+#include<stdio.h>
+#include<string.h>
+#include<sys/time.h>
+#include<sys/resource.h>
+#include"phase_log.h"
+
+phase_log_t * phase_log=NULL;
+
+double phase_wall_time(void)
+{
+	struct timeval ttime;
+	gettimeofday(&ttime,0);
+	return ttime.tv_sec+ttime.tv_usec*0.000001;
+};
+
+// User and system time of the process, summed over its threads
+double phase_cpu_time(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF,&usage);
+	return usage.ru_utime.tv_sec+usage.ru_utime.tv_usec*0.000001+
+			usage.ru_stime.tv_sec+usage.ru_stime.tv_usec*0.000001;
+};
+
+long phase_max_rss_kb(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF,&usage);
+	return usage.ru_maxrss;
+};
+
+void phase_begin(const char * name)
+{
+	if(phase_log==NULL)
+		return;
+	phase_log->open_name=name;
+	phase_log->open_wall=phase_wall_time();
+	phase_log->open_cpu=phase_cpu_time();
+	mem_phase_reset();
+	if(perf_counters)
+		perf_counters_read(perf_counters,phase_log->open_hw);
+};
+
+void phase_end(void)
+{
+	unsigned int i;
+	phase_t * phase;
+	long long hw[perf_nevents];
+	if(phase_log==NULL || phase_log->open_name==NULL)
+		return;
+	if(perf_counters) {
+		perf_counters_read(perf_counters,hw);
+		perf_counters_diff(phase_log->open_hw,hw,hw);
+	}
+	for(i=0;i<phase_log->nphases && strcmp(phase_log->phases[i].name,phase_log->open_name)!=0;i++);
+	if(i==phase_log->nphases) {
+		if(i==phase_log_max_phases) {
+			phase_log->open_name=NULL;
+			return;
+		}
+		phase=&phase_log->phases[phase_log->nphases++];
+		memset(phase,0,sizeof(phase_t));
+		strncpy(phase->name,phase_log->open_name,phase_log_name_len-1);
+	}
+	else
+		phase=&phase_log->phases[i];
+	phase->count++;
+	phase->wall+=phase_wall_time()-phase_log->open_wall;
+	phase->cpu+=phase_cpu_time()-phase_log->open_cpu;
+	phase->max_rss_kb=phase_max_rss_kb();
+	for(i=0;i<=mem_ncomponents;i++)
+		if(mem_phase_peak(i)>phase->mem_peak[i])
+			phase->mem_peak[i]=mem_phase_peak(i);
+	if(perf_counters) {
+		for(i=0;i<perf_nevents;i++)
+			phase->hw[i]=(hw[i]<0 || phase->hw[i]<0)?-1:phase->hw[i]+hw[i];
+		phase_log->hw=1;
+	}
+	phase_log->open_name=NULL;
+};
+
+void phase_next(const char * name)
+{
+	phase_end();
+	phase_begin(name);
+};
+
+// The phases as a JSON array
+void phase_log_write_json(const phase_log_t * log,FILE * out)
+{
+	unsigned int i,j;
+	const phase_t * phase;
+	fprintf(out,"[");
+	for(i=0;i<log->nphases;i++) {
+		phase=&log->phases[i];
+		fprintf(out,"%s{\"phase\": \"%s\", \"count\": %u, \"wall\": %f, \"cpu\": %f, \"max_rss_kb\": %ld",
+				i?", ":"",phase->name,phase->count,phase->wall,phase->cpu,phase->max_rss_kb);
+		for(j=0;j<=mem_ncomponents;j++)
+			fprintf(out,", \"mem_%s\": %lu",mem_component_names[j],(unsigned long)phase->mem_peak[j]);
+		for(j=0;log->hw && j<perf_nevents;j++)
+			fprintf(out,", \"%s\": %lld",perf_event_names[j],phase->hw[j]);
+		fprintf(out,"}");
+	}
+	fprintf(out,"]");
+};
+
+// The names of the columns written by phase_log_write_tsv after the prefix,
+// without a newline
+void phase_log_write_tsv_header(const phase_log_t * log,FILE * out)
+{
+	unsigned int j;
+	fprintf(out,"phase\tcount\twall\tcpu\tmax_rss_kb");
+	for(j=0;j<=mem_ncomponents;j++)
+		fprintf(out,"\tmem_%s",mem_component_names[j]);
+	for(j=0;log->hw && j<perf_nevents;j++)
+		fprintf(out,"\t%s",perf_event_names[j]);
+};
+
+// One line per phase, each starting with prefix and a tab:
+// phase count wall cpu max_rss_kb, the peak bytes of the mem_account
+// components and the hardware counters if any
+void phase_log_write_tsv(const phase_log_t * log,const char * prefix,FILE * out)
+{
+	unsigned int i,j;
+	const phase_t * phase;
+	for(i=0;i<log->nphases;i++) {
+		phase=&log->phases[i];
+		fprintf(out,"%s\t%s\t%u\t%f\t%f\t%ld",prefix,phase->name,phase->count,phase->wall,
+				phase->cpu,phase->max_rss_kb);
+		for(j=0;j<=mem_ncomponents;j++)
+			fprintf(out,"\t%lu",(unsigned long)phase->mem_peak[j]);
+		for(j=0;log->hw && j<perf_nevents;j++)
+			fprintf(out,"\t%lld",phase->hw[j]);
+		fprintf(out,"\n");
+	}
+};
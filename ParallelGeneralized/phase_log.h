@@ -0,0 +1,60 @@
+#ifndef phase_log_h
+#define phase_log_h
+#include<stdio.h>
+#include"perf_counters.h"
+#include"mem_account.h"
+
+// Wall clock time, CPU time of all the threads and peak memory of the phases
+// of a run. Phases with the same name (e.g. the BWT of each
+// genome) are accumulated in one entry.
+#define phase_log_max_phases 32
+#define phase_log_name_len 32
+
+typedef struct
+{
+	char name[phase_log_name_len];
+	unsigned int count;
+	double wall;
+	double cpu;
+	// Peak resident set size of the process at the end of the phase
+	long max_rss_kb;
+	// Peak bytes of every mem_account component, and of their total, during
+	// the phase
+	size_t mem_peak[mem_ncomponents+1];
+	// Hardware counters of the phase if perf_counters is open, -1 for the
+	// events not counted
+	long long hw[perf_nevents];
+} phase_t;
+
+typedef struct
+{
+	unsigned int nphases;
+	phase_t phases[phase_log_max_phases];
+	// Start of the open phase, NULL if none
+	const char * open_name;
+	double open_wall;
+	double open_cpu;
+	long long open_hw[perf_nevents];
+	// Whether the phases have hardware counters
+	unsigned int hw;
+} phase_log_t;
+
+// The log in which the library records its phases (BWT construction and
+// packing, master and slave traversals, combine). NULL, the default, records
+// nothing.
+extern phase_log_t * phase_log;
+
+double phase_wall_time(void);
+double phase_cpu_time(void);
+long phase_max_rss_kb(void);
+
+void phase_begin(const char * name);
+void phase_end(void);
+// End the open phase, if any, and begin the next one
+void phase_next(const char * name);
+
+void phase_log_write_tsv_header(const phase_log_t * log,FILE * out);
+void phase_log_write_json(const phase_log_t * log,FILE * out);
+void phase_log_write_tsv(const phase_log_t * log,const char * prefix,FILE * out);
+
+#endif
@@ -0,0 +1,111 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include"phase_log.h"
+#include"synth_genome.h"
+
+/*
+ Writes a synthetic genome drawn with synth_genome, or a mutated copy of it
+ as bench_pipeline draws the second genome, as a FASTA file that
+ test_SLT_MAWs and the other tools load. The genome is drawn in parallel
+ and is the same for any number of cores, so large benchmark inputs can be
+ regenerated from their options instead of being stored.
+*/
+
+#define synth_fasta_line_len 80
+
+int main(int argc, char **argv) {
+								/*options: -n length) genome length (default 1000000)
+										   -m model) uniform (default), gc:<fraction> or markov:<order>
+										   -R count:length[:divergence]) insert count repeats of
+											length bases, each mutated at divergence (default 0)
+										   -d rate) write the copy mutated at rate instead of the
+											genome, with seed+1 as bench_pipeline does
+										   -t cores) threads drawing the genome (default the
+											OpenMP default)
+										   -s seed) seed of mt19937ar (default 1)
+										   -o file) FASTA file (default the standard output)
+										*/
+	synth_params_t params;
+	char model[64];
+	const char * out_path=NULL;
+	FILE * out=stdout;
+	double divergence=0,wall;
+	unsigned char * text;
+	unsigned char * copy;
+	unsigned int textlen,i,n;
+	int opt,usage=0,res=0;
+	memset(&params,0,sizeof(params));
+	params.length=1000000;
+	params.seed=1;
+	while(!usage && (opt=getopt(argc,argv,"n:m:R:d:t:s:o:"))!=-1) {
+		switch(opt) {
+		case 'n':
+			params.length=strtoul(optarg,NULL,10);
+			break;
+		case 'm':
+			if(synth_parse_model(optarg,&params)!=0)
+				usage=1;
+			break;
+		case 'R':
+			if(sscanf(optarg,"%u:%u:%lf",&params.nrepeats,&params.repeat_len,&params.repeat_divergence)<2)
+				usage=1;
+			break;
+		case 'd':
+			divergence=atof(optarg);
+			break;
+		case 't':
+			params.cores=atoi(optarg);
+			break;
+		case 's':
+			params.seed=strtoull(optarg,NULL,10);
+			break;
+		case 'o':
+			out_path=optarg;
+			break;
+		default:
+			usage=1;
+		}
+	}
+	if(usage || optind!=argc || params.length==0) {
+		fprintf(stderr," Usage: %s [-n length] [-m model] [-R count:length[:divergence]] [-d rate] [-t cores] [-s seed] [-o output]\n",argv[0]);
+		return ( 1 );
+	}
+	wall=phase_wall_time();
+	text=synth_genome(&params);
+	textlen=params.length;
+	if(text && divergence>0) {
+		copy=synth_mutated_copy(text,params.length,divergence,params.seed+1,params.cores,&textlen);
+		free(text);
+		text=copy;
+	}
+	if(text==NULL) {
+		fprintf(stderr," Error: Cannot generate the genome of length %u!\n",params.length);
+		return ( 1 );
+	}
+	wall=phase_wall_time()-wall;
+	if(out_path && (out=fopen(out_path,"w"))==NULL) {
+		fprintf(stderr," Error: Cannot open output file %s!\n",out_path);
+		free(text);
+		return ( 1 );
+	}
+	synth_model_name(&params,model,sizeof(model));
+	fprintf(out,">synth %s length %u seed %llu",model,params.length,params.seed);
+	if(divergence>0)
+		fprintf(out," divergence %g",divergence);
+	fprintf(out,"\n");
+	for(i=0;i<textlen;i+=n) {
+		n=textlen-i<synth_fasta_line_len?textlen-i:synth_fasta_line_len;
+		if(fwrite(text+i,1,n,out)!=n || fputc('\n',out)==EOF) {
+			fprintf(stderr," Error: Cannot write the genome!\n");
+			res=1;
+			break;
+		}
+	}
+	free(text);
+	if(out!=stdout && fclose(out)!=0)
+		res=1;
+	fprintf(stderr,"%u bases drawn in %f seconds\n",textlen,wall);
+	return res;
+}
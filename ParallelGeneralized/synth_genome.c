@@ -0,0 +1,210 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<math.h>
+#include<omp.h>
+#include"synth_genome.h"
+#include"mt19937ar.h"
+
+// Bases drawn from one stream of mt19937ar: block i of a text is drawn from
+// stream i+1 of the seed, stream 0 draws what precedes or follows the blocks
+#define synth_block_len (1u<<20)
+
+static const unsigned char synth_bases[4]={'A','C','G','T'};
+
+static inline unsigned int synth_base_rank(unsigned char c)
+{
+	return c=='A'?0:c=='C'?1:c=='G'?2:3;
+};
+
+// A base other than c
+static inline unsigned char synth_substitute(mt_state_t * state,unsigned char c)
+{
+	return synth_bases[(synth_base_rank(c)+1+genrand_int32_r(state)%3)&3];
+};
+
+static inline unsigned int synth_threads(unsigned int cores)
+{
+	return cores?cores:(unsigned int)omp_get_max_threads();
+};
+
+// Parse uniform, gc:<fraction> or markov:<order>
+int synth_parse_model(const char * spec,synth_params_t * params)
+{
+	if(strcmp(spec,"uniform")==0)
+		params->model=synth_model_uniform;
+	else if(sscanf(spec,"gc:%lf",&params->gc)==1 && params->gc>=0 && params->gc<=1)
+		params->model=synth_model_gc;
+	else if(sscanf(spec,"markov:%u",&params->order)==1 && params->order<=synth_max_markov_order)
+		params->model=synth_model_markov;
+	else
+		return -1;
+	return 0;
+};
+
+// The model as parsed by synth_parse_model, followed by
+// +repeats:<count>:<length>:<divergence> if there are repeats
+void synth_model_name(const synth_params_t * params,char * name,unsigned int len)
+{
+	int n;
+	switch(params->model) {
+	case synth_model_gc: n=snprintf(name,len,"gc:%g",params->gc); break;
+	case synth_model_markov: n=snprintf(name,len,"markov:%u",params->order); break;
+	default: n=snprintf(name,len,"uniform");
+	}
+	if(params->nrepeats && params->repeat_len && n>=0 && (unsigned int)n<len)
+		snprintf(name+n,len-n,"+repeats:%u:%u:%g",params->nrepeats,params->repeat_len,
+				params->repeat_divergence);
+};
+
+// Order k chain: every context (the last k bases, two bits each) has random
+// transition probabilities drawn uniformly from the simplex
+static double * synth_markov_table(mt_state_t * state,unsigned int order)
+{
+	unsigned int ncontexts=1u<<(2*order);
+	double * cumul=(double *)malloc(4*ncontexts*sizeof(double));
+	double sum;
+	unsigned int i,c;
+	if(cumul==NULL)
+		return NULL;
+	for(i=0;i<ncontexts;i++) {
+		sum=0;
+		for(c=0;c<4;c++)
+			sum+=cumul[4*i+c]=-log(genrand_res53_r(state)+1e-300);
+		for(c=0;c<4;c++)
+			cumul[4*i+c]=(c?cumul[4*i+c-1]:0)+cumul[4*i+c]/sum;
+	}
+	return cumul;
+};
+
+// Bases [start,end) of a text of the model, start being a multiple of
+// synth_block_len. A Markov chain starts over in every block, from order
+// uniform bases.
+static void synth_block(unsigned char * text,unsigned int start,unsigned int end,
+		const synth_params_t * params,const double * cumul)
+{
+	mt_state_t state;
+	unsigned int i,c,r=0,mask,context=0;
+	double u;
+	init_genrand_stream_r(&state,params->seed,1+start/synth_block_len);
+	switch(params->model) {
+	case synth_model_gc:
+		for(i=start;i<end;i++) {
+			r=genrand_int32_r(&state);
+			text[i]=(r>>1)*(1.0/2147483648.0)<params->gc?synth_bases[1+(r&1)]:synth_bases[3*(r&1)];
+		}
+		break;
+	case synth_model_markov:
+		mask=(1u<<(2*params->order))-1;
+		for(i=start;i<end;i++) {
+			if(i-start<params->order)
+				c=genrand_int32_r(&state)&3;
+			else {
+				u=genrand_res53_r(&state);
+				for(c=0;c<3 && u>=cumul[4*context+c];c++);
+			}
+			text[i]=synth_bases[c];
+			context=((context<<2)|c)&mask;
+		}
+		break;
+	default:
+		// 16 bases per draw
+		for(i=start;i<end;i++,r>>=2) {
+			if(((i-start)&15)==0)
+				r=genrand_int32_r(&state);
+			text[i]=synth_bases[r&3];
+		}
+	}
+};
+
+// A text of params->length bases, drawn in blocks on params->cores threads.
+// The text depends on the parameters but not on the number of threads.
+// Returns NULL if out of memory.
+unsigned char * synth_genome(const synth_params_t * params)
+{
+	unsigned char * text=(unsigned char *)malloc(params->length+1);
+	unsigned int nblocks=(params->length+synth_block_len-1)/synth_block_len;
+	unsigned int i,j,src,dst;
+	double * cumul=NULL;
+	mt_state_t state;
+	if(text==NULL)
+		return NULL;
+	init_genrand_stream_r(&state,params->seed,0);
+	if(params->model==synth_model_markov && (cumul=synth_markov_table(&state,params->order))==NULL) {
+		free(text);
+		return NULL;
+	}
+	#pragma omp parallel for schedule(dynamic) num_threads(synth_threads(params->cores))
+	for(i=0;i<nblocks;i++)
+		synth_block(text,i*synth_block_len,i==nblocks-1?params->length:(i+1)*synth_block_len,params,cumul);
+	free(cumul);
+	if(params->repeat_len && params->repeat_len<=params->length)
+		for(i=0;i<params->nrepeats;i++) {
+			src=genrand_int32_r(&state)%(params->length-params->repeat_len+1);
+			dst=genrand_int32_r(&state)%(params->length-params->repeat_len+1);
+			memmove(text+dst,text+src,params->repeat_len);
+			for(j=0;j<params->repeat_len;j++)
+				if(genrand_res53_r(&state)<params->repeat_divergence)
+					text[dst+j]=synth_substitute(&state,text[dst+j]);
+		}
+	text[params->length]=0;
+	return text;
+};
+
+// Mutations of text[start,end) written from out, which has room for twice
+// as many bases. Returns the number of bases written.
+static unsigned int synth_mutate_block(const unsigned char * text,unsigned int start,unsigned int end,
+		double rate,unsigned long long seed,unsigned char * out)
+{
+	mt_state_t state;
+	unsigned char * begin=out;
+	unsigned int i;
+	double u;
+	init_genrand_stream_r(&state,seed,1+start/synth_block_len);
+	for(i=start;i<end;i++) {
+		if(genrand_res53_r(&state)>=rate) {
+			*out++=text[i];
+			continue;
+		}
+		u=genrand_res53_r(&state);
+		if(u<0.8)
+			*out++=synth_substitute(&state,text[i]);
+		else if(u<0.9) {
+			*out++=synth_bases[genrand_int32_r(&state)&3];
+			*out++=text[i];
+		}
+	}
+	return out-begin;
+};
+
+// A copy of text where every base is mutated with probability rate: 80% of
+// the mutations are substitutions, 10% single base insertions and 10%
+// deletions. The blocks are mutated on cores threads, 0 for the OpenMP
+// default, each into twice its room, and then moved together. Returns NULL
+// if out of memory.
+unsigned char * synth_mutated_copy(const unsigned char * text,unsigned int textlen,double rate,
+		unsigned long long seed,unsigned int cores,unsigned int * copylen)
+{
+	unsigned char * copy=(unsigned char *)malloc(2*(size_t)textlen+1);
+	unsigned int nblocks=(textlen+synth_block_len-1)/synth_block_len;
+	unsigned int * lens=(unsigned int *)malloc((nblocks+1)*sizeof(unsigned int));
+	size_t len=0;
+	unsigned int i;
+	if(copy==NULL || lens==NULL) {
+		free(copy);
+		free(lens);
+		return NULL;
+	}
+	#pragma omp parallel for schedule(dynamic) num_threads(synth_threads(cores))
+	for(i=0;i<nblocks;i++)
+		lens[i]=synth_mutate_block(text,i*synth_block_len,i==nblocks-1?textlen:(i+1)*synth_block_len,
+				rate,seed,copy+2*(size_t)i*synth_block_len);
+	for(i=0;i<nblocks;i++) {
+		memmove(copy+len,copy+2*(size_t)i*synth_block_len,lens[i]);
+		len+=lens[i];
+	}
+	free(lens);
+	*copylen=len;
+	copy[len]=0;
+	return copy;
+};
@@ -0,0 +1,38 @@
+#ifndef synth_genome_h
+#define synth_genome_h
+
+// Synthetic DNA texts drawn with mt19937ar, for benchmarks. The texts are
+// made of ACGT and followed by a 0 byte, as the loaded FASTA files. They are
+// drawn in blocks of independent streams, in parallel, and are the same for
+// any number of threads.
+#define synth_model_uniform 0
+// Bases drawn independently with P(C)+P(G)=gc
+#define synth_model_gc 1
+// Order k Markov chain with random transition probabilities
+#define synth_model_markov 2
+
+#define synth_max_markov_order 10
+
+typedef struct
+{
+	unsigned int model;
+	unsigned int length;
+	double gc;
+	unsigned int order;
+	// Copies of random segments of repeat_len bases written over random
+	// positions, each mutated at repeat_divergence
+	unsigned int nrepeats;
+	unsigned int repeat_len;
+	double repeat_divergence;
+	unsigned long long seed;
+	// Threads drawing the blocks, 0 for the OpenMP default
+	unsigned int cores;
+} synth_params_t;
+
+int synth_parse_model(const char * spec,synth_params_t * params);
+void synth_model_name(const synth_params_t * params,char * name,unsigned int len);
+unsigned char * synth_genome(const synth_params_t * params);
+unsigned char * synth_mutated_copy(const unsigned char * text,unsigned int textlen,double rate,
+		unsigned long long seed,unsigned int cores,unsigned int * copylen);
+
+#endif
@@ -2,12 +2,23 @@
 #include<stdlib.h>
 #include<time.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
 #include"mt19937ar.h"
 #include"DNA5_Basic_BWT.h"
 #include"SLT_MAWs.h"
+#include"SLT_MAWs_single_string.h"
 #include<time.h>
-#include "../malloc_count-master/malloc_count.h"
+#include "mem_account.h"
 #include "naive_MAWs.h"
+#include "fasta_loader.h"
+#include "SLT_MAWs_records.h"
+#include "kernel_metrics.h"
+#include "phase_log.h"
+#include "SLT_instrument.h"
+#include "SLT_distributed.h"
+
+#define min_MAW_len 2
 
 double gettime( void )
 {
@@ -15,18 +26,207 @@ double gettime( void )
 	gettimeofday( &ttime , 0 );
 	return ttime.tv_sec + ttime.tv_usec * 0.000001;
 };
+// Read a (Multi)FASTA file in memory, followed by its reverse complement if RC
+int read_genome(const char * path,unsigned int RC,unsigned char ** text,unsigned int * textlen)
+{
+	switch(load_fasta(path,RC?FASTA_load_RC:FASTA_load_plain,text,textlen))
+	{
+	case 0:
+		return 0;
+	case FASTA_error_open:
+		fprintf ( stderr, " Error: Cannot open file!" );
+		break;
+	case FASTA_error_format:
+		fprintf ( stderr, " Error: input file is not in FASTA format!\n" );
+		break;
+	case FASTA_error_read:
+		fprintf ( stderr, " Error: Cannot read %s!\n", path );
+		break;
+	default:
+		fprintf ( stderr, " Error: Cannot allocate memory for %s!\n", path );
+	}
+	return ( 1 );
+};
+// Inputs and results of a run, for write_run_record
+typedef struct
+{
+	const char * file1;
+	const char * file2;
+	unsigned int textlen1;
+	unsigned int textlen2;
+	unsigned int RC;
+	unsigned int cores;
+	unsigned int result;
+	unsigned int common;
+	unsigned int nMAWs1;
+	unsigned int nMAWs2;
+	double value;
+	double wall_start;
+	double cpu_start;
+	long long hw_start[perf_nevents];
+} run_record_t;
+
+// Append a machine-readable record of the run and its phases to path: one
+// JSON object per line, or one TSV line per phase (and one for the whole
+// run) after a header written to new files
+static void write_run_record(const char * path,unsigned int json,const run_record_t * run,
+		const phase_log_t * log)
+{
+	char prefix[1024];
+	long long hw[perf_nevents];
+	unsigned int j;
+	FILE * f=fopen(path,"a");
+	if(f==NULL) {
+		fprintf ( stderr, " Error: Cannot open run record file %s!\n", path );
+		return;
+	}
+	if(perf_counters) {
+		perf_counters_read(perf_counters,hw);
+		perf_counters_diff(run->hw_start,hw,hw);
+	}
+	if(json) {
+		fprintf(f,"{\"file1\": \"%s\", \"file2\": \"%s\", \"textlen1\": %u, \"textlen2\": %u, \"rc\": %u, "
+				"\"threads\": %u, \"result\": %u, \"common\": %u, \"n1\": %u, \"n2\": %u, \"value\": %f, "
+				"\"wall\": %f, \"cpu\": %f, \"max_rss_kb\": %ld, ",run->file1,run->file2,
+				run->textlen1,run->textlen2,run->RC,run->cores,run->result,run->common,run->nMAWs1,
+				run->nMAWs2,run->value,phase_wall_time()-run->wall_start,phase_cpu_time()-run->cpu_start,
+				phase_max_rss_kb());
+		for(j=0;perf_counters && j<perf_nevents;j++)
+			fprintf(f,"\"%s\": %lld, ",perf_event_names[j],hw[j]);
+		fprintf(f,"\"mem\": ");
+		mem_account_write_json(f);
+		fprintf(f,", \"phases\": ");
+		phase_log_write_json(log,f);
+		fprintf(f,"}\n");
+	}
+	else {
+		if(ftell(f)==0) {
+			fprintf(f,"file1\tfile2\ttextlen1\ttextlen2\trc\tthreads\tresult\tcommon\tn1\tn2\tvalue\t");
+			phase_log_write_tsv_header(log,f);
+			fprintf(f,"\n");
+		}
+		snprintf(prefix,sizeof(prefix),"%s\t%s\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%f",run->file1,run->file2,
+				run->textlen1,run->textlen2,run->RC,run->cores,run->result,run->common,run->nMAWs1,
+				run->nMAWs2,run->value);
+		phase_log_write_tsv(log,prefix,f);
+		fprintf(f,"%s\ttotal\t1\t%f\t%f\t%ld",prefix,phase_wall_time()-run->wall_start,
+				phase_cpu_time()-run->cpu_start,phase_max_rss_kb());
+		for(j=0;j<=mem_ncomponents;j++)
+			fprintf(f,"\t%lu",(unsigned long)mem_peak(j));
+		for(j=0;perf_counters && j<perf_nevents;j++)
+			fprintf(f,"\t%lld",hw[j]);
+		fprintf(f,"\n");
+	}
+	fclose(f);
+};
+// Index of a genome shared with the other processes through dir, at the
+// path of kernel_index_path
+Basic_BWT_t * shared_genome_index(const char * path,unsigned int RC,const char * dir)
+{
+	char * index_path=kernel_index_path(path,RC,dir);
+	Basic_BWT_t * BBWT;
+	if(index_path==NULL)
+		return NULL;
+	BBWT=kernel_share_index(path,RC,index_path);
+	free(index_path);
+	return BBWT;
+};
+// Jaccard and LW matrices between the records of one multi-FASTA file,
+// appended to output.txt
+int record_matrices(const char * path,unsigned int cores)
+{
+	unsigned char * text;
+	unsigned int textlen;
+	fasta_records_t records;
+	Basic_BWT_t * BBWT;
+	unsigned int * doc;
+	MAWs_record_matrix_t * matrix;
+	FILE * out;
+	int status=0;
+	if(load_fasta_records(path,&text,&textlen,&records)!=0)
+	{
+		fprintf ( stderr, " Error: Cannot read the records of %s!\n", path );
+		return ( 1 );
+	}
+	if((matrix=new_MAWs_record_matrix(records.nrecords))==NULL)
+	{
+		fprintf ( stderr, " Error: Cannot allocate the matrices of the %d records of %s!\n", records.nrecords, path );
+		free_fasta_records(&records);
+		free(text);
+		return ( 1 );
+	}
+	BBWT=Build_BWT_index_from_text(text,textlen,Basic_bwt_free_text);
+	free(text);
+	doc=Basic_BWT_document_array(BBWT,records.starts,records.nrecords);
+	if(SLT_find_record_MAWs(BBWT,doc,min_MAW_len,cores,matrix)!=0)
+	{
+		fprintf ( stderr, " Error: Cannot find the MAWs of the records of %s!\n", path );
+		status=1;
+	}
+	else if((out=fopen("output.txt", "a")))
+	{
+		MAWs_record_matrix_write(matrix,records.names,out);
+		fclose(out);
+	}
+	free(doc);
+	free_MAWs_record_matrix(matrix);
+	free_Basic_BWT(BBWT);
+	free_fasta_records(&records);
+	return status;
+};
 int str_compar(const void *_str1, const void *_str2)
 {
 	return strcmp(*(char **)_str1,*(char **)_str2);
 };
 
 
-#define min_MAW_len 2
-#define ALLOC_SIZE 1048576
-#define DNA                     "ACGT"                         //DNA alphabet
+#define max_weightings 16
 
 int main(int argc, char **argv) {
-								/*argv: 1) number of the first file
+								/*options: -H file) write the per string depth histogram to file
+										   -W spec) also report the LW-style score for the length weighting
+											spec (invsq, power:p, exp:lambda, window:min:max); may be repeated;
+											results 1, 2, 4 and 5 only, which count the words of both texts
+										   -k K) write only the K top scoring words to output.txt
+										   -s score) score of the top-k words: len (shortest), freq (rarest
+											min(f(aW),f(Wb))), expected (f(aW)f(Wb)/f(W)), or with result 6
+											kernel (largest correction to the numerator of the kernel);
+											default len, and kernel with result 6
+										   -c) with RC, a filter of the words of results 1 to 5: count and
+											report each MAW or rare word once together with its
+											reverse complement. Not a faster traversal: it still
+											visits both words of each pair
+										   -L rate) sample the suffix arrays every rate positions and append
+											to each MAW in output.txt the positions of aW and Wb
+										   -J file) append a JSON record of the run to file: inputs,
+											results, and wall time, CPU time and peak resident memory
+											of every phase (parse, bwt, pack, master, slaves, combine)
+										   -T file) append the same record to file as TSV, one line
+											per phase
+										   -S dir) attach the indexes published in dir (e.g. under
+											/dev/shm) read-only, building and publishing the missing
+											ones: concurrent runs share one copy of every index. The
+											indexes are keyed on the absolute path, size and time of
+											modification of the files
+										   -C file[:seconds]) checkpoint the completed slave tasks to
+											file every seconds (default 600) and resume from it if it
+											exists; with -S the restarted run also reuses the
+											indexes. Not with memory=1
+										   -D coordinator:dir[:seconds] or worker:dir[:seconds]) share
+											the slave tasks with the other processes given dir, e.g.
+											on a shared file system: each runs the tasks it claims,
+											the coordinator reports the result and the workers report
+											nothing. A worker waits at most seconds (default 3600) for
+											the coordinator, which runs again the tasks claimed that
+											long ago on other hosts. With -S every process attaches
+											the same indexes. Not with memory=1
+										   -I file) append to file the counters of every slave task of
+											the traversal and the load balance summary (needs a build
+											with -Duse_SLT_instrument)
+										   -P) read the hardware counters of the CPU (cycles,
+											instructions, LLC, dTLB and branch misses) in every phase
+											of -J and -T and in every task of -I
+								  argv: 1) number of the first file
 										2) number of the second file
 										3) memory
 										4) Reverse complement
@@ -41,23 +241,180 @@ int main(int argc, char **argv) {
 											7: Compressed MAWs
 											8: single string MAWs
 											9: KL
+											10: Jaccard and LW matrices between the records of the first file
 											*/
 
 	unsigned char * text1=NULL;
 	unsigned char * text2=NULL;
 	unsigned int textlen1=0;
 	unsigned int textlen2=0;
-	unsigned int nMAWs1;
-	unsigned int nMAWs2;
-	unsigned int nMAWs;
-	unsigned int memory=atoi(argv[3]);
-	unsigned int RC=atoi(argv[4]);
-	unsigned int cores= atoi(argv[5]);
+	unsigned int nMAWs1=0;
+	unsigned int nMAWs2=0;
+	unsigned int nMAWs=0;
+	unsigned int memory;
+	unsigned int RC;
+	unsigned int cores;
 	double output_result=0;
 	Basic_BWT_t * BBWT1;
 	Basic_BWT_t * BBWT2;
 
 	unsigned int i;
+	int opt;
+	char * hist_path=NULL;
+	char * tok;
+	char * share_dir=NULL;
+	char * json_path=NULL;
+	char * tsv_path=NULL;
+	char * instrument_path=NULL;
+	unsigned int hw_counters=0;
+	perf_counters_t process_counters;
+	phase_log_t run_log;
+	run_record_t run;
+	unsigned int topk=0;
+	// Set once the result is known if -s is not given
+	int topk_score=-1;
+	unsigned int SA_sample_rate=0;
+	MAWs_options_t options={0};
+	MAWs_weighting_t weightings[max_weightings];
+	options.weightings=weightings;
+	while((opt=getopt(argc,argv,"H:W:k:s:L:S:C:D:J:T:I:Pc"))!=-1) {
+		switch(opt) {
+		case 'H':
+			hist_path=optarg;
+			break;
+		case 'W':
+			if(options.nweightings==max_weightings ||
+					MAWs_parse_weighting(optarg,&weightings[options.nweightings])!=0) {
+				fprintf(stderr," Error: invalid or too many weightings: %s\n",optarg);
+				return ( 1 );
+			}
+			options.nweightings++;
+			break;
+		case 'k':
+			topk=atoi(optarg);
+			break;
+		case 'c':
+			options.canonical_filter=1;
+			break;
+		case 'L':
+			SA_sample_rate=atoi(optarg);
+			options.witnesses=(SA_sample_rate>0);
+			break;
+		case 'S':
+			share_dir=optarg;
+			break;
+		case 'C':
+			options.checkpoint=strtok(optarg,":");
+			tok=strtok(NULL,":");
+			options.checkpoint_interval=tok?atof(tok):600;
+			break;
+		case 'D':
+			if(strncmp(optarg,"coordinator:",12)==0)
+				options.distributed_role=SLT_coordinator;
+			else if(strncmp(optarg,"worker:",7)==0)
+				options.distributed_role=SLT_worker;
+			else {
+				fprintf(stderr," Error: invalid role: %s\n",optarg);
+				return ( 1 );
+			}
+			if((options.distributed_dir=strtok(strchr(optarg,':')+1,":"))==NULL) {
+				fprintf(stderr," Error: no directory in %s\n",optarg);
+				return ( 1 );
+			}
+			tok=strtok(NULL,":");
+			options.distributed_timeout=tok?atof(tok):3600;
+			break;
+		case 'J':
+			json_path=optarg;
+			break;
+		case 'T':
+			tsv_path=optarg;
+			break;
+		case 'I':
+#ifndef use_SLT_instrument
+			fprintf(stderr," Error: -I needs a build with -Duse_SLT_instrument\n");
+			return ( 1 );
+#endif
+			instrument_path=optarg;
+			break;
+		case 'P':
+			hw_counters=1;
+			break;
+		case 's':
+			if(strcmp(optarg,"len")==0)
+				topk_score=MAWs_topk_by_length;
+			else if(strcmp(optarg,"freq")==0)
+				topk_score=MAWs_topk_by_freq;
+			else if(strcmp(optarg,"expected")==0)
+				topk_score=MAWs_topk_by_expected;
+			else if(strcmp(optarg,"kernel")==0)
+				topk_score=MAWs_topk_by_kernel;
+			else {
+				fprintf(stderr," Error: invalid top-k score: %s\n",optarg);
+				return ( 1 );
+			}
+			break;
+		default:
+			fprintf(stderr," Usage: %s [-H histogram_file] [-W weighting]... [-k K [-s score]] [-L rate] [-S dir] [-C file[:seconds]] [-D role:dir[:seconds]] [-J file] [-T file] [-I file] [-P] [-c] file1 file2 memory RC cores result [delta1 delta2]\n",argv[0]);
+			return ( 1 );
+		}
+	}
+	// Shift the positional arguments so that argv[1] is the first of them
+	argv+=optind-1;
+	argc-=optind-1;
+	memset(&run,0,sizeof(run));
+	// Opened before the threads of OpenMP, which inherit the counters
+	if(hw_counters) {
+		if(perf_counters_open(&process_counters,1)==0)
+			fprintf(stderr," Warning: no hardware counter available, the counters will be -1\n");
+		perf_counters=&process_counters;
+		perf_counters_read(perf_counters,run.hw_start);
+	}
+	run.wall_start=phase_wall_time();
+	run.cpu_start=phase_cpu_time();
+	if(json_path || tsv_path) {
+		memset(&run_log,0,sizeof(run_log));
+		phase_log=&run_log;
+	}
+	if(instrument_path)
+		SLT_instrument_log=new_SLT_instrument();
+	if(hist_path)
+		options.hist=new_MAWs_histogram();
+	memory=atoi(argv[3]);
+	RC=atoi(argv[4]);
+	cores= atoi(argv[5]);
+	if(options.canonical_filter && !RC) {
+		fprintf(stderr," Error: -c needs the reverse complement (RC=1)\n");
+		return ( 1 );
+	}
+	if(options.canonical_filter && atoi(argv[6])==6) {
+		fprintf(stderr," Error: -c filters the words of results 1 to 5, not the kernel\n");
+		return ( 1 );
+	}
+	// The MAWs written to output.txt cannot be resumed
+	if(options.checkpoint && memory) {
+		fprintf(stderr," Error: -C needs memory=0\n");
+		return ( 1 );
+	}
+	if(options.distributed_dir && memory) {
+		fprintf(stderr," Error: -D needs memory=0\n");
+		return ( 1 );
+	}
+	// Only the kernel callback scores the words by their kernel term
+	if(topk_score<0)
+		topk_score=atoi(argv[6])==6?MAWs_topk_by_kernel:MAWs_topk_by_length;
+	if(topk && (topk_score==MAWs_topk_by_kernel)!=(atoi(argv[6])==6)) {
+		fprintf(stderr," Error: -s kernel needs result 6, and result 6 has only the kernel score\n");
+		return ( 1 );
+	}
+	if(topk)
+		options.topk=new_MAWs_topk(topk,topk_score);
+	// Results 3 and 6 do not count the MAWs of each text
+	if(options.nweightings && atoi(argv[6])!=1 && atoi(argv[6])!=2 && atoi(argv[6])!=4 && atoi(argv[6])!=5) {
+		fprintf(stderr," Error: -W needs result 1, 2, 4 or 5\n");
+		return ( 1 );
+	}
+
 	unsigned int num=66;
 	char files[num][20];
 	strcpy(files[0],"../data/BA.fa");
@@ -96,209 +453,175 @@ int main(int argc, char **argv) {
 	FILE *x=fopen("output.txt", "w");
 	fclose(x);
 
+	if(atoi(argv[6]) == 10)
+		return record_matrices(files[atoi(argv[1])],cores);
+
 	// Reading File 1
-	FILE *f1;
-	/* Read the (Multi)FASTA file in memory */
-	if ( ! ( f1 = fopen ( files[atoi(argv[1])], "r") ) )
-	{
-		fprintf ( stderr, " Error: Cannot open file!" );
+	phase_begin("parse");
+	if(share_dir==NULL && read_genome(files[atoi(argv[1])],RC,&text1,&textlen1)!=0)
 		return ( 1 );
-	}
-
-	char c;
-	c = fgetc( f1 );
-	unsigned int max_alloc_seq = 0;
-	do
-	{
-		if ( c != '>' )
-		{
-			fprintf ( stderr, " Error: input file is not in FASTA format!\n" );
-			return ( 1 );
-		}
-		else
-		{
-			while ( ( c = fgetc( f1 ) ) != EOF && c != '\n' )
-			{
-			}
-		}
-		while ( ( c = fgetc( f1 ) ) != EOF && c != '>' )
-		{
-			if( textlen1 == 0 && c == '\n' )
-			{
-				fprintf ( stderr, " Omitting empty sequence in file!\n" );
-				c = fgetc( f1 );
-				break;
-			}
-			if( c == '\n' ) continue;
-
-			if ( textlen1 >= max_alloc_seq )
-			{
-				text1 = ( unsigned char * ) realloc ( text1,   ( max_alloc_seq + ALLOC_SIZE ) * sizeof ( unsigned char ) );
-				max_alloc_seq += ALLOC_SIZE;
-			}
-			if( strchr ( DNA, c ) )
-			{
-				text1[ textlen1++ ] = c;
-			}
-		}
-	} while( c != EOF );
-	unsigned long int l=textlen1;
-	if(RC) {
-		text1 = ( unsigned char * ) realloc ( text1,   (textlen1*2+2) * sizeof ( unsigned char ) );
-		unsigned long int r=textlen1-1;
-		text1[l++]='Z';
-		while ( l<textlen1*2+1)
-		{
-			switch ( text1[r--] )
-			{
-			case 'A':
-				text1[l++] = 'T';
-				break;
-			case 'C':
-				text1[l++] = 'G';
-				break;
-			case 'G':
-				text1[l++] = 'C';
-				break;
-			case 'T':
-				text1[l++] = 'A';
-				break;
-			default:
-				return ( 0 );
-			}
-		}
-		text1[l++]='Z';
-	}
-	fclose(f1);
+	phase_end();
 
 	FILE *results= fopen("../results_gen", "a");
 	if(atoi(argv[6]) == 8) {
+		BBWT1=share_dir?shared_genome_index(files[atoi(argv[1])],RC,share_dir):
+			Build_BWT_index_from_text(text1,textlen1,Basic_bwt_free_text);
+		if(BBWT1==NULL)
+			return ( 1 );
 		nMAWs=SLT_find_MAWs_single_string(BBWT1,min_MAW_len,&nMAWs1,&output_result, memory);
 		fprintf(results,"Computing %s; MAWs are %d;\n", files[atoi(argv[1])], nMAWs);
-		// fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)malloc_count_peak(),cores);	
+		// fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)mem_peak(mem_total),cores);	
 		free_Basic_BWT(BBWT1);
 		return 0;
 	}
 
 	// Reading File 2
-	if ( ! ( f1 = fopen ( files[atoi(argv[2])], "r") ) )
-	{
-		fprintf ( stderr, " Error: Cannot open file!" );
+	phase_begin("parse");
+	if(share_dir==NULL && read_genome(files[atoi(argv[2])],RC,&text2,&textlen2)!=0)
 		return ( 1 );
-	}
+	phase_end();
 
-	c = fgetc( f1 );
-	max_alloc_seq = 0;
-	do
-	{
-		if ( c != '>' )
-		{
-			fprintf ( stderr, " Error: input file is not in FASTA format!\n" );
+	double t1= gettime();
+	if(share_dir) {
+		// Attach the shared indexes, or build and publish them
+		BBWT1=shared_genome_index(files[atoi(argv[1])],RC,share_dir);
+		BBWT2=shared_genome_index(files[atoi(argv[2])],RC,share_dir);
+		if(BBWT1==NULL || BBWT2==NULL)
 			return ( 1 );
-		}
-		else
-		{
-			while ( ( c = fgetc( f1 ) ) != EOF && c != '\n' )
-			{
-			}
-
-		}
-		while ( ( c = fgetc( f1 ) ) != EOF && c != '>' )
+		textlen1=BBWT1->textlen;
+		textlen2=BBWT2->textlen;
+	}
+	else {
+		// Build a BWT index on the text.
+		BBWT1=Build_BWT_index_from_text(text1,textlen1,Basic_bwt_free_text);
+		BBWT2=Build_BWT_index_from_text(text2,textlen2,Basic_bwt_free_text);
+	}
+	printf("Text len is: %d - %d\n",textlen1, textlen2);
+	if(SA_sample_rate) {
+		phase_begin("sa_samples");
+		#pragma omp parallel sections num_threads(2)
 		{
-			if( textlen2 == 0 && c == '\n' )
-			{
-				fprintf ( stderr, " Omitting empty sequence in file!\n" );
-				c = fgetc( f1 );
-				break;
-			}
-			if( c == '\n' ) continue;
-
-			if ( textlen2 >= max_alloc_seq )
-			{
-				text2 = ( unsigned char * ) realloc ( text2,   ( max_alloc_seq + ALLOC_SIZE ) * sizeof ( unsigned char ) );
-				max_alloc_seq += ALLOC_SIZE;
-			}
-			if( strchr ( DNA, c ) )
-			{
-				text2[ textlen2++ ] = c;
-			}
+			#pragma omp section
+			Basic_BWT_build_SA_samples(BBWT1,SA_sample_rate);
+			#pragma omp section
+			Basic_BWT_build_SA_samples(BBWT2,SA_sample_rate);
 		}
-	} while( c != EOF );
-	l=textlen2;
-			if(RC) {
-				text2 = ( unsigned char * ) realloc ( text2,   (textlen2*2+2) * sizeof ( unsigned char ) );
-				unsigned long int r=textlen2-1;
-				text2[l++]='Z';
-				while ( l<textlen2*2+1)
-				{
-					switch ( text2[r--] )
-					{
-					case 'A':
-						text2[l++] = 'T';
-						break;
-					case 'C':
-						text2[l++] = 'G';
-						break;
-					case 'G':
-						text2[l++] = 'C';
-						break;
-					case 'T':
-						text2[l++] = 'A';
-						break;
-					default:
-						return ( 0 );
-					}
-				}
-				text2[l++]='Z';
-			}
-	fclose(f1);
-
-	printf("Text len is: %d - %d\n",textlen1, textlen2);
-
-	double t1= gettime();
-	// Build a BWT index on the text.
-	BBWT1=Build_BWT_index_from_text(text1,textlen1,Basic_bwt_free_text);
-	BBWT2=Build_BWT_index_from_text(text2,textlen2,Basic_bwt_free_text);
+		phase_end();
+	}
 	// Launch the SLT based algorithm
 	double t2= gettime();
+	if(options.distributed_role==SLT_worker) {
+		// Only the coordinator has the whole result
+		if(atoi(argv[6])==2)
+			SLT_find_RWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, 2, atoi(argv[7]), atoi(argv[8]), &options);
+		else
+			SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]), &options);
+		fprintf(stderr,"Worker done in %f seconds\n",gettime()-t2);
+		return 0;
+	}
 	//naive_find_MAWs(text1, textlen1, 2);
-	double t3=gettime();
+	double t3=t2;
 	switch(atoi(argv[6])) {
 		case 1:
-			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]));
+			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]), &options);
+			t3=gettime();
+			run.value=nMAWs;
 			fprintf(results,"Computing %s and %s; Common MAWs are %d, Maws1: %d, Maws2: %d;\n", files[atoi(argv[1])], files[atoi(argv[2])], nMAWs, nMAWs1, nMAWs2);
-			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)malloc_count_peak(),cores);	
+			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)mem_peak(mem_total),cores);	
 			break;
 		case 2:
-			nMAWs=SLT_find_RWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]), atoi(argv[7]), atoi(argv[8]));
+			nMAWs=SLT_find_RWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]), atoi(argv[7]), atoi(argv[8]), &options);
+			t3=gettime();
+			run.value=nMAWs;
 			fprintf(results,"Computing %s and %s; Common rare words are %d, Maws1: %d, Maws2: %d;\n", files[atoi(argv[1])], files[atoi(argv[2])], nMAWs, nMAWs1, nMAWs2);
-			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)malloc_count_peak(),cores);	
+			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)mem_peak(mem_total),cores);	
 			break;
 		case 3:
-			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]));
+			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]), &options);
+			t3=gettime();
+			run.value=nMAWs;
 			fprintf(results,"Computing %s and %s; MAWs for %s and present in %s: %d\n", files[atoi(argv[1])], files[atoi(argv[2])],files[atoi(argv[1])], files[atoi(argv[2])], nMAWs);
-			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)malloc_count_peak(),cores);	
+			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)mem_peak(mem_total),cores);	
 			break;
 		case 4:
-			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]));
+			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]), &options);
+			t3=gettime();
 			double jaccard= (double) nMAWs/(nMAWs1+nMAWs2-nMAWs);
+			run.value=jaccard;
 			fprintf(results,"Computing %s and %s; Jaccard Distance: %f\n", files[atoi(argv[1])], files[atoi(argv[2])], jaccard);
-			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)malloc_count_peak(),cores);	
+			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)mem_peak(mem_total),cores);	
 			break;
 		case 5:
-			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]));
+			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]), &options);
+			t3=gettime();
+			run.value=output_result;
 			fprintf(results,"Computing %s and %s; LW: %f\n", files[atoi(argv[1])], files[atoi(argv[2])], output_result);
-			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)malloc_count_peak(),cores);	
+			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)mem_peak(mem_total),cores);	
 			break;
 		case 6:
-			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]));
+			nMAWs=SLT_find_MAWs(BBWT1,BBWT2,min_MAW_len,&nMAWs1,&nMAWs2,&output_result, memory, cores, atoi(argv[6]), &options);
+			t3=gettime();
+			run.value=output_result;
 			fprintf(results,"Computing %s and %s; Markovian Kernel: %f\n", files[atoi(argv[1])], files[atoi(argv[2])], output_result);
-			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)malloc_count_peak(),cores);	
+			fprintf(results, "Time BWT: %f; Time MAWs: %f; Our peak memory allocation: %lld; Number of cores: %d\n\n",t2-t1, t3-t2,(long long)mem_peak(mem_total),cores);	
 			break;
 }
+	if(json_path || tsv_path) {
+		run.file1=files[atoi(argv[1])];
+		run.file2=files[atoi(argv[2])];
+		run.textlen1=textlen1;
+		run.textlen2=textlen2;
+		run.RC=RC;
+		run.cores=cores;
+		run.result=atoi(argv[6]);
+		run.common=nMAWs;
+		run.nMAWs1=nMAWs1;
+		run.nMAWs2=nMAWs2;
+		if(json_path)
+			write_run_record(json_path,1,&run,&run_log);
+		if(tsv_path)
+			write_run_record(tsv_path,0,&run,&run_log);
+	}
+	if(instrument_path) {
+		FILE *f=fopen(instrument_path, "a");
+		if(f) {
+			fprintf(f,"# %s and %s, result %d, %u cores\n",files[atoi(argv[1])],files[atoi(argv[2])],
+					atoi(argv[6]),cores);
+			SLT_instrument_write(SLT_instrument_log,f);
+			fclose(f);
+		}
+		else
+			fprintf ( stderr, " Error: Cannot open instrumentation file!\n" );
+		free_SLT_instrument(SLT_instrument_log);
+		SLT_instrument_log=NULL;
+	}
+	for(i=0;i<options.nweightings;i++)
+		fprintf(results,"Computing %s and %s; Weighted LW (%s): %f\n", files[atoi(argv[1])], files[atoi(argv[2])], weightings[i].name, weightings[i].value);
+	if(options.hist) {
+		FILE *h=fopen(hist_path, "w");
+		if(h) {
+			MAWs_histogram_write(options.hist, h);
+			fclose(h);
+		}
+		else
+			fprintf ( stderr, " Error: Cannot open histogram file!\n" );
+		free_MAWs_histogram(options.hist);
+	}
+	if(options.topk) {
+		FILE *o=fopen("output.txt", "a");
+		if(o) {
+			MAWs_topk_write(options.topk, o);
+			fclose(o);
+		}
+		else
+			fprintf ( stderr, " Error: Cannot open output file!\n" );
+		free_MAWs_topk(options.topk);
+	}
 	//fprintf(results,"Computing %s and %s; Common MAWs is %d, Maws1: %d, Maws2: %d; Jaccard: %f; LW: %f\n", files[atoi(argv[1])], files[atoi(argv[2])], nMAWs, nMAWs1, nMAWs2, jaccard,LW);
 
 	free_Basic_BWT(BBWT1);
 	free_Basic_BWT(BBWT2);
+	if(perf_counters)
+		perf_counters_close(perf_counters);
 	return 0; 
 }